@@ -0,0 +1,83 @@
+// 多数のホストを持つ設定ファイルの読み込み（起動・再読み込み）にかかる時間を測る
+// TOMLをパースする場合と，--compile-configで作ったキャッシュを読み込む場合を比べる
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ConfigCache.hpp"
+#include "ConfigSnapshot.hpp"
+
+#define BENCH_CONF_PATH "config_load_bench.conf"
+#define ITERATIONS 3
+// 書いたばかりの設定ファイルのキャッシュは中身のハッシュでも確かめるので，
+// 時刻の粒度より長く待ってからキャッシュを作る（起動時と同じ条件にする）
+#define SETTLE_SECONDS 3
+
+static double nowMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// hosts個のホスト（それぞれlocationを2つ持つ）を並べた設定ファイルを作る
+static void writeConfig(size_t hosts) {
+  std::ofstream file(BENCH_CONF_PATH);
+  for (size_t i = 0; i < hosts; ++i) {
+    file << "[host" << i << "]\n"
+         << "listen = [" << 8000 + i % 16 << "]\n"
+         << "root = \"/var/www/host" << i << "\"\n"
+         << "index = \"index.html\"\n"
+         << "client_max_body_size = \"1M\"\n"
+         << "[host" << i << ".error_page]\n"
+         << "404 = \"/404.html\"\n"
+         << "[host" << i << ".location.\"/static/\"]\n"
+         << "autoindex = on\n"
+         << "[host" << i << ".location.\"/upload/\"]\n"
+         << "deny = [DELETE]\n";
+  }
+}
+
+// 設定を読み込んでルーティング表まで作る時間の平均（ミリ秒）．失敗時は-1
+static double measureLoad() {
+  double start = nowMillis();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    ConfigSnapshot* snapshot = ConfigSnapshot::load(BENCH_CONF_PATH);
+    if (snapshot == NULL) {
+      return -1;
+    }
+    snapshot->release();
+  }
+  return (nowMillis() - start) / ITERATIONS;
+}
+
+int main() {
+  const size_t hosts[] = {1000, 5000, 20000};
+  const std::string cachePath = ConfigCache::cachePath(BENCH_CONF_PATH);
+
+  std::printf("%8s %12s %12s %12s\n", "hosts", "toml ms", "compile ms",
+              "cache ms");
+  for (size_t h = 0; h < sizeof(hosts) / sizeof(hosts[0]); ++h) {
+    writeConfig(hosts[h]);
+    std::remove(cachePath.c_str());
+    double toml = measureLoad();
+    sleep(SETTLE_SECONDS);
+
+    double start = nowMillis();
+    bool compiled = ConfigCache::compile(BENCH_CONF_PATH);
+    double compile = nowMillis() - start;
+    double cache = measureLoad();
+    if (toml < 0 || cache < 0 || !compiled) {
+      std::cerr << "failed to load " << BENCH_CONF_PATH << std::endl;
+      return 1;
+    }
+    std::printf("%8lu %12.1f %12.1f %12.1f\n", (unsigned long)hosts[h], toml,
+                compile, cache);
+  }
+  std::remove(BENCH_CONF_PATH);
+  std::remove(cachePath.c_str());
+  return 0;
+}
@@ -0,0 +1,100 @@
+// イベントループのバックエンドごとに，1回のイベント通知にかかるコストを測る
+// 監視中の接続数（100, 1k, 10k）のうち1本だけがアクティブな状況を再現する
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "EventLoop.hpp"
+
+#define ITERATIONS 2000
+
+static double nowMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+// 接続数ぶんのFDを開けるようにソフトリミットを引き上げる
+static void raiseFdLimit() {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+/**
+ * @brief connections本の接続を監視し，1本だけにデータが届くことを繰り返す
+ * @return 1回のwait（イベント通知）あたりの平均時間（マイクロ秒）．失敗時は-1
+ */
+static double measure(const char* backend, size_t connections) {
+  EventLoop* eventLoop = EventLoop::create(backend);
+  if (eventLoop == NULL) {
+    return -1;
+  }
+
+  // アイドル接続の代わりに，何も届かないUDPソケットを使う（1本あたりFD1つ）
+  std::vector<int> idle;
+  for (size_t i = 0; i + 1 < connections; ++i) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+      break;
+    }
+    idle.push_back(fd);
+    eventLoop->add(fd, EventLoop::READ);
+  }
+
+  int active[2];
+  if (idle.size() + 1 != connections ||
+      socketpair(AF_UNIX, SOCK_STREAM, 0, active) < 0) {
+    std::cerr << "failed to open " << connections << " fds" << std::endl;
+    for (size_t i = 0; i < idle.size(); ++i) close(idle[i]);
+    delete eventLoop;
+    return -1;
+  }
+  eventLoop->add(active[0], EventLoop::READ);
+
+  std::vector<EventLoop::Event> fired;
+  char byte = 'x';
+  double start = nowMicros();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    if (write(active[1], &byte, 1) != 1 || eventLoop->wait(fired, -1) != 1 ||
+        read(active[0], &byte, 1) != 1) {
+      std::cerr << "unexpected event" << std::endl;
+      break;
+    }
+  }
+  double elapsed = nowMicros() - start;
+
+  for (size_t i = 0; i < idle.size(); ++i) close(idle[i]);
+  close(active[0]);
+  close(active[1]);
+  delete eventLoop;
+  return elapsed / ITERATIONS;
+}
+
+int main() {
+  raiseFdLimit();
+
+  const char* backends[] = {"poll", "epoll"};
+  const size_t connections[] = {100, 1000, 10000};
+
+  std::printf("%-8s %12s %16s\n", "backend", "connections", "us/dispatch");
+  for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+    for (size_t c = 0; c < sizeof(connections) / sizeof(connections[0]); ++c) {
+      double cost = measure(backends[b], connections[c]);
+      if (cost < 0) {
+        return 1;
+      }
+      std::printf("%-8s %12lu %16.2f\n", backends[b],
+                  (unsigned long)connections[c], cost);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+// HTTPリクエストの解析にかかる時間と，1リクエストあたりのメモリ確保の回数を測る
+// 同じパーサーを使い回したとき，解析中にメモリを確保しないことを確かめる
+// 区切り文字の検索は，このCPUで使える実装（スカラー・SSE2・AVX2）ごとに測る
+#include <sys/time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "HTTPRequestParser.hpp"
+#include "HTTPScanner.hpp"
+
+// operator newを置き換えて確保の回数を数える
+static unsigned long g_allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+  ++g_allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) throw() { std::free(p); }
+
+static double nowMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// ブラウザが送る程度のGETリクエスト
+static std::string typicalRequest() {
+  return "GET /html/index.html?lang=ja HTTP/1.1\r\n"
+         "Host: localhost:8001\r\n"
+         "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) "
+         "Gecko/20100101 Firefox/128.0\r\n"
+         "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+         "*/*;q=0.8\r\n"
+         "Accept-Language: ja,en-US;q=0.7,en;q=0.3\r\n"
+         "Accept-Encoding: gzip, deflate, br\r\n"
+         "Connection: keep-alive\r\n"
+         "Upgrade-Insecure-Requests: 1\r\n"
+         "Cache-Control: max-age=0\r\n\r\n";
+}
+
+// 大きなCookieと多数のヘッダーを持つリクエスト
+static std::string largeHeaderRequest() {
+  std::string request = "GET /api/items HTTP/1.1\r\nHost: localhost\r\n";
+  request += "Cookie: ";
+  for (int i = 0; i < 200; ++i) {
+    char cookie[64];
+    std::sprintf(cookie, "session%d=0123456789abcdef0123456789abcdef; ", i);
+    request += cookie;
+  }
+  request += "\r\n";
+  for (int i = 0; i < 50; ++i) {
+    char header[64];
+    std::sprintf(header, "X-Custom-Header-%d: value-%d\r\n", i, i);
+    request += header;
+  }
+  request += "\r\n";
+  return request;
+}
+
+static int run(const char* name, const std::string& request, int iterations) {
+  HTTPRequestParser parser;
+  // 大きなCookieもヘッダーの上限で断らずに解析させる
+  parser.setHeaderBufferLimits(64 * 1024, 4);
+  // 1回目はバッファの確保を含むので測らない
+  parser.feed(request.data(), request.size());
+
+  unsigned long allocations = g_allocations;
+  double start = nowMillis();
+  for (int i = 0; i < iterations; ++i) {
+    parser.reset();
+    if (!parser.feed(request.data(), request.size())) {
+      std::fprintf(stderr, "failed to parse the %s request\n", name);
+      return 1;
+    }
+  }
+  double elapsed = nowMillis() - start;
+  allocations = g_allocations - allocations;
+
+  double megabytes = request.size() * (double)iterations / (1024.0 * 1024.0);
+  std::printf("%-8s %8lu %12.1f %12.0f %10.1f %12.2f\n", name,
+              (unsigned long)request.size(), elapsed,
+              elapsed * 1000000.0 / iterations, megabytes * 1000.0 / elapsed,
+              (double)allocations / iterations);
+  return 0;
+}
+
+int main() {
+  const char* names[] = {"scalar", "sse2", "avx2"};
+
+  for (int level = HTTPScanner::SCALAR; level <= HTTPScanner::bestLevel();
+       ++level) {
+    HTTPScanner::setLevel(static_cast<HTTPScanner::Level>(level));
+    std::printf("== %s\n", names[level]);
+    std::printf("%-8s %8s %12s %12s %10s %12s\n", "request", "bytes",
+                "total ms", "ns/request", "MB/s", "allocs/req");
+    if (run("typical", typicalRequest(), 200000) != 0 ||
+        run("large", largeHeaderRequest(), 20000) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
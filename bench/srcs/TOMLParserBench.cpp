@@ -0,0 +1,60 @@
+// 設定ファイル（TOML）のパースにかかる時間を，セクション数を変えて測る
+// セクション数に比例して（1セクションあたり一定の時間で）パースできることを確かめる
+#include <sys/time.h>
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "TOMLParser.hpp"
+
+static double nowMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// hosts個のホストのセクションと，それぞれのlocationのセクションを並べる
+static std::string createConfig(size_t sections) {
+  std::ostringstream oss;
+  oss << "# generated for TOMLParserBench\n"
+      << "keepalive_timeout = 75\n";
+  for (size_t i = 0; i < sections / 2; ++i) {
+    oss << "\n[host" << i << "]\n"
+        << "listen = [" << 8000 + i % 16 << ", 9000]\n"
+        << "root = \"/var/www/host" << i << "\"\n"
+        << "index = 'index.html'\n"
+        << "autoindex = on\n"
+        << "[host" << i << ".location.\"/static/\"]\n"
+        << "deny = [\"DELETE\", \"PUT\"]\n"
+        << "return = \"/moved\\tpage\"\n";
+  }
+  return oss.str();
+}
+
+int main() {
+  const size_t sections[] = {1000, 10000, 100000};
+
+  std::printf("%10s %10s %12s %14s %10s\n", "sections", "MB", "parse ms",
+              "ns/section", "MB/s");
+  for (size_t s = 0; s < sizeof(sections) / sizeof(sections[0]); ++s) {
+    std::string content = createConfig(sections[s]);
+    TOMLParser parser;
+    double start = nowMillis();
+    Directive* rootDirective = parser.parseFromString(content);
+    double elapsed = nowMillis() - start;
+    if (rootDirective == NULL) {
+      std::cerr << "failed to parse the generated configuration" << std::endl;
+      return 1;
+    }
+    delete rootDirective;
+
+    double megabytes = content.size() / (1024.0 * 1024.0);
+    std::printf("%10lu %10.1f %12.1f %14.0f %10.1f\n",
+                (unsigned long)sections[s], megabytes, elapsed,
+                elapsed * 1000000.0 / sections[s],
+                megabytes * 1000.0 / elapsed);
+  }
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include "BinaryUpgrade.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+extern char **environ;
+
+char **BinaryUpgrade::_argv = NULL;
+std::map<int, int> BinaryUpgrade::_inherited;
+pid_t BinaryUpgrade::_parent = 0;
+
+void BinaryUpgrade::setArgv(char **argv) { _argv = argv; }
+
+pid_t BinaryUpgrade::spawn(const MultiPortServer &server) {
+  if (_argv == NULL || _argv[0] == NULL) {
+    std::cerr << "Binary upgrade is not available" << std::endl;
+    return -1;
+  }
+
+  // 環境変数はfork前に組み立てる（ワーカースレッドがいても，fork後の子プロセスでは
+  // メモリを確保しない）
+  std::ostringstream listeners;
+  listeners << LISTENERS_ENV << '=';
+  const std::vector<int> &server_fds = server.getServerFds();
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    if (i > 0) listeners << ';';
+    listeners << server_fds[i] << ':' << server.getPortByFd(server_fds[i]);
+  }
+  std::ostringstream parent;
+  parent << UPGRADE_PARENT_ENV << '=' << getpid();
+
+  std::vector<std::string> env;
+  for (char **entry = environ; *entry != NULL; ++entry) {
+    std::string value(*entry);
+    if (value.compare(0, sizeof(LISTENERS_ENV), LISTENERS_ENV "=") != 0 &&
+        value.compare(0, sizeof(UPGRADE_PARENT_ENV), UPGRADE_PARENT_ENV "=") !=
+            0) {
+      env.push_back(value);
+    }
+  }
+  env.push_back(listeners.str());
+  env.push_back(parent.str());
+  std::vector<char *> envp;
+  for (size_t i = 0; i < env.size(); ++i) {
+    envp.push_back(const_cast<char *>(env[i].c_str()));
+  }
+  envp.push_back(NULL);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return -1;
+  }
+  if (pid > 0) {
+    std::cout << "Starting new binary " << _argv[0] << " (pid " << pid << ")"
+              << std::endl;
+    return pid;
+  }
+
+  // 子プロセス：リッスンソケットだけをexec後も開いたままにする
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    int flags = fcntl(server_fds[i], F_GETFD);
+    if (flags != -1) {
+      fcntl(server_fds[i], F_SETFD, flags & ~FD_CLOEXEC);
+    }
+  }
+  execve(_argv[0], _argv, &envp[0]);
+  perror("execve");
+  _exit(EXIT_FAILURE);
+}
+
+// FDがリッスン中のソケットか
+static bool isListeningSocket(int fd) {
+  int listening = 0;
+  socklen_t len = sizeof(listening);
+  return getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) == 0 &&
+         listening != 0;
+}
+
+void BinaryUpgrade::loadInheritedListeners() {
+  const char *listeners = std::getenv(LISTENERS_ENV);
+  const char *parent = std::getenv(UPGRADE_PARENT_ENV);
+  if (listeners != NULL) {
+    std::istringstream iss(listeners);
+    std::string entry;
+    while (std::getline(iss, entry, ';')) {
+      std::istringstream entryStream(entry);
+      int fd, port;
+      char colon;
+      if (!(entryStream >> fd >> colon >> port) || colon != ':' ||
+          !isListeningSocket(fd)) {
+        std::cerr << "Ignoring inherited listener: " << entry << std::endl;
+        continue;
+      }
+      // 新しいプロセスでも，これ以上の子プロセスには引き継がない
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      _inherited[port] = fd;
+    }
+  }
+  if (parent != NULL) {
+    _parent = static_cast<pid_t>(std::atol(parent));
+  }
+  unsetenv(LISTENERS_ENV);
+  unsetenv(UPGRADE_PARENT_ENV);
+}
+
+int BinaryUpgrade::takeInheritedListener(int port) {
+  std::map<int, int>::iterator it = _inherited.find(port);
+  if (it == _inherited.end()) {
+    return -1;
+  }
+  int fd = it->second;
+  _inherited.erase(it);
+  return fd;
+}
+
+void BinaryUpgrade::closeInheritedListeners() {
+  for (std::map<int, int>::iterator it = _inherited.begin();
+       it != _inherited.end(); ++it) {
+    close(it->second);
+  }
+  _inherited.clear();
+}
+
+void BinaryUpgrade::notifyParent() {
+  // 引き継ぎ元がすでに終了していれば（親が変わっていれば）何もしない
+  if (_parent <= 1 || getppid() != _parent) {
+    _parent = 0;
+    return;
+  }
+  if (kill(_parent, SIGQUIT) == -1) {
+    perror("kill");
+  }
+  _parent = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <map>
+#include <vector>
+
+#include "MultiPortServer.hpp"
+
+// 新しいプロセスに引き継ぐリッスンソケット（"FD:ポート;FD:ポート"）
+#define LISTENERS_ENV "WEBSERV_LISTENERS"
+// 引き継ぎ元のプロセスID（準備ができたら，このプロセスにSIGQUITを送る）
+#define UPGRADE_PARENT_ENV "WEBSERV_UPGRADE_PARENT"
+
+/**
+ * @class BinaryUpgrade
+ * @brief リッスンソケットを引き継いで，新しいwebservのバイナリに入れ替える
+ *
+ * 1. 動いているプロセスがSIGUSR2を受けると，forkして新しいバイナリをexecする．
+ *    リッスンソケットはexec後も開いたまま残し，FDとポートを環境変数で渡す
+ * 2. 新しいプロセスは，同じポートのソケットをbindし直さずにそのまま使う
+ *    （ポートが閉じる時間がないので，接続を拒否しない）
+ * 3. 新しいプロセスはリッスンの準備ができたら，古いプロセスにSIGQUITを送る．
+ *    古いプロセスは新しい接続の受け付けをやめ，処理中の接続を終えてから終了する
+ *
+ * 新しいプロセスの起動に失敗した場合，古いプロセスはそのまま動き続ける
+ */
+class BinaryUpgrade {
+ public:
+  // execし直すときのコマンドライン（起動時に1度だけ設定する）
+  static void setArgv(char **argv);
+
+  /**
+   * @brief server_fdsを引き継いで新しいバイナリを起動する
+   * @return 起動したプロセスのID．forkに失敗した場合は-1
+   */
+  static pid_t spawn(const MultiPortServer &server);
+
+  /**
+   * @brief 環境変数から引き継いだリッスンソケットを読み込む
+   *
+   * 環境変数は読み込んだ時点で消す（CGIなどの子プロセスに渡さない）
+   */
+  static void loadInheritedListeners();
+
+  /**
+   * @brief portのリッスンソケットを引き継いでいれば，その所有権を渡す
+   * @return 引き継いだFD．なければ-1
+   */
+  static int takeInheritedListener(int port);
+
+  // 使われなかった（新しい設定にないポートの）ソケットを閉じる
+  static void closeInheritedListeners();
+
+  // 引き継ぎ元のプロセスに，リッスンの準備ができたことを伝える（SIGQUIT）
+  static void notifyParent();
+
+ private:
+  static char **_argv;
+  // ポートから引き継いだFDへの表
+  static std::map<int, int> _inherited;
+  static pid_t _parent;
+};
@@ -0,0 +1,119 @@
+#include "BodySink.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+
+// 一時ファイルから1回に読み出すバイト数
+#define BODY_COPY_BUFFER_SIZE (64 * 1024)
+
+bool FileBodySink::write(const char *data, size_t length) {
+  // 書き込みが途中で止まっても，全て書き終えるまで続ける
+  while (length > 0) {
+    ssize_t written = ::write(_fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+SpoolBodySink::SpoolBodySink(size_t threshold)
+    : _threshold(threshold), _size(0), _fd(-1) {}
+
+SpoolBodySink::~SpoolBodySink() { clear(); }
+
+bool SpoolBodySink::write(const char *data, size_t length) {
+  if (inMemory() && _memory.size() + length > _threshold && !spill()) {
+    return false;
+  }
+  if (inMemory()) {
+    _memory.append(data, length);
+  } else {
+    FileBodySink file(_fd);
+    if (!file.write(data, length)) {
+      return false;
+    }
+  }
+  _size += length;
+  return true;
+}
+
+bool SpoolBodySink::spill() {
+  std::string path = CLIENT_BODY_TEMP_PATH "/.webserv_body.XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    return false;
+  }
+  // 名前は要らないので消す（CGIの子プロセスには引き継がない）
+  unlink(path.c_str());
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  FileBodySink file(fd);
+  if (!file.write(_memory.data(), _memory.size())) {
+    close(fd);
+    return false;
+  }
+  _fd = fd;
+  // 以後はファイルに書くので，メモリは手放す
+  std::string().swap(_memory);
+  return true;
+}
+
+bool SpoolBodySink::copyTo(BodySink &sink) const {
+  if (inMemory()) {
+    return sink.write(_memory.data(), _memory.size());
+  }
+  // 書き込み位置を動かさないようにpreadで読む
+  char buffer[BODY_COPY_BUFFER_SIZE];
+  off_t offset = 0;
+  while (static_cast<size_t>(offset) < _size) {
+    ssize_t n = pread(_fd, buffer, sizeof(buffer), offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0 || !sink.write(buffer, n)) {
+      return false;
+    }
+    offset += n;
+  }
+  return true;
+}
+
+namespace {
+// 文字列に追記する受け取り先（readAll用）
+class StringBodySink : public BodySink {
+ public:
+  explicit StringBodySink(std::string &out) : _out(out) {}
+  bool write(const char *data, size_t length) {
+    _out.append(data, length);
+    return true;
+  }
+
+ private:
+  std::string &_out;
+};
+}  // namespace
+
+bool SpoolBodySink::readAll(std::string &result) const {
+  result.clear();
+  result.reserve(_size);
+  StringBodySink sink(result);
+  return copyTo(sink);
+}
+
+void SpoolBodySink::clear() {
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+  _memory.clear();
+  _size = 0;
+}
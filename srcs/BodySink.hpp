@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// メモリに置くボディの上限（超えた分は一時ファイルに書き出す）
+#define DEFAULT_CLIENT_BODY_BUFFER_SIZE (16 * 1024)
+// ボディを書き出す一時ファイルの置き場所
+#define CLIENT_BODY_TEMP_PATH "/tmp"
+
+/**
+ * @class BodySink
+ * @brief リクエストボディの受け取り先
+ *
+ * HTTPRequestParserは，チャンクを解いたボディを届いた分ずつwriteに渡す．
+ * ボディ全体を1つの文字列にまとめないので，アップロードの大きさに関わらず
+ * 接続ごとのメモリは受信バッファと受け取り先のバッファだけで済む
+ */
+class BodySink {
+ public:
+  virtual ~BodySink() {}
+
+  // ボディの続きを書き込む（書き込めなければfalse）
+  virtual bool write(const char *data, size_t length) = 0;
+};
+
+/**
+ * @class FileBodySink
+ * @brief ファイルディスクリプタ（ファイル・CGIの標準入力など）に書き込む
+ *
+ * fdは閉じない（開いた側が閉じる）
+ */
+class FileBodySink : public BodySink {
+ public:
+  explicit FileBodySink(int fd) : _fd(fd) {}
+
+  bool write(const char *data, size_t length);
+
+ private:
+  int _fd;
+};
+
+/**
+ * @class SpoolBodySink
+ * @brief threshold以下のボディはメモリに，超えたら一時ファイルに溜める
+ *
+ * 一時ファイルは作ってすぐにunlinkするので，閉じれば（clearかデストラクタ）
+ * 消える．溜めたボディはcopyToやreadAllで先頭から読み出せる
+ */
+class SpoolBodySink : public BodySink {
+ public:
+  explicit SpoolBodySink(size_t threshold = DEFAULT_CLIENT_BODY_BUFFER_SIZE);
+  ~SpoolBodySink();
+
+  bool write(const char *data, size_t length);
+
+  // これまでに書き込んだバイト数
+  size_t size() const { return _size; }
+  // ボディがメモリにあるか（なければ一時ファイルにある）
+  bool inMemory() const { return _fd < 0; }
+  // メモリにあるボディ（inMemoryの場合のみ）
+  const std::string &memory() const { return _memory; }
+  // 一時ファイル（inMemoryなら-1）
+  int fd() const { return _fd; }
+
+  // 溜めたボディを先頭からsinkに書き込む
+  bool copyTo(BodySink &sink) const;
+  // 溜めたボディ全体をresultに読み出す
+  bool readAll(std::string &result) const;
+
+  // 空に戻す（メモリは容量を残し，一時ファイルは閉じる）
+  void clear();
+
+ private:
+  size_t _threshold;
+  size_t _size;
+  std::string _memory;
+  int _fd;
+
+  // メモリの内容を一時ファイルに移す
+  bool spill();
+
+  // コピー防止（一時ファイルを二重に閉じないように）
+  SpoolBodySink(const SpoolBodySink &);
+  SpoolBodySink &operator=(const SpoolBodySink &);
+};
@@ -2,6 +2,7 @@
 
 #include <dirent.h>  // ディレクトリの内容を読み取るために追加
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/time.h>  // select() 用に追加
 #include <sys/wait.h>
@@ -15,17 +16,65 @@
 #include <map>
 #include <sstream>
 
-CGI::CGI(Directive rootDirective, HTTPRequest httpRequest)
-    : _rootDirective(rootDirective), _httpRequest(httpRequest) {
-  // CGI_PAGEファイルが存在する場合は削除
-  std::ifstream tempFile(CGI_PAGE);
+namespace {
+// スレッドごとのパス（std::string*）
+pthread_key_t cgiPagePathKey;
+// パスに含めるスレッドの通し番号
+int cgiPageCount = 0;
+
+void deleteCGIPagePath(void* path) { delete static_cast<std::string*>(path); }
+
+// 呼び出したスレッドのパスを，PIDとスレッドの通し番号で組み立てる
+void resetCGIPagePath() {
+  std::string* path =
+      static_cast<std::string*>(pthread_getspecific(cgiPagePathKey));
+  if (path == NULL) {
+    path = new std::string();
+    pthread_setspecific(cgiPagePathKey, path);
+  }
+  std::ostringstream oss;
+  oss << "/tmp/.cgi_response." << getpid() << "."
+      << __sync_add_and_fetch(&cgiPageCount, 1) << ".html";
+  *path = oss.str();
+}
+
+// 起動時に1度だけキーを作り，forkした子プロセスでは自分のPIDで組み立て直す
+struct CGIPagePathInit {
+  CGIPagePathInit() {
+    pthread_key_create(&cgiPagePathKey, deleteCGIPagePath);
+    pthread_atfork(NULL, NULL, resetCGIPagePath);
+  }
+} cgiPagePathInit;
+}  // namespace
+
+const std::string& getCGIPagePath() {
+  std::string* path =
+      static_cast<std::string*>(pthread_getspecific(cgiPagePathKey));
+  if (path == NULL) {
+    // スレッドで最初に呼ばれたときに組み立てる
+    resetCGIPagePath();
+    path = static_cast<std::string*>(pthread_getspecific(cgiPagePathKey));
+  }
+  return *path;
+}
+
+// CGIの応答ファイルが存在する場合は削除
+static void removeCGIPage() {
+  std::ifstream tempFile(getCGIPagePath().c_str());
   if (tempFile.good()) {
     tempFile.close();
-    std::remove(CGI_PAGE);
+    std::remove(getCGIPagePath().c_str());
   }
 }
 
-CGI::~CGI() {}
+CGI::CGI(const Directive& rootDirective, const HTTPRequest& httpRequest)
+    : ContextHandler(rootDirective, httpRequest) {
+  removeCGIPage();
+}
+
+CGI::CGI(RequestContext& context) : ContextHandler(context) {
+  removeCGIPage();
+}
 
 bool CGI::isSupportedScript(const std::string& url) const {
   // クエリパラメータを削除
@@ -92,20 +141,18 @@ std::string CGI::getScriptPath() const {
     url = url.substr(0, queryPos);
   }
 
-  // ホストディレクティブからrootの値を取得
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
+  // ホストのrootの値を取得
+  if (_server != NULL) {
+    rootValue = _server->root;
   }
 
   // URLがディレクトリの場合（GenerateHTTPResponseと同様の処理）
   if (isDirectory(url)) {
     // インデックスファイルを探す
-    const Directive* indexDirective = _rootDirective.findDirective(
-        _httpRequest.getServerName(), "location", url);
-    if (indexDirective != NULL) {
-      std::string indexValue = indexDirective->getValue("index");
+    const RouteTable::Location* location =
+        _server != NULL ? _server->findLocation(url) : NULL;
+    if (location != NULL) {
+      const std::string& indexValue = location->index;
       if (!indexValue.empty() && isSupportedScript(indexValue)) {
         return rootValue + url + indexValue;
       }
@@ -182,23 +229,26 @@ char** CGI::setupEnvironment(const std::string& scriptPath) {
   }
 
   // コンテンツ情報
-  if (!_httpRequest.getHeader("Content-Length").empty()) {
-    env["CONTENT_LENGTH"] = _httpRequest.getHeader("Content-Length");
+  const std::string& contentLength =
+      _httpRequest.getHeader(HTTPHeaders::CONTENT_LENGTH);
+  if (!contentLength.empty()) {
+    env["CONTENT_LENGTH"] = contentLength;
   }
-  if (!_httpRequest.getHeader("Content-Type").empty()) {
-    env["CONTENT_TYPE"] = _httpRequest.getHeader("Content-Type");
+  const std::string& contentType =
+      _httpRequest.getHeader(HTTPHeaders::CONTENT_TYPE);
+  if (!contentType.empty()) {
+    env["CONTENT_TYPE"] = contentType;
   }
 
   // HTTPヘッダー情報
-  const std::map<std::string, std::string>& headers = _httpRequest.getHeaders();
-  for (std::map<std::string, std::string>::const_iterator it = headers.begin();
-       it != headers.end(); ++it) {
-    std::string name = "HTTP_" + it->first;
+  const HTTPHeaders& headers = _httpRequest.getHeaders();
+  for (size_t h = 0; h < headers.size(); ++h) {
+    std::string name = "HTTP_" + headers[h].name;
     // '-'を'_'に置換
     for (size_t i = 0; i < name.length(); i++) {
       if (name[i] == '-') name[i] = '_';
     }
-    env[name] = it->second;
+    env[name] = headers[h].value;
   }
 
   // 環境変数を文字列配列に変換
@@ -245,7 +295,10 @@ bool CGI::executeCGI(const std::string& scriptPath) {
   scriptFile.close();
 
   // 既存のCGI出力ファイルを削除
-  std::remove(CGI_PAGE);  // unlink の代わりに std::remove を使用
+  // unlink の代わりに std::remove を使用
+  std::remove(getCGIPagePath().c_str());
+  // 子プロセスではPIDが変わるので，fork前にパスを決めておく
+  const std::string cgiPage = getCGIPagePath();
 
   // 環境変数を設定
   char** envp = setupEnvironment(scriptPath);
@@ -261,7 +314,7 @@ bool CGI::executeCGI(const std::string& scriptPath) {
     // 子プロセス
 
     // CGI出力をファイルにリダイレクト
-    int fd = open(CGI_PAGE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int fd = open(cgiPage.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (fd == -1) {
       std::exit(1);
     }
@@ -271,15 +324,24 @@ bool CGI::executeCGI(const std::string& scriptPath) {
     close(fd);
 
     // POSTデータを標準入力から読めるようにする場合
-    if (_httpRequest.getMethod() == "POST" && !_httpRequest.getBody().empty()) {
+    int bodyFd = _httpRequest.getBodyFd();
+    if (_httpRequest.getMethod() == "POST" && bodyFd != -1) {
+      // パーサーが一時ファイルに溜めたボディは，コピーせずに標準入力にする
+      // （親はpreadで読むので，ファイル位置を先頭に戻してよい）
+      lseek(bodyFd, 0, SEEK_SET);
+      dup2(bodyFd, STDIN_FILENO);
+    } else if (_httpRequest.getMethod() == "POST" &&
+               !_httpRequest.getBody().empty()) {
       // 一時ファイルにPOSTデータを書き込む
-      std::string tmpFile = "/tmp/.cgi_post_data";
+      std::string tmpFile = cgiPage + ".post_data";
       std::ofstream postData(tmpFile.c_str(), std::ios::binary);
       postData << _httpRequest.getBody();
       postData.close();
 
       // 標準入力をPOSTデータから読む
       int inFd = open(tmpFile.c_str(), O_RDONLY);
+      // 開いたFDは残るので，ファイル自体はすぐに消してよい
+      std::remove(tmpFile.c_str());
       if (inFd != -1) {
         dup2(inFd, STDIN_FILENO);
         close(inFd);
@@ -358,8 +420,8 @@ bool CGI::executeCGI(const std::string& scriptPath) {
       if (result > 0) {
         // 子プロセス終了
         // スクリプトが正常に実行された場合はtrueを返す
-        // 終了コードに関わらずCGI_PAGEファイルが存在するか確認
-        std::ifstream testFile(CGI_PAGE);
+        // 終了コードに関わらずCGIの応答ファイルが存在するか確認
+        std::ifstream testFile(getCGIPagePath().c_str());
         bool exists = testFile.good();
         testFile.close();
         return exists;
@@ -378,7 +440,7 @@ bool CGI::executeCGI(const std::string& scriptPath) {
 
 bool CGI::readCGIResponse() {
   // CGI実行結果ファイルが存在し、読み取り可能か確認
-  std::ifstream cgiOutput(CGI_PAGE);
+  std::ifstream cgiOutput(getCGIPagePath().c_str());
   if (!cgiOutput.is_open()) {
     return false;
   }
@@ -426,10 +488,10 @@ void CGI::handleRequest(HTTPResponse& httpResponse) {
     bool hasIndexScript = false;
 
     // indexディレクティブをチェック
-    const Directive* indexDirective = _rootDirective.findDirective(
-        _httpRequest.getServerName(), "location", _httpRequest.getURL());
-    if (indexDirective != NULL) {
-      std::string indexValue = indexDirective->getValue("index");
+    const RouteTable::Location* location =
+        _server != NULL ? _server->findLocation(_httpRequest.getURL()) : NULL;
+    if (location != NULL) {
+      const std::string& indexValue = location->index;
       if (!indexValue.empty() && isSupportedScript(indexValue)) {
         // インデックスファイルが存在するか確認
         std::ifstream indexFile((scriptPath).c_str());
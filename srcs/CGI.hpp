@@ -5,21 +5,23 @@
 
 #include <string>
 
+#include "ContextHandler.hpp"
 #include "Directive.hpp"
 #include "HTTPRequest.hpp"
 #include "HTTPResponse.hpp"
-#include "Handler.hpp"
+#include "RequestContext.hpp"
 
-// CGIの応答を保存するファイルのパス
-#define CGI_PAGE "/tmp/.cgi_response.html"
 // CGI実行のタイムアウト（秒）
 #define CGI_TIMEOUT 30
 
-class CGI : public Handler {
- private:
-  Directive _rootDirective;
-  HTTPRequest _httpRequest;
+// CGIの応答を保存するファイルのパス（/tmp/.cgi_response.<pid>.<n>.html）
+// worker_processes・worker_threadsで複数のプロセス・スレッドが同時にCGIを
+// 実行しても衝突しないよう，PIDとスレッドの通し番号nを含める
+// （スレッドごとに最初の呼び出しで組み立て，forkした子プロセスでは組み直す）
+const std::string& getCGIPagePath();
 
+class CGI : public ContextHandler {
+ private:
   // CGIスクリプトを実行するためのメソッド
   bool executeCGI(const std::string& scriptPath);
 
@@ -39,8 +41,8 @@ class CGI : public Handler {
   std::string generateDirectoryListing(const std::string& dirPath) const;
 
  public:
-  CGI(Directive rootDirective, HTTPRequest httpRequest);
-  ~CGI();
+  CGI(const Directive& rootDirective, const HTTPRequest& httpRequest);
+  explicit CGI(RequestContext& context);
 
   void handleRequest(HTTPResponse& httpResponse);
 };
@@ -0,0 +1,683 @@
+#include "ConfigCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+#include "TOMLParser.hpp"
+
+#define CONFIG_CACHE_MAGIC "WSCONFIG"
+#define CONFIG_CACHE_MAGIC_SIZE 8
+// マジック，バージョン，stat（大きさ・i-node・秒は2つずつ，ナノ秒は1つ），
+// ハッシュを確かめるか，ハッシュ（2つ），本体の長さ
+#define CONFIG_CACHE_HEADER_SIZE (CONFIG_CACHE_MAGIC_SIZE + 4 * 15)
+// 設定ファイルの時刻がこの秒数より新しければ，中身のハッシュでも確かめる
+#define CONFIG_CACHE_RACY_SECONDS 2
+
+// 設定ファイルのstatのうち，変わったことを見分けるもの
+namespace {
+struct SourceStamp {
+  unsigned long size;
+  unsigned long inode;
+  unsigned long mtime;
+  unsigned long mtimeNsec;
+  unsigned long ctime;
+  unsigned long ctimeNsec;
+};
+
+// 設定ファイルの中身のハッシュ（FNV-1aとdjb2，32ビットずつ）
+struct SourceHash {
+  unsigned long fnv;
+  unsigned long djb;
+};
+}  // namespace
+
+static SourceStamp sourceStamp(const struct stat &st) {
+  SourceStamp stamp;
+  stamp.size = static_cast<unsigned long>(st.st_size);
+  stamp.inode = static_cast<unsigned long>(st.st_ino);
+  stamp.mtime = static_cast<unsigned long>(st.st_mtime);
+  stamp.ctime = static_cast<unsigned long>(st.st_ctime);
+#ifdef __linux__
+  stamp.mtimeNsec = static_cast<unsigned long>(st.st_mtim.tv_nsec);
+  stamp.ctimeNsec = static_cast<unsigned long>(st.st_ctim.tv_nsec);
+#else
+  stamp.mtimeNsec = static_cast<unsigned long>(st.st_mtimespec.tv_nsec);
+  stamp.ctimeNsec = static_cast<unsigned long>(st.st_ctimespec.tv_nsec);
+#endif
+  return stamp;
+}
+
+static bool operator==(const SourceStamp &a, const SourceStamp &b) {
+  return a.size == b.size && a.inode == b.inode && a.mtime == b.mtime &&
+         a.mtimeNsec == b.mtimeNsec && a.ctime == b.ctime &&
+         a.ctimeNsec == b.ctimeNsec;
+}
+
+// 書き出す時点で変わったばかりなら，同じ時刻のまま書き換えられうる
+static bool isRacy(const SourceStamp &stamp) {
+  unsigned long now = static_cast<unsigned long>(std::time(NULL));
+  return stamp.mtime + CONFIG_CACHE_RACY_SECONDS > now ||
+         stamp.ctime + CONFIG_CACHE_RACY_SECONDS > now;
+}
+
+static bool readSource(const std::string &confPath, std::string &content) {
+  std::ifstream file(confPath.c_str(), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  content.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+static SourceHash sourceHash(const std::string &content) {
+  SourceHash hash;
+  hash.fnv = 2166136261UL;
+  hash.djb = 5381;
+  for (size_t i = 0; i < content.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(content[i]);
+    hash.fnv = ((hash.fnv ^ c) * 16777619UL) & 0xffffffffUL;
+    hash.djb = (hash.djb * 33 + c) & 0xffffffffUL;
+  }
+  return hash;
+}
+
+// 書き出し
+
+class ConfigCache::Writer {
+ public:
+  explicit Writer(std::string &out) : _out(out) {}
+
+  void appendU32(unsigned long value) {
+    for (int i = 0; i < 4; ++i) {
+      _out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+  }
+
+  // 上位・下位の32ビットに分けて書く（32ビットのlongでもシフトが範囲内になるようにする）
+  void appendU64(unsigned long value) {
+    appendU32((value >> 16) >> 16);
+    appendU32(value & 0xffffffffUL);
+  }
+
+  // 負の数（空きを表す-1など）は2の補数で書く
+  void appendInt(int value) {
+    appendU32(static_cast<unsigned long>(static_cast<unsigned int>(value)));
+  }
+
+  void appendString(const std::string &value) {
+    appendU32(value.size());
+    _out += value;
+  }
+
+  void appendStrings(const std::vector<std::string> &values) {
+    appendU32(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      appendString(values[i]);
+    }
+  }
+
+  void appendKeyValues(const Directive::KVMap &values) {
+    appendU32(values.size());
+    for (Directive::KVMap::const_iterator it = values.begin();
+         it != values.end(); ++it) {
+      appendString(it->first);
+      appendStrings(it->second);
+    }
+  }
+
+  void appendStamp(const SourceStamp &stamp) {
+    appendU64(stamp.size);
+    appendU64(stamp.inode);
+    appendU64(stamp.mtime);
+    appendU32(stamp.mtimeNsec);
+    appendU64(stamp.ctime);
+    appendU32(stamp.ctimeNsec);
+  }
+
+  // 使っているスロットだけを，添字と一緒に並べる
+  template <typename Case>
+  void appendTable(const BasicStringTable<Case> &table) {
+    appendU32(table._slots.size());
+    appendU32(table._size);
+    for (size_t i = 0; i < table._slots.size(); ++i) {
+      const typename BasicStringTable<Case>::Slot &slot = table._slots[i];
+      if (slot.value != -1) {
+        appendU32(i);
+        appendString(slot.name);
+        appendU64(slot.hash);
+        appendInt(slot.value);
+      }
+    }
+  }
+
+  void appendTrie(const LocationTrie &trie) {
+    appendU32(trie._nodes.size());
+    for (size_t i = 0; i < trie._nodes.size(); ++i) {
+      const LocationTrie::Node &node = trie._nodes[i];
+      appendString(node.label);
+      appendInt(node.value);
+      appendU32(node.children.size());
+      for (size_t j = 0; j < node.children.size(); ++j) {
+        appendU32(node.children[j].first);
+        appendU32(node.children[j].second);
+      }
+    }
+  }
+
+  void appendRoute(const RouteTable::Route &route) {
+    appendKeyValues(route.values);
+    appendString(route.root);
+    appendString(route.index);
+    appendU32(route.autoindex);
+    appendString(route.redirect);
+    appendU32(route.denyMask);
+    appendStrings(route.denyOthers);
+  }
+
+  void appendServer(const RouteTable::VirtualServer &server) {
+    appendString(server.name);
+    appendString(server.root);
+    appendStrings(server.listen);
+    appendU32(server.errorPages.size());
+    for (std::map<int, std::string>::const_iterator it =
+             server.errorPages.begin();
+         it != server.errorPages.end(); ++it) {
+      appendInt(it->first);
+      appendString(it->second);
+    }
+    appendU32(server.mimeTypes.size());
+    for (std::map<std::string, std::string>::const_iterator it =
+             server.mimeTypes.begin();
+         it != server.mimeTypes.end(); ++it) {
+      appendString(it->first);
+      appendString(it->second);
+    }
+    appendU64(server.maxBodySize);
+    appendRoute(server.route);
+
+    appendU32(server.locations.size());
+    for (size_t i = 0; i < server.locations.size(); ++i) {
+      const RouteTable::Location &location = server.locations[i];
+      appendString(location.path);
+      appendU32(location.exact);
+      appendString(location.index);
+      appendString(location.limitExcept);
+      appendRoute(location.route);
+    }
+    appendTrie(server.prefixLocations);
+    appendU32(server.exactLocations.size());
+    for (std::map<std::string, size_t>::const_iterator it =
+             server.exactLocations.begin();
+         it != server.exactLocations.end(); ++it) {
+      appendString(it->first);
+      appendU32(it->second);
+    }
+  }
+
+  void appendSnapshot(const ConfigSnapshot &snapshot) {
+    appendU32(snapshot._values.size());
+    for (std::map<std::string, std::string>::const_iterator it =
+             snapshot._values.begin();
+         it != snapshot._values.end(); ++it) {
+      appendString(it->first);
+      appendString(it->second);
+    }
+    appendU32(snapshot._ports.size());
+    for (size_t i = 0; i < snapshot._ports.size(); ++i) {
+      appendInt(snapshot._ports[i]);
+    }
+
+    const RouteTable &routes = snapshot._routes;
+    appendU32(routes._servers.size());
+    for (size_t i = 0; i < routes._servers.size(); ++i) {
+      appendServer(routes._servers[i]);
+    }
+    appendTable(routes._serverNames);
+    appendU32(routes._listeners.size());
+    for (std::map<int, RouteTable::Listener>::const_iterator it =
+             routes._listeners.begin();
+         it != routes._listeners.end(); ++it) {
+      appendInt(it->second.port);
+      appendInt(it->second.defaultServer);
+      appendTable(it->second.names);
+      appendTable(it->second.wildcards);
+    }
+  }
+
+ private:
+  std::string &_out;
+};
+
+// 読み込み（mmapした領域を前から順に読む．足りない・壊れていればfalse）
+// 添字は範囲を確かめてから使う（壊れたキャッシュで範囲外を参照しない）
+
+class ConfigCache::Reader {
+ public:
+  Reader(const unsigned char *data, size_t length)
+      : _data(data), _remaining(length) {}
+
+  size_t remaining() const { return _remaining; }
+
+  bool readMagic() {
+    if (_remaining < CONFIG_CACHE_MAGIC_SIZE ||
+        std::memcmp(_data, CONFIG_CACHE_MAGIC, CONFIG_CACHE_MAGIC_SIZE) != 0) {
+      return false;
+    }
+    _data += CONFIG_CACHE_MAGIC_SIZE;
+    _remaining -= CONFIG_CACHE_MAGIC_SIZE;
+    return true;
+  }
+
+  bool readU32(unsigned long &value) {
+    if (_remaining < 4) {
+      return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= static_cast<unsigned long>(_data[i]) << (8 * i);
+    }
+    _data += 4;
+    _remaining -= 4;
+    return true;
+  }
+
+  bool readU64(unsigned long &value) {
+    unsigned long high;
+    unsigned long low;
+    if (!readU32(high) || !readU32(low)) {
+      return false;
+    }
+    value = ((high << 16) << 16) | low;
+    return true;
+  }
+
+  bool readInt(int &value) {
+    unsigned long bits;
+    if (!readU32(bits)) {
+      return false;
+    }
+    value = bits <= 0x7fffffffUL ? static_cast<int>(bits)
+                                 : -static_cast<int>(0xffffffffUL - bits) - 1;
+    return true;
+  }
+
+  // 要素数（1要素は4バイト以上なので，残りのバイト数を超える数は壊れている）
+  bool readCount(unsigned long &count) {
+    return readU32(count) && count <= _remaining / 4;
+  }
+
+  // limit未満の添字
+  bool readIndex(size_t &index, size_t limit) {
+    unsigned long value;
+    if (!readU32(value) || value >= limit) {
+      return false;
+    }
+    index = value;
+    return true;
+  }
+
+  bool readString(std::string &value) {
+    unsigned long length;
+    if (!readU32(length) || length > _remaining) {
+      return false;
+    }
+    value.assign(reinterpret_cast<const char *>(_data), length);
+    _data += length;
+    _remaining -= length;
+    return true;
+  }
+
+  bool readStrings(std::vector<std::string> &values) {
+    unsigned long count;
+    if (!readCount(count)) {
+      return false;
+    }
+    values.resize(count);
+    for (unsigned long i = 0; i < count; ++i) {
+      if (!readString(values[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // キーは昇順に書かれているので，末尾に足していく
+  bool readKeyValues(Directive::KVMap &values) {
+    unsigned long count;
+    if (!readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      std::string key;
+      if (!readString(key)) {
+        return false;
+      }
+      Directive::KVMap::iterator it = values.insert(
+          values.end(), std::make_pair(key, std::vector<std::string>()));
+      if (!readStrings(it->second)) {
+        return false;
+      }
+    }
+    return values.size() == count;
+  }
+
+  bool readStamp(SourceStamp &stamp) {
+    return readU64(stamp.size) && readU64(stamp.inode) &&
+           readU64(stamp.mtime) && readU32(stamp.mtimeNsec) &&
+           readU64(stamp.ctime) && readU32(stamp.ctimeNsec);
+  }
+
+  // 値はlimit未満の添字．探索が止まるよう，空きスロットが半分以上あること
+  template <typename Case>
+  bool readTable(BasicStringTable<Case> &table, size_t limit) {
+    unsigned long slotCount;
+    unsigned long size;
+    if (!readU32(slotCount) || !readCount(size) || slotCount == 0 ||
+        (slotCount & (slotCount - 1)) != 0 || size * 2 > slotCount) {
+      return false;
+    }
+    table._slots.assign(slotCount,
+                        typename BasicStringTable<Case>::Slot());
+    table._size = size;
+    for (unsigned long i = 0; i < size; ++i) {
+      size_t index;
+      size_t value;
+      if (!readIndex(index, slotCount)) {
+        return false;
+      }
+      typename BasicStringTable<Case>::Slot &slot = table._slots[index];
+      unsigned long hash;
+      if (slot.value != -1 || !readString(slot.name) || !readU64(hash) ||
+          !readIndex(value, limit)) {
+        return false;
+      }
+      slot.hash = hash;
+      slot.value = static_cast<int>(value);
+    }
+    return true;
+  }
+
+  // 値（-1は値なし）はlimit未満の添字．根以外の節は空でないラベルを持つ
+  bool readTrie(LocationTrie &trie, size_t limit) {
+    unsigned long nodeCount;
+    if (!readCount(nodeCount) || nodeCount == 0) {
+      return false;
+    }
+    trie._nodes.resize(nodeCount);
+    trie._size = 0;
+    for (unsigned long i = 0; i < nodeCount; ++i) {
+      LocationTrie::Node &node = trie._nodes[i];
+      unsigned long childCount;
+      if (!readString(node.label) || (i != 0 && node.label.empty()) ||
+          !readInt(node.value) || node.value < -1 ||
+          (node.value >= 0 && static_cast<size_t>(node.value) >= limit) ||
+          !readCount(childCount)) {
+        return false;
+      }
+      if (node.value != -1) {
+        ++trie._size;
+      }
+      node.children.resize(childCount);
+      for (unsigned long j = 0; j < childCount; ++j) {
+        size_t c;
+        size_t child;
+        if (!readIndex(c, 256) || !readIndex(child, nodeCount) || child == 0) {
+          return false;
+        }
+        node.children[j] = std::make_pair(static_cast<unsigned char>(c), child);
+      }
+    }
+    return true;
+  }
+
+  bool readRoute(RouteTable::Route &route) {
+    unsigned long autoindex;
+    unsigned long denyMask;
+    if (!readKeyValues(route.values) || !readString(route.root) ||
+        !readString(route.index) || !readU32(autoindex) ||
+        !readString(route.redirect) || !readU32(denyMask) ||
+        !readStrings(route.denyOthers)) {
+      return false;
+    }
+    route.autoindex = autoindex != 0;
+    route.denyMask = denyMask;
+    return true;
+  }
+
+  bool readServer(RouteTable::VirtualServer &server) {
+    unsigned long count;
+    if (!readString(server.name) || !readString(server.root) ||
+        !readStrings(server.listen) || !readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      int statusCode;
+      std::string page;
+      if (!readInt(statusCode) || !readString(page)) {
+        return false;
+      }
+      server.errorPages[statusCode] = page;
+    }
+    if (!readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      std::string extension;
+      std::string contentType;
+      if (!readString(extension) || !readString(contentType)) {
+        return false;
+      }
+      server.mimeTypes[extension] = contentType;
+    }
+    unsigned long maxBodySize;
+    if (!readU64(maxBodySize) || !readRoute(server.route) ||
+        !readCount(count)) {
+      return false;
+    }
+    server.maxBodySize = maxBodySize;
+
+    server.locations.resize(count);
+    for (unsigned long i = 0; i < count; ++i) {
+      RouteTable::Location &location = server.locations[i];
+      unsigned long exact;
+      if (!readString(location.path) || !readU32(exact) ||
+          !readString(location.index) || !readString(location.limitExcept) ||
+          !readRoute(location.route)) {
+        return false;
+      }
+      location.exact = exact != 0;
+    }
+    if (!readTrie(server.prefixLocations, count) || !readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      std::string path;
+      size_t index;
+      if (!readString(path) || !readIndex(index, server.locations.size())) {
+        return false;
+      }
+      server.exactLocations[path] = index;
+    }
+    return true;
+  }
+
+  bool readSnapshot(ConfigSnapshot &snapshot) {
+    unsigned long count;
+    if (!readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      std::string key;
+      std::string value;
+      if (!readString(key) || !readString(value)) {
+        return false;
+      }
+      snapshot._values.insert(snapshot._values.end(),
+                              std::make_pair(key, value));
+    }
+    if (!readCount(count)) {
+      return false;
+    }
+    snapshot._ports.resize(count);
+    for (unsigned long i = 0; i < count; ++i) {
+      if (!readInt(snapshot._ports[i])) {
+        return false;
+      }
+    }
+
+    RouteTable &routes = snapshot._routes;
+    if (!readCount(count)) {
+      return false;
+    }
+    routes._servers.resize(count);
+    for (unsigned long i = 0; i < count; ++i) {
+      if (!readServer(routes._servers[i])) {
+        return false;
+      }
+    }
+    if (!readTable(routes._serverNames, routes._servers.size()) ||
+        !readCount(count)) {
+      return false;
+    }
+    for (unsigned long i = 0; i < count; ++i) {
+      RouteTable::Listener listener;
+      if (!readInt(listener.port) || !readInt(listener.defaultServer) ||
+          listener.defaultServer < -1 ||
+          (listener.defaultServer >= 0 &&
+           static_cast<size_t>(listener.defaultServer) >=
+               routes._servers.size()) ||
+          !readTable(listener.names, routes._servers.size()) ||
+          !readTable(listener.wildcards, routes._servers.size())) {
+        return false;
+      }
+      routes._listeners[listener.port] = listener;
+    }
+    return true;
+  }
+
+ private:
+  const unsigned char *_data;
+  size_t _remaining;
+};
+
+std::string ConfigCache::cachePath(const std::string &confPath) {
+  return confPath + ".cache";
+}
+
+bool ConfigCache::compile(const std::string &confPath) {
+  // 読み込む前のstatを記録する（読んだ後に書き換えられても，古い中身に
+  // 新しいstatを付けない）
+  struct stat st;
+  std::string content;
+  if (stat(confPath.c_str(), &st) != 0 || !readSource(confPath, content)) {
+    return false;
+  }
+  SourceStamp stamp = sourceStamp(st);
+  bool racy = isRacy(stamp);
+  SourceHash hash = sourceHash(content);
+
+  TOMLParser tomlParser;
+  Directive *rootDirective = tomlParser.parseFromString(content);
+  if (rootDirective == NULL) {
+    return false;
+  }
+  ConfigSnapshot *snapshot = new ConfigSnapshot(confPath, *rootDirective);
+  delete rootDirective;
+
+  std::string body;
+  Writer(body).appendSnapshot(*snapshot);
+  snapshot->release();
+
+  std::string out(CONFIG_CACHE_MAGIC, CONFIG_CACHE_MAGIC_SIZE);
+  Writer header(out);
+  header.appendU32(CONFIG_CACHE_VERSION);
+  header.appendStamp(stamp);
+  header.appendU32(racy);
+  header.appendU32(hash.fnv);
+  header.appendU32(hash.djb);
+  header.appendU32(body.size());
+  out += body;
+
+  // 読み込み中のプロセスが書きかけのキャッシュを見ないように，renameで置き換える
+  std::string path = cachePath(confPath);
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(out.data(), out.size())) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+ConfigSnapshot *ConfigCache::load(const std::string &confPath) {
+  // 設定ファイルはstatだけを見る（中身を読むのはハッシュを確かめる場合だけ）
+  struct stat st;
+  if (stat(confPath.c_str(), &st) != 0) {
+    return NULL;
+  }
+  SourceStamp source = sourceStamp(st);
+
+  int fd = open(cachePath(confPath).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0 || st.st_size < CONFIG_CACHE_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+  size_t length = static_cast<size_t>(st.st_size);
+  void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return NULL;
+  }
+
+  Reader reader(static_cast<const unsigned char *>(mapped), length);
+  unsigned long version;
+  SourceStamp stamp;
+  unsigned long racy;
+  SourceHash hash;
+  unsigned long bodyLength;
+  bool valid = reader.readMagic() && reader.readU32(version) &&
+               version == CONFIG_CACHE_VERSION && reader.readStamp(stamp) &&
+               stamp == source && reader.readU32(racy) &&
+               reader.readU32(hash.fnv) && reader.readU32(hash.djb) &&
+               reader.readU32(bodyLength) &&
+               bodyLength == reader.remaining();
+  // 設定ファイルが変わったばかりのときに作ったキャッシュは，中身でも確かめる
+  std::string content;
+  if (valid && racy) {
+    valid = readSource(confPath, content);
+  }
+  if (valid && racy) {
+    SourceHash current = sourceHash(content);
+    valid = current.fnv == hash.fnv && current.djb == hash.djb;
+  }
+
+  ConfigSnapshot *snapshot = NULL;
+  if (valid) {
+    snapshot = new ConfigSnapshot(confPath);
+    // 本体の後に余りがあっても壊れている
+    if (!reader.readSnapshot(*snapshot) || reader.remaining() != 0) {
+      snapshot->release();
+      snapshot = NULL;
+    }
+  }
+  munmap(mapped, length);
+  return snapshot;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include "ConfigSnapshot.hpp"
+
+// キャッシュの形式を変えたら上げる（古い形式のキャッシュは使わない）
+#define CONFIG_CACHE_VERSION 3
+
+/**
+ * @class ConfigCache
+ * @brief 読み込み時に作る設定（ConfigSnapshotの中身）をバイナリで保存し，
+ *        起動・再読み込み時にそのまま復元する
+ *
+ * webserv --compile-config で"<設定ファイル>.cache"を作っておくと，
+ * 設定ファイルをパースする代わりに，キャッシュをmmapしてルーティング表
+ * （ホスト・location・LocationTrieの節・HostTableのスロット・ポートごとの
+ * 索引）とトップレベルの値・ポートを復元する．Directiveの木は作らず，
+ * RouteTableへの変換もしない．
+ *
+ * キャッシュには元の設定ファイルのstat（大きさ・i-node・更新時刻と
+ * 状態変更時刻をナノ秒まで）を記録し，変わっていれば使わない
+ * （TOMLを読み直す）．
+ * 設定ファイルが変わってから時刻の粒度（CONFIG_CACHE_RACY_SECONDS）のうちに
+ * 作ったキャッシュは，同じ時刻のまま書き換えられても気づけるよう中身の
+ * ハッシュも記録し，読み込み時に設定ファイルを読んで確かめる
+ *
+ * 形式（整数はリトルエンディアンの32ビット，大きなものは上位・下位の2つ）:
+ * - ヘッダー: "WSCONFIG"，バージョン，設定ファイルのstat，ハッシュを
+ *   確かめるか，中身のハッシュ（FNV-1aとdjb2），本体の長さ
+ * - 本体: トップレベルの値，ポート，ホスト（locationとLocationTrieを含む），
+ *   ホスト名の表，ポートごとの索引．文字列は長さに続けて中身を置く
+ */
+class ConfigCache {
+ public:
+  // confPathのキャッシュのパス
+  static std::string cachePath(const std::string &confPath);
+
+  /**
+   * @brief confPathをTOMLとしてパースし，キャッシュを書き出す
+   * @return パースまたは書き込みに失敗した場合はfalse
+   */
+  static bool compile(const std::string &confPath);
+
+  /**
+   * @brief confPathのキャッシュからスナップショットを作る（参照カウント1）
+   * @return キャッシュがない・古い・壊れている場合はNULL
+   */
+  static ConfigSnapshot *load(const std::string &confPath);
+
+ private:
+  // スナップショットとルーティング表の中身を直接読み書きする
+  class Writer;
+  class Reader;
+};
@@ -0,0 +1,72 @@
+#include "ConfigSnapshot.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "ConfigCache.hpp"
+#include "TOMLParser.hpp"
+
+// ディレクティブ以下（子を含む）の値を前から順に集める（先に見つけた値が優先）
+static void collectValues(const Directive &directive,
+                          std::map<std::string, std::string> &values) {
+  const Directive::KVMap &keyValues = directive.keyValues();
+  for (Directive::KVMap::const_iterator it = keyValues.begin();
+       it != keyValues.end(); ++it) {
+    if (!it->second.empty()) {
+      values.insert(std::make_pair(it->first, it->second[0]));
+    }
+  }
+  for (size_t i = 0; i < directive.children().size(); ++i) {
+    collectValues(directive.children()[i], values);
+  }
+}
+
+ConfigSnapshot::ConfigSnapshot(const std::string &path)
+    : _path(path), _refCount(1) {}
+
+ConfigSnapshot::ConfigSnapshot(const std::string &path,
+                               const Directive &rootDirective)
+    : _path(path), _routes(rootDirective), _refCount(1) {
+  collectValues(rootDirective, _values);
+
+  // ポート番号を取得（複数のホストが同じポートをリッスンしても1度だけbindする）
+  std::vector<std::string> listen = rootDirective.getValues("listen");
+  for (size_t i = 0; i < listen.size(); ++i) {
+    std::istringstream iss(listen[i]);
+    int port;
+    if (iss >> port) {
+      _ports.push_back(port);
+    }
+  }
+  std::sort(_ports.begin(), _ports.end());
+  _ports.erase(std::unique(_ports.begin(), _ports.end()), _ports.end());
+}
+
+ConfigSnapshot *ConfigSnapshot::load(const std::string &path) {
+  // --compile-configで作ったキャッシュが新しければ，TOMLをパースせずに使う
+  ConfigSnapshot *snapshot = ConfigCache::load(path);
+  if (snapshot != NULL) {
+    return snapshot;
+  }
+  TOMLParser toml_parser;
+  Directive *rootDirective = toml_parser.parseFromFile(path);
+  if (rootDirective == NULL) {
+    return NULL;
+  }
+  snapshot = new ConfigSnapshot(path, *rootDirective);
+  delete rootDirective;
+  return snapshot;
+}
+
+void ConfigSnapshot::retain() { __sync_add_and_fetch(&_refCount, 1); }
+
+void ConfigSnapshot::release() {
+  if (__sync_sub_and_fetch(&_refCount, 1) == 0) {
+    delete this;
+  }
+}
+
+std::string ConfigSnapshot::getValue(const std::string &key) const {
+  std::map<std::string, std::string>::const_iterator it = _values.find(key);
+  return it != _values.end() ? it->second : "";
+}
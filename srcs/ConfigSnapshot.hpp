@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Directive.hpp"
+#include "RouteTable.hpp"
+
+/**
+ * @class ConfigSnapshot
+ * @brief 設定ファイルを1度だけパースした，変更されない設定のスナップショット
+ *
+ * リクエストの処理ではファイルを読み直さず，このスナップショットの
+ * ルーティング表（読み込み時に1度だけ変換したもの）を参照する．
+ * パースしたDirectiveの木は変換した後に手放す（キャッシュからは作らない）．
+ * リロード時は新しいスナップショットを作って差し替え，古いスナップショットは
+ * 参照している箇所がなくなった時点で解放される（参照カウント）．
+ */
+class ConfigSnapshot {
+ public:
+  /**
+   * @brief 設定ファイルをパースしてスナップショットを作る
+   * @note 設定ファイルのキャッシュ（ConfigCache）が新しければそれを読み込む
+   * @return パースに失敗した場合はNULL．成功した場合は参照カウント1
+   */
+  static ConfigSnapshot *load(const std::string &path);
+
+  // 参照カウントの増減（スレッド間で共有してよい）．0になると解放される
+  void retain();
+  void release();
+
+  const std::string &getPath() const { return _path; }
+  const RouteTable &getRouteTable() const { return _routes; }
+
+  // トップレベルの設定値（event_backendなど）．なければ空文字列
+  std::string getValue(const std::string &key) const;
+
+  // 全ホストのlistenを重複なく並べたもの
+  const std::vector<int> &getPorts() const { return _ports; }
+
+ private:
+  // キャッシュの読み書きは中身を直接扱う
+  friend class ConfigCache;
+
+  std::string _path;
+  RouteTable _routes;
+  // getValueの値（Directiveの木を前から順に探して最初に見つかった値）
+  std::map<std::string, std::string> _values;
+  std::vector<int> _ports;
+  int _refCount;
+
+  // 空のスナップショット（キャッシュから中身を埋める）
+  explicit ConfigSnapshot(const std::string &path);
+  ConfigSnapshot(const std::string &path, const Directive &rootDirective);
+  ~ConfigSnapshot() {}
+
+  // コピー防止（参照カウントで共有する）
+  ConfigSnapshot(const ConfigSnapshot &);
+  ConfigSnapshot &operator=(const ConfigSnapshot &);
+};
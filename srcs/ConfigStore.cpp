@@ -0,0 +1,64 @@
+#include "ConfigStore.hpp"
+
+#include <iostream>
+
+ConfigStore::ConfigStore(ConfigSnapshot *snapshot)
+    : _current(snapshot), _generation(0) {
+  pthread_mutex_init(&_mutex, NULL);
+}
+
+ConfigStore::~ConfigStore() {
+  if (_current != NULL) {
+    _current->release();
+  }
+  pthread_mutex_destroy(&_mutex);
+}
+
+ConfigSnapshot *ConfigStore::acquire(unsigned long *generation) {
+  pthread_mutex_lock(&_mutex);
+  ConfigSnapshot *snapshot = _current;
+  if (snapshot != NULL) {
+    snapshot->retain();
+  }
+  if (generation != NULL) {
+    *generation = _generation;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return snapshot;
+}
+
+unsigned long ConfigStore::getGeneration() const {
+  pthread_mutex_lock(&_mutex);
+  unsigned long generation = _generation;
+  pthread_mutex_unlock(&_mutex);
+  return generation;
+}
+
+bool ConfigStore::reload() {
+  std::string path;
+  pthread_mutex_lock(&_mutex);
+  if (_current != NULL) {
+    path = _current->getPath();
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  // パースはロックの外で行い，差し替えだけをロックの中で行う
+  ConfigSnapshot *snapshot = ConfigSnapshot::load(path);
+  if (snapshot == NULL) {
+    std::cerr << "Failed to reload " << path
+              << ", keeping the current configuration" << std::endl;
+    return false;
+  }
+
+  pthread_mutex_lock(&_mutex);
+  ConfigSnapshot *old = _current;
+  _current = snapshot;
+  ++_generation;
+  pthread_mutex_unlock(&_mutex);
+
+  // 古い設定は，まだ参照しているワーカーが手放した時点で解放される
+  if (old != NULL) {
+    old->release();
+  }
+  return true;
+}
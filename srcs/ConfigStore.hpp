@@ -0,0 +1,43 @@
+#pragma once
+
+#include <pthread.h>
+
+#include "ConfigSnapshot.hpp"
+
+/**
+ * @class ConfigStore
+ * @brief ワーカー間で共有する「現在の設定」を保持し，再読み込みで差し替える
+ *
+ * 差し替えるたびに世代番号が増える．各ワーカーはイベントループの周回ごとに
+ * 世代番号を比べ，変わっていれば新しいスナップショットを取り直す．
+ * 処理中の接続は取得済みの（古い）スナップショットを参照したまま処理を終える
+ */
+class ConfigStore {
+ public:
+  // snapshotの参照を1つ引き取る
+  explicit ConfigStore(ConfigSnapshot *snapshot);
+  ~ConfigStore();
+
+  /**
+   * @brief 現在の設定を参照カウントを増やして返す（使い終わったらrelease）
+   * @param generation NULLでなければ，返した設定の世代番号を入れる
+   */
+  ConfigSnapshot *acquire(unsigned long *generation = NULL);
+
+  unsigned long getGeneration() const;
+
+  /**
+   * @brief 設定ファイルを読み直して差し替える
+   * @return パースに失敗した場合はfalse（現在の設定のまま）
+   */
+  bool reload();
+
+ private:
+  mutable pthread_mutex_t _mutex;
+  ConfigSnapshot *_current;
+  unsigned long _generation;
+
+  // コピー防止
+  ConfigStore(const ConfigStore &);
+  ConfigStore &operator=(const ConfigStore &);
+};
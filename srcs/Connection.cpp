@@ -0,0 +1,104 @@
+#include "Connection.hpp"
+
+#include <cerrno>
+#include <cstdio>
+
+// 1回のrecvで読み込む最大バイト数
+#define RECV_BUFFER_SIZE 4096
+
+Connection::Connection(int fd, int port)
+    : _fd(fd),
+      _port(port),
+      _phase(READING),
+      _writeOffset(0),
+      _keepAlive(false),
+      _requestCount(0),
+      _headerChecked(false),
+      _deadline(HEADER_DEADLINE),
+      _config(NULL),
+      _listener(NULL) {
+  _timer.fd = fd;
+}
+
+Connection::~Connection() { setConfig(NULL); }
+
+void Connection::setConfig(ConfigSnapshot *config) {
+  if (config != NULL) {
+    config->retain();
+  }
+  if (_config != NULL) {
+    _config->release();
+  }
+  _config = config;
+  _listener = NULL;
+}
+
+bool Connection::isRetryable(int error) {
+  return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+bool Connection::readFromSocket() {
+  char buffer[RECV_BUFFER_SIZE];
+
+  // pollでPOLLINが通知された時だけ呼ばれるので，1回のrecvでブロックすることはない
+  ssize_t bytes_read = recv(_fd, buffer, sizeof(buffer), 0);
+  if (bytes_read < 0) {
+    // 通知の後で読めなくなった・シグナルで中断した場合は，次の通知を待つ
+    if (isRetryable(errno)) {
+      return true;
+    }
+    perror("recv");
+    return false;
+  }
+  if (bytes_read == 0) {
+    return false;
+  }
+
+  // 受信したデータをパーサーに供給する（完了・エラーはパーサーが保持する）
+  _parser.feed(buffer, bytes_read);
+  return true;
+}
+
+bool Connection::isRequestComplete() const {
+  return _parser.isComplete() || _parser.hasError();
+}
+
+void Connection::queueResponse(const std::string &data) {
+  _writeBuffer.append(data);
+}
+
+bool Connection::writeToSocket() {
+  if (!hasPendingWrite()) {
+    return true;
+  }
+
+  ssize_t bytes_sent = send(_fd, _writeBuffer.data() + _writeOffset,
+                            _writeBuffer.size() - _writeOffset, MSG_NOSIGNAL);
+  if (bytes_sent < 0) {
+    // 送信バッファが一杯・シグナルで中断した場合は，次のPOLLOUTで送り直す
+    if (isRetryable(errno)) {
+      return true;
+    }
+    perror("send");
+    return false;
+  }
+  _writeOffset += bytes_sent;
+
+  // 全て送り終えたら送信キューを空にする
+  if (_writeOffset >= _writeBuffer.size()) {
+    _writeBuffer.clear();
+    _writeOffset = 0;
+  }
+  return true;
+}
+
+bool Connection::hasPendingWrite() const {
+  return _writeOffset < _writeBuffer.size();
+}
+
+void Connection::resetForNextRequest() {
+  _parser.startNextRequest();
+  _phase = READING;
+  _headerChecked = false;
+  ++_requestCount;
+}
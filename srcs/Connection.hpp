@@ -0,0 +1,119 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+#include "ConfigSnapshot.hpp"
+#include "HTTPRequestParser.hpp"
+#include "TimerWheel.hpp"
+
+// クライアント接続1本分の状態（受信バッファ・パーサー状態・送信キュー・フェーズ）を保持する
+// pollループから少しずつ駆動されるため，1つの接続が遅くても他の接続を止めない
+class Connection {
+ public:
+  // 接続のフェーズ
+  enum Phase {
+    READING,  // リクエストを受信中
+    WRITING,  // レスポンスを送信中
+    CLOSING   // 接続を閉じる
+  };
+
+  // 接続に設定されている期限の種類
+  enum Deadline {
+    HEADER_DEADLINE,     // リクエストヘッダーを受信し終えるまで
+    BODY_DEADLINE,       // ボディの受信の間隔
+    KEEPALIVE_DEADLINE,  // 次のリクエストが届くまで
+    SEND_DEADLINE        // レスポンスの送信の間隔
+  };
+
+  Connection(int fd, int port);
+  ~Connection();
+
+  int getFd() const { return _fd; }
+  int getPort() const { return _port; }
+  Phase getPhase() const { return _phase; }
+  void setPhase(Phase phase) { _phase = phase; }
+  HTTPRequestParser &getParser() { return _parser; }
+
+  /**
+   * @brief ソケットから1回だけ受信し，受け取ったデータをパーサーに供給する
+   * @return 切断または受信エラーの場合はfalse
+   *         （EAGAIN・EINTRでは何も受信せずにtrueを返す）
+   */
+  bool readFromSocket();
+
+  // リクエストの受信（パース）が終わったか
+  bool isRequestComplete() const;
+
+  // 送信キューにデータを追加する
+  void queueResponse(const std::string &data);
+
+  // 送信キュー（PrintResponseの出力先として使う）
+  std::string &getWriteBuffer() { return _writeBuffer; }
+
+  /**
+   * @brief 送信キューからソケットへ1回だけ送信する
+   * @return 送信エラーの場合はfalse
+   *         （EAGAIN・EINTRでは何も送信せずにtrueを返す）
+   */
+  bool writeToSocket();
+
+  // 未送信のデータが残っているか
+  bool hasPendingWrite() const;
+
+  // レスポンスを送り終えた後も接続を維持するか（keep-alive）
+  bool isKeepAlive() const { return _keepAlive; }
+  void setKeepAlive(bool keepAlive) { _keepAlive = keepAlive; }
+
+  // 受信中のリクエストのヘッダーを確かめ終えたか（ボディの上限・100-continue）
+  bool isHeaderChecked() const { return _headerChecked; }
+  void setHeaderChecked(bool checked) { _headerChecked = checked; }
+
+  // この接続で処理し終えたリクエストの数
+  size_t getRequestCount() const { return _requestCount; }
+
+  // 期限の管理（タイマーはTimerWheelにつながれる）
+  TimerWheel::Timer &getTimer() { return _timer; }
+  Deadline getDeadline() const { return _deadline; }
+  void setDeadline(Deadline deadline) { _deadline = deadline; }
+
+  // 接続を受け付けた時点の設定（設定を読み直しても，この接続では使い続ける）
+  // 参照カウントを1つ持ち，接続を閉じるときに手放す
+  ConfigSnapshot *getConfig() const { return _config; }
+  void setConfig(ConfigSnapshot *config);
+
+  // 受け付けたリスナーのホストの索引（getConfigの設定のもの．設定を替えると外れる）
+  const RouteTable::Listener *getListener() const { return _listener; }
+  void setListener(const RouteTable::Listener *listener) {
+    _listener = listener;
+  }
+
+  // 次のリクエストを受け付けられるよう，パーサーとフェーズを戻す
+  // 既に届いている後続のリクエスト（パイプライン）はそのまま解析される
+  void resetForNextRequest();
+
+ private:
+  int _fd;
+  int _port;
+  Phase _phase;
+  HTTPRequestParser _parser;
+  std::string _writeBuffer;
+  size_t _writeOffset;
+  bool _keepAlive;
+  size_t _requestCount;
+  bool _headerChecked;
+  TimerWheel::Timer _timer;
+  Deadline _deadline;
+  ConfigSnapshot *_config;
+  const RouteTable::Listener *_listener;
+
+  // 後で同じ操作をやり直せばよいエラーか
+  static bool isRetryable(int error);
+
+  // コピー防止（パーサーがコピー不可のため）
+  Connection(const Connection &);
+  Connection &operator=(const Connection &);
+};
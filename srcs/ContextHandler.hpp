@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Directive.hpp"
+#include "HTTPRequest.hpp"
+#include "Handler.hpp"
+#include "RequestContext.hpp"
+
+// RequestContextを参照するHandler（GET・POST・DELETE・CGI・レスポンス生成）
+// 文脈は鎖の外から借りるか，Directiveから作って自分で持つ
+class ContextHandler : public Handler {
+ protected:
+  // Directiveから作った場合の文脈（鎖の外から渡された場合はNULL）
+  RequestContext* _ownedContext;
+  RequestContext& _context;
+  HTTPRequest& _httpRequest;
+  const RouteTable::VirtualServer* _server;  // リクエストのホスト
+
+  ContextHandler(const Directive& rootDirective, const HTTPRequest& httpRequest)
+      : _ownedContext(new RequestContext(rootDirective, httpRequest)),
+        _context(*_ownedContext),
+        _httpRequest(_context.getRequest()),
+        _server(_context.getServer()) {}
+  explicit ContextHandler(RequestContext& context)
+      : _ownedContext(NULL),
+        _context(context),
+        _httpRequest(context.getRequest()),
+        _server(context.getServer()) {}
+
+ public:
+  virtual ~ContextHandler() { delete _ownedContext; }
+
+ private:
+  // コピー防止（_ownedContextを二重に解放しないように）
+  ContextHandler(const ContextHandler&);
+  ContextHandler& operator=(const ContextHandler&);
+};
@@ -11,12 +11,10 @@ std::string DeleteClientMethod::getFullPath() const {
     return "";
   }
 
-  // ホストディレクティブからrootの値を取得
+  // ホストのrootの値を取得
   std::string rootValue;
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
+  if (_server != NULL) {
+    rootValue = _server->root;
   }
 
   // URLとrootを結合して完全なパスを作成
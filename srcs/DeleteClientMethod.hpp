@@ -1,11 +1,12 @@
 #pragma once
 
+#include "ContextHandler.hpp"
 #include "Directive.hpp"
 #include "HTTPRequest.hpp"
 #include "HTTPResponse.hpp"
-#include "Handler.hpp"
+#include "RequestContext.hpp"
 
-class DeleteClientMethod : public Handler {
+class DeleteClientMethod : public ContextHandler {
  public:
   // ファイルの状態をチェックするための列挙型
   enum FileStatus {
@@ -16,17 +17,11 @@ class DeleteClientMethod : public Handler {
     FILE_OTHER_ERROR     // その他のエラー
   };
 
- protected:
-  HTTPRequest _httpRequest;
-  Directive _rootDirective;
-
- public:
-  DeleteClientMethod(HTTPRequest& _httpRequest, Directive rootDirective)
-      : Handler() {
-    this->_httpRequest = _httpRequest;
-    this->_rootDirective = rootDirective;
-  }
-  ~DeleteClientMethod() {}
+  DeleteClientMethod(const HTTPRequest& httpRequest,
+                     const Directive& rootDirective)
+      : ContextHandler(rootDirective, httpRequest) {}
+  explicit DeleteClientMethod(RequestContext& context)
+      : ContextHandler(context) {}
 
   // ファイルパスを取得するメソッド
   std::string getFullPath() const;
@@ -0,0 +1,93 @@
+#include "EpollEventLoop.hpp"
+
+#ifdef __linux__
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+// EventLoopのフラグをepollのイベントに変換する
+static uint32_t toEpollEvents(int events) {
+  uint32_t epollEvents = 0;
+  if (events & EventLoop::READ) epollEvents |= EPOLLIN;
+  if (events & EventLoop::WRITE) epollEvents |= EPOLLOUT;
+  return epollEvents;
+}
+
+// epollのイベントをEventLoopのフラグに変換する
+static int fromEpollEvents(uint32_t epollEvents) {
+  int events = 0;
+  if (epollEvents & EPOLLIN) events |= EventLoop::READ;
+  if (epollEvents & EPOLLOUT) events |= EventLoop::WRITE;
+  if (epollEvents & (EPOLLERR | EPOLLHUP)) events |= EventLoop::ERROR;
+  return events;
+}
+
+EpollEventLoop::EpollEventLoop()
+    : epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+      watched(0),
+      events_buffer(EPOLL_MAX_EVENTS) {
+  if (epoll_fd < 0) {
+    perror("epoll_create1");
+  }
+}
+
+EpollEventLoop::~EpollEventLoop() {
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+  }
+}
+
+bool EpollEventLoop::add(int fd, int events) {
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = toEpollEvents(events);
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    return false;
+  }
+  ++watched;
+  return true;
+}
+
+bool EpollEventLoop::modify(int fd, int events) {
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = toEpollEvents(events);
+  event.data.fd = fd;
+  return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void EpollEventLoop::remove(int fd) {
+  // close前に呼ぶこと（closeされたFDはepollから自動的に外れ，ここで失敗する）
+  struct epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &event) == 0) {
+    --watched;
+  }
+}
+
+int EpollEventLoop::wait(std::vector<Event> &fired, int timeout_ms) {
+  fired.clear();
+  int ready = epoll_wait(epoll_fd, &events_buffer[0], events_buffer.size(),
+                         timeout_ms);
+  if (ready <= 0) {
+    return ready;
+  }
+
+  // 準備ができたFDだけが返されるので，監視中のFDの総数に関係なく処理できる
+  for (int i = 0; i < ready; ++i) {
+    Event event;
+    event.fd = events_buffer[i].data.fd;
+    event.events = fromEpollEvents(events_buffer[i].events);
+    fired.push_back(event);
+  }
+  return ready;
+}
+
+size_t EpollEventLoop::size() const { return watched; }
+
+const char *EpollEventLoop::name() const { return "epoll"; }
+
+#endif
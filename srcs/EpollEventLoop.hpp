@@ -0,0 +1,41 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+
+#include <vector>
+
+#include "EventLoop.hpp"
+
+// 1回のepoll_waitで受け取る最大イベント数
+#define EPOLL_MAX_EVENTS 1024
+
+// epollによるイベントループ（Linuxでのデフォルトのバックエンド）
+// 1回のwaitのコストは準備ができたFDの数に比例し，監視中のFDの総数には依存しない
+class EpollEventLoop : public EventLoop {
+ private:
+  int epoll_fd;
+  size_t watched;
+  std::vector<struct epoll_event> events_buffer;
+
+  // コピー防止（epoll_fdを二重にcloseしないため）
+  EpollEventLoop(const EpollEventLoop &);
+  EpollEventLoop &operator=(const EpollEventLoop &);
+
+ public:
+  EpollEventLoop();
+  ~EpollEventLoop();
+
+  // epoll_createに成功したか
+  bool isValid() const { return epoll_fd >= 0; }
+
+  bool add(int fd, int events);
+  bool modify(int fd, int events);
+  void remove(int fd);
+  int wait(std::vector<Event> &fired, int timeout_ms);
+  size_t size() const;
+  const char *name() const;
+};
+
+#endif
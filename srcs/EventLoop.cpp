@@ -0,0 +1,24 @@
+#include "EventLoop.hpp"
+
+#include "EpollEventLoop.hpp"
+#include "PollEventLoop.hpp"
+
+EventLoop *EventLoop::create(const std::string &backend) {
+  std::string name = backend.empty() ? DEFAULT_EVENT_BACKEND : backend;
+
+  if (name == "poll") {
+    return new PollEventLoop();
+  }
+#ifdef __linux__
+  if (name == "epoll") {
+    EpollEventLoop *eventLoop = new EpollEventLoop();
+    if (!eventLoop->isValid()) {
+      delete eventLoop;
+      return NULL;
+    }
+    return eventLoop;
+  }
+#endif
+  // 未対応のバックエンド
+  return NULL;
+}
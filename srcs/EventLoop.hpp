@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// confで指定されなかった場合に使うイベントループのバックエンド
+#ifdef __linux__
+#define DEFAULT_EVENT_BACKEND "epoll"
+#else
+#define DEFAULT_EVENT_BACKEND "poll"
+#endif
+
+// FDの監視（poll/epoll）を抽象化するインターフェース
+// RunServerはこのインターフェースだけを使い，バックエンドはconfで切り替える
+class EventLoop {
+ public:
+  // 監視するイベント・発生したイベントのフラグ
+  enum EventFlag {
+    READ = 1,   // 読み込み可能（POLLIN）
+    WRITE = 2,  // 書き込み可能（POLLOUT）
+    ERROR = 4   // エラー・切断（POLLERR/POLLHUP/POLLNVAL）．発生時のみ
+  };
+
+  // wait()で返される，発生したイベント1件分
+  struct Event {
+    int fd;
+    int events;
+  };
+
+  virtual ~EventLoop() {}
+
+  // FDを監視対象に追加・変更・削除する
+  virtual bool add(int fd, int events) = 0;
+  virtual bool modify(int fd, int events) = 0;
+  virtual void remove(int fd) = 0;
+
+  /**
+   * @brief イベントが発生するまで待つ
+   * @param fired 発生したイベントの格納先（呼び出し時に上書きされる）
+   * @param timeout_ms 待機時間（ミリ秒）．-1なら無期限
+   * @return 発生したイベントの数．エラーの場合は-1
+   */
+  virtual int wait(std::vector<Event> &fired, int timeout_ms) = 0;
+
+  // 監視中のFDの数
+  virtual size_t size() const = 0;
+
+  // バックエンド名（"poll"や"epoll"）
+  virtual const char *name() const = 0;
+
+  /**
+   * @brief バックエンド名からイベントループを作成する
+   * @param backend "poll"または"epoll"．空文字列ならDEFAULT_EVENT_BACKEND
+   * @return 作成したイベントループ．未対応のバックエンドの場合はNULL
+   */
+  static EventLoop *create(const std::string &backend);
+};
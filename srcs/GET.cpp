@@ -3,8 +3,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-GET::GET(Directive rootDirective, HTTPRequest httpRequest)
-    : _rootDirective(rootDirective), _httpRequest(httpRequest) {}
+GET::GET(const Directive& rootDirective, const HTTPRequest& httpRequest)
+    : ContextHandler(rootDirective, httpRequest) {}
+
+GET::GET(RequestContext& context) : ContextHandler(context) {}
 
 // 指定された文字列が任意の文字列で終わるかを調べる関数
 static bool endsWith(const std::string& str, const std::string& suffix) {
@@ -25,8 +27,8 @@ static bool isDirectory(const std::string& filePath) {
 bool GET::fileExists(const std::string& filePath) {
   std::string filePathWithIndex = filePath;
   if (isDirectory(filePath)) {
-    GenerateHTTPResponse searchIndexValue(_rootDirective, _httpRequest);
-    std::string index = searchIndexValue.getDirectiveValue("index");
+    const RouteTable::Route* route = _context.getRoute();
+    std::string index = route != NULL ? route->index : "";
     if (index.empty()) {
       index = "index.html";
     }
@@ -45,12 +47,10 @@ static bool fileIsReadable(const std::string& filePath) {
 
 // 完全なファイルパスを取得する関数
 std::string GET::getFullPath() const {
-  // ホストディレクティブからrootの値を取得
+  // ホストのrootの値を取得
   std::string rootValue;
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
+  if (_server != NULL) {
+    rootValue = _server->root;
   }
 
   // URLとrootを結合して完全なパスを作成
@@ -85,7 +85,7 @@ void GET::handleRequest(HTTPResponse& httpResponse) {
   // CGIの場合はCGIハンドラを呼び出す
   if (endsWith(_httpRequest.getURL(), ".py") ||
       endsWith(_httpRequest.getURL(), ".sh")) {
-    CGI cgi = CGI(_rootDirective, _httpRequest);
+    CGI cgi(_context);
     cgi.handleRequest(httpResponse);
     // CGIハンドラがステータスコードを設定している前提
   } else {
@@ -1,14 +1,11 @@
 #pragma once
 
 #include "CGI.hpp"
+#include "ContextHandler.hpp"
 #include "GenerateHTTPResponse.hpp"
-#include "Handler.hpp"
 
-class GET : public Handler {
+class GET : public ContextHandler {
  private:
-  Directive _rootDirective;
-  HTTPRequest _httpRequest;
-
   // リクエストされたURLの完全なファイルパスを取得する関数
   std::string getFullPath() const;
 
@@ -18,6 +15,7 @@ class GET : public Handler {
   bool fileExists(const std::string& filePath);
 
  public:
-  GET(Directive rootDirective, HTTPRequest httpRequest);
+  GET(const Directive& rootDirective, const HTTPRequest& httpRequest);
+  explicit GET(RequestContext& context);
   void handleRequest(HTTPResponse& httpResponse);
 };
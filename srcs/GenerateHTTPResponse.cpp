@@ -52,20 +52,11 @@ std::string GenerateHTTPResponse::getMimeType(const std::string& filePath) {
     return "text/html";  // デフォルト
   }
 
-  // 設定ファイルからContent-Typeを探す
-  std::string wildcardPattern = "*" + extension;
-  const Directive* locationDirective = _rootDirective.findDirective(
-      _httpRequest.getServerName(), "location", wildcardPattern);
-
-  if (locationDirective != NULL) {
-    std::string contentType = locationDirective->getValue("Content-Type");
-    if (!contentType.empty()) {
-      // セミコロンで終わっている場合は除去
-      if (!contentType.empty() &&
-          contentType[contentType.length() - 1] == ';') {
-        contentType = contentType.substr(0, contentType.length() - 1);
-      }
-      return contentType;
+  // 設定ファイルからContent-Typeを探す（[host.location."*.css"]など）
+  if (_server != NULL) {
+    const std::string* contentType = _server->findMimeType(extension);
+    if (contentType != NULL) {
+      return *contentType;
     }
   }
 
@@ -109,7 +100,11 @@ std::string GenerateHTTPResponse::generateHttpResponseHeader(
   httpResponseHeader += "Content-Type: " + mimeType + "\r\n";
   httpResponseHeader +=
       "Content-Length: " + int2str(httpResponseBody.size()) + "\r\n";
-  httpResponseHeader += "Connection: close\r\n";
+  if (_httpRequest.isKeepAlive()) {
+    httpResponseHeader += "Connection: keep-alive\r\n";
+  } else {
+    httpResponseHeader += "Connection: close\r\n";
+  }
   return httpResponseHeader;
 }
 
@@ -133,18 +128,13 @@ std::string GenerateHTTPResponse::getErrorPathForHttpResponseBody(
     const int status_code) {
   std::string errorPageValue, rootValue;
 
-  // ステータスコードに対応するerror_pageディレクティブを探す
-  const Directive* errorPageDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName(), "error_page");
-  if (errorPageDirective != NULL) {
-    errorPageValue = errorPageDirective->getValue(int2str(status_code));
-  }
-
-  // ホストディレクティブからrootの値を取得
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
+  // ステータスコードに対応するerror_pageとホストのrootを取得
+  if (_server != NULL) {
+    const std::string* errorPage = _server->findErrorPage(status_code);
+    if (errorPage != NULL) {
+      errorPageValue = *errorPage;
+    }
+    rootValue = _server->root;
   }
 
   // カスタムエラーページが設定されており、かつファイルが存在すればそのパスを返す
@@ -162,25 +152,15 @@ std::string GenerateHTTPResponse::getErrorPathForHttpResponseBody(
 // 成功ステータス（2xxまたは301）の場合のファイルパスを取得する
 std::string GenerateHTTPResponse::getSuccessPathForHttpResponseBody() {
   std::string requestedURL = _httpRequest.getURL();
-  std::string rootValue = "";
-
-  // ホストディレクティブからrootの値を取得
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
-  }
+  std::string rootValue = _server != NULL ? _server->root : "";
 
   // URLがディレクトリの場合
   if (isDirectory(rootValue + requestedURL)) {
     // インデックスファイルを探す
-    const Directive* indexDirective = _rootDirective.findDirective(
-        _httpRequest.getServerName(), "location", requestedURL);
-    if (indexDirective != NULL) {
-      std::string indexValue = indexDirective->getValue("index");
-      if (!indexValue.empty()) {
-        return rootValue + requestedURL + indexValue;
-      }
+    const RouteTable::Location* location =
+        _server != NULL ? _server->findLocation(requestedURL) : NULL;
+    if (location != NULL && !location->index.empty()) {
+      return rootValue + requestedURL + location->index;
     }
     // インデックスディレクティブがなければデフォルトのindex.htmlを使用
     std::string defaultIndexFileName =
@@ -199,69 +179,24 @@ static bool endsWith(const std::string& str, const std::string& suffix) {
          str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
-std::string GenerateHTTPResponse::getDirectiveValue(std::string directiveKey) {
-  std::vector<std::string> values = getDirectiveValues(directiveKey);
-  if (values.empty() || (values.size() == 1 && values[0].empty())) {
-    return "";
-  }
-  return values[0];
-}
-
-std::vector<std::string> GenerateHTTPResponse::getDirectiveValues(
-    std::string directiveKey) {
-  std::vector<std::string> directiveValues;
-
-  // ホストディレクティブからrootの値を取得
-  std::string rootValue = "";
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
-  }
-
-  // 指定のホスト内の指定のロケーション内で指定ディレクティブdirectiveKeyの値があれば取得する
-  std::string requestedURL = _httpRequest.getURL();
-  if (!rootValue.empty() && isDirectory(rootValue + requestedURL)) {
-    const Directive* locationDirective = _rootDirective.findDirective(
-        _httpRequest.getServerName(), "location", requestedURL);
-    if (locationDirective != NULL) {
-      directiveValues = locationDirective->getValues(directiveKey);
-      if (!directiveValues.empty() && !directiveValues[0].empty()) {
-        return directiveValues;
-      }
-    }
-  }
-
-  // 「指定のホスト内直下にある」かどうかを調べる．
-  if (hostDirective != NULL) {
-    directiveValues = hostDirective->getValues(directiveKey, false);
-    if (!directiveValues.empty() && !directiveValues[0].empty()) {
-      return directiveValues;
-    }
-  }
-
-  // 空のベクターを返す
-  return std::vector<std::string>();
-}
-
 std::string GenerateHTTPResponse::generateHttpResponseBody(
     const int status_code) {
   // DELETEメソッドがコールされた場合，HTTPレスポンスボディを空にする
   if (_httpRequest.getMethod() == "DELETE") return "";
 
   std::string httpResponseBody;
+  const RouteTable::Route* route = _context.getRoute();
 
   // CGIは実行されたか（2xx番でないと実行されていない）
   if (status_code / 100 == 2 && (endsWith(_httpRequest.getURL(), ".py") ||
                                  endsWith(_httpRequest.getURL(), ".sh"))) {
-    httpResponseBody = readFile(CGI_PAGE);
+    httpResponseBody = readFile(getCGIPagePath());
   }
   // ディレクトリリスニングすべきか
-  else if (status_code != 400 && getDirectiveValue("autoindex") == "on" &&
-           getDirectiveValue("root") != "" &&
-           isDirectory(getDirectiveValue("root") + _httpRequest.getURL())) {
-    ListenDirectory listenDirectory(getDirectiveValue("root") +
-                                    _httpRequest.getURL());
+  else if (status_code != 400 && route != NULL && route->autoindex &&
+           !route->root.empty() &&
+           isDirectory(route->root + _httpRequest.getURL())) {
+    ListenDirectory listenDirectory(route->root + _httpRequest.getURL());
     HTTPResponse response;
     listenDirectory.handleRequest(response);
     httpResponseBody = response.getHttpResponseBody();
@@ -278,13 +213,17 @@ std::string GenerateHTTPResponse::generateHttpResponseBody(
   return httpResponseBody;
 }
 
-GenerateHTTPResponse::GenerateHTTPResponse(Directive rootDirective,
-                                           HTTPRequest httpRequest)
-    : _rootDirective(rootDirective), _httpRequest(httpRequest) {}
+GenerateHTTPResponse::GenerateHTTPResponse(const Directive& rootDirective,
+                                           const HTTPRequest& httpRequest)
+    : ContextHandler(rootDirective, httpRequest) {}
+
+GenerateHTTPResponse::GenerateHTTPResponse(RequestContext& context)
+    : ContextHandler(context) {}
 
 void GenerateHTTPResponse::handleRequest(HTTPResponse& httpResponse) {
   // リダイレクトが指定されている場合HttpStatusCodeを301に設定する
-  if (getDirectiveValue("return") != "") {
+  const RouteTable::Route* route = _context.getRoute();
+  if (route != NULL && !route->redirect.empty()) {
     httpResponse.setHttpStatusCode(301);
   }
 
@@ -6,15 +6,14 @@
 #include <sstream>  // 文字列のストリーム操作を行うためのヘッダ。std::stringstreamを使って文字列を組み立て、最終的に出力するために使用。
 
 #include "CGI.hpp"
-#include "Handler.hpp"
+#include "ContextHandler.hpp"
 #include "ListenDirectory.hpp"
+#include "RequestContext.hpp"
 #include "StatusCodes.hpp"
 #define DEFAULT_ERROR_PAGE "html/defaultErrorPage.html"
 
-class GenerateHTTPResponse : public Handler {
+class GenerateHTTPResponse : public ContextHandler {
  private:
-  Directive _rootDirective;
-  HTTPRequest _httpRequest;
   std::string generateHttpStatusLine(const int status_code);
   std::string generateHttpResponseHeader(const std::string& httpResponseBody);
   std::string generateHttpResponseBody(const int status_code);
@@ -30,9 +29,9 @@ class GenerateHTTPResponse : public Handler {
   bool fileExists(const std::string& filePath);
 
  public:
-  GenerateHTTPResponse(Directive rootDirective, HTTPRequest httpRequest);
-  std::string getDirectiveValue(std::string directiveKey);
-  std::vector<std::string> getDirectiveValues(std::string directiveKey);
+  GenerateHTTPResponse(const Directive& rootDirective,
+                       const HTTPRequest& httpRequest);
+  explicit GenerateHTTPResponse(RequestContext& context);
 
   void handleRequest(HTTPResponse& httpResponse);
 };
@@ -0,0 +1,100 @@
+#include "HTTPHeaders.hpp"
+
+#include <strings.h>
+
+namespace {
+struct KnownName {
+  const char *name;
+  size_t length;
+};
+
+// Knownと同じ順に並べる
+const KnownName kKnownNames[HTTPHeaders::KNOWN_COUNT] = {
+    {"Host", 4},
+    {"Content-Length", 14},
+    {"Transfer-Encoding", 17},
+    {"Connection", 10},
+    {"Content-Type", 12},
+    {"If-None-Match", 13},
+    {"If-Modified-Since", 17},
+    {"Range", 5},
+    {"Accept-Encoding", 15},
+    {"Expect", 6},
+};
+
+const std::string kEmpty;
+
+bool sameName(const std::string &a, const std::string &b) {
+  return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+}  // namespace
+
+HTTPHeaders::Known HTTPHeaders::lookup(const char *name, size_t length) {
+  // 長さが一致するものだけ文字を比べる
+  for (int id = 0; id < KNOWN_COUNT; ++id) {
+    if (kKnownNames[id].length == length &&
+        strncasecmp(kKnownNames[id].name, name, length) == 0) {
+      return static_cast<Known>(id);
+    }
+  }
+  return UNKNOWN;
+}
+
+HTTPHeaders::HTTPHeaders() { clear(); }
+
+HTTPHeaders::HTTPHeaders(const std::map<std::string, std::string> &headers) {
+  clear();
+  for (std::map<std::string, std::string>::const_iterator it = headers.begin();
+       it != headers.end(); ++it) {
+    set(it->first, it->second);
+  }
+}
+
+void HTTPHeaders::set(const std::string &name, const std::string &value) {
+  set(lookup(name), name, value);
+}
+
+void HTTPHeaders::set(Known id, const std::string &name,
+                      const std::string &value) {
+  if (id != UNKNOWN) {
+    if (_slots[id] >= 0) {
+      _fields[_slots[id]].value = value;
+      return;
+    }
+    _slots[id] = static_cast<int>(_fields.size());
+  } else {
+    for (size_t i = 0; i < _fields.size(); ++i) {
+      if (sameName(_fields[i].name, name)) {
+        _fields[i].value = value;
+        return;
+      }
+    }
+  }
+  _fields.push_back(Field());
+  _fields.back().name = name;
+  _fields.back().value = value;
+}
+
+const std::string &HTTPHeaders::get(Known id) const {
+  return _slots[id] >= 0 ? _fields[_slots[id]].value : kEmpty;
+}
+
+const std::string *HTTPHeaders::find(const std::string &name) const {
+  Known id = lookup(name);
+  if (id != UNKNOWN) {
+    return has(id) ? &_fields[_slots[id]].value : NULL;
+  }
+  for (size_t i = 0; i < _fields.size(); ++i) {
+    if (sameName(_fields[i].name, name)) {
+      return &_fields[i].value;
+    }
+  }
+  return NULL;
+}
+
+void HTTPHeaders::clear() {
+  _fields.clear();
+  for (int id = 0; id < KNOWN_COUNT; ++id) {
+    _slots[id] = -1;
+  }
+}
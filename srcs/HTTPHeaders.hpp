@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @class HTTPHeaders
+ * @brief リクエストヘッダーの表（名前の大文字・小文字を区別しない）
+ *
+ * よく参照するヘッダーはKnownの番号で表し，番号ごとの欄（_slots）から
+ * 文字列の比較なしに引ける．それ以外のヘッダーは受信した順に並べた
+ * 小さな配列を先頭から探す．同じ名前のヘッダーは後のもので上書きする
+ */
+class HTTPHeaders {
+ public:
+  // 解析中に見分けるヘッダー
+  enum Known {
+    HOST,
+    CONTENT_LENGTH,
+    TRANSFER_ENCODING,
+    CONNECTION,
+    CONTENT_TYPE,
+    IF_NONE_MATCH,
+    IF_MODIFIED_SINCE,
+    RANGE,
+    ACCEPT_ENCODING,
+    EXPECT,
+    KNOWN_COUNT,
+    UNKNOWN = KNOWN_COUNT
+  };
+
+  // 1つのヘッダー（名前は受信したときの綴りのまま）
+  struct Field {
+    std::string name;
+    std::string value;
+  };
+
+  // ヘッダー名の番号（見分けるヘッダーでなければUNKNOWN）
+  static Known lookup(const char *name, size_t length);
+  static Known lookup(const std::string &name) {
+    return lookup(name.data(), name.size());
+  }
+
+  HTTPHeaders();
+  explicit HTTPHeaders(const std::map<std::string, std::string> &headers);
+
+  // ヘッダーを加える（同じ名前があれば値を上書きする）
+  void set(const std::string &name, const std::string &value);
+  // 番号が分かっている場合（nameの番号はidでなければならない）
+  void set(Known id, const std::string &name, const std::string &value);
+
+  bool has(Known id) const { return _slots[id] >= 0; }
+  // 値（なければ空文字列）
+  const std::string &get(Known id) const;
+  // 名前で探す（なければNULL）
+  const std::string *find(const std::string &name) const;
+
+  // 受信した順のヘッダー（同じ名前のものは1つにまとめてある）
+  size_t size() const { return _fields.size(); }
+  bool empty() const { return _fields.empty(); }
+  const Field &operator[](size_t index) const { return _fields[index]; }
+
+  void clear();
+
+ private:
+  std::vector<Field> _fields;
+  // 見分けるヘッダーの_fields内の位置（なければ-1）
+  int _slots[KNOWN_COUNT];
+};
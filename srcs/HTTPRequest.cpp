@@ -1,6 +1,7 @@
 #include "HTTPRequest.hpp"
 
-HTTPRequest::HTTPRequest() : _valid(false), _keepAlive(false) {}
+HTTPRequest::HTTPRequest()
+    : _bodySpool(NULL), _valid(false), _keepAlive(false) {}
 
 HTTPRequest::HTTPRequest(const std::string& method, const std::string& url,
                          const std::string& version,
@@ -11,12 +12,31 @@ HTTPRequest::HTTPRequest(const std::string& method, const std::string& url,
       _version(version),
       _headers(headers),
       _body(body),
+      _bodySpool(NULL),
       _valid(true),
       _keepAlive(keepAlive) {
+  setServerName();
+}
+
+HTTPRequest::HTTPRequest(const std::string& method, const std::string& url,
+                         const std::string& version,
+                         const HTTPHeaders& headers, const std::string& body,
+                         bool keepAlive)
+    : _method(method),
+      _url(url),
+      _version(version),
+      _headers(headers),
+      _body(body),
+      _bodySpool(NULL),
+      _valid(true),
+      _keepAlive(keepAlive) {
+  setServerName();
+}
+
+void HTTPRequest::setServerName() {
   // Hostヘッダがある場合は、_server_nameに値を設定
-  std::map<std::string, std::string>::const_iterator it = _headers.find("Host");
-  if (it != _headers.end()) {
-    std::string host = it->second;
+  if (_headers.has(HTTPHeaders::HOST)) {
+    const std::string& host = _headers.get(HTTPHeaders::HOST);
     size_t pos = host.find(":");
     if (pos != std::string::npos) {
       _server_name = host.substr(0, pos);
@@ -30,9 +50,32 @@ HTTPRequest::HTTPRequest(const std::string& method, const std::string& url,
 HTTPRequest::~HTTPRequest() { ; }
 
 std::string HTTPRequest::getHeader(const std::string& key) const {
-  std::map<std::string, std::string>::const_iterator it = _headers.find(key);
-  if (it != _headers.end()) {
-    return it->second;
+  const std::string* value = _headers.find(key);
+  if (value != NULL) {
+    return *value;
   }
   return "";
 }
+
+size_t HTTPRequest::getBodySize() const {
+  return _bodySpool != NULL ? _bodySpool->size() : _body.size();
+}
+
+bool HTTPRequest::writeBodyTo(BodySink& sink) const {
+  if (_bodySpool != NULL) {
+    return _bodySpool->copyTo(sink);
+  }
+  return sink.write(_body.data(), _body.size());
+}
+
+bool HTTPRequest::readBody(std::string& result) const {
+  if (_bodySpool != NULL) {
+    return _bodySpool->readAll(result);
+  }
+  result = _body;
+  return true;
+}
+
+int HTTPRequest::getBodyFd() const {
+  return _bodySpool != NULL ? _bodySpool->fd() : -1;
+}
@@ -2,18 +2,26 @@
 #include <map>
 #include <string>
 
+#include "BodySink.hpp"
+#include "HTTPHeaders.hpp"
+
 // HTTPリクエストの構造体が含まれる
 class HTTPRequest {
  private:
   std::string _method;
   std::string _url;
   std::string _version;
-  std::map<std::string, std::string> _headers;
+  HTTPHeaders _headers;
   std::string _body;
+  // 一時ファイルに溜めたボディ（パーサーのもの．ボディが_bodyにあればNULL）
+  const SpoolBodySink* _bodySpool;
   std::string _server_name;
   bool _valid;
   bool _keepAlive;  // Keep-Alive接続かどうかを示すフラグを追加
 
+  // Hostヘッダーから_server_nameを決める
+  void setServerName();
+
  public:
   HTTPRequest();
   HTTPRequest(
@@ -22,22 +30,42 @@ class HTTPRequest {
       const std::map<std::string, std::string>& headers,
       const std::string& body,
       bool keepAlive = false);  // keepAliveパラメータをデフォルト値付きで追加
+  HTTPRequest(const std::string& method, const std::string& url,
+              const std::string& version, const HTTPHeaders& headers,
+              const std::string& body, bool keepAlive = false);
   ~HTTPRequest();
 
   // アクセサメソッド
-  std::string getMethod() const { return _method; }
-  std::string getURL() const { return _url; }
-  std::string getVersion() const { return _version; }
-  std::string getBody() const { return _body; }
-  std::string getServerName() const { return _server_name; }
-  const std::map<std::string, std::string>& getHeaders() const {
-    return _headers;
-  }
+  const std::string& getMethod() const { return _method; }
+  const std::string& getURL() const { return _url; }
+  const std::string& getVersion() const { return _version; }
+  // メモリにあるボディ（一時ファイルに溜めた大きなボディは含まない）
+  const std::string& getBody() const { return _body; }
+  const std::string& getServerName() const { return _server_name; }
+  const HTTPHeaders& getHeaders() const { return _headers; }
+  // 名前で探す（大文字・小文字を区別しない．なければ空文字列）
   std::string getHeader(const std::string& key) const;
+  // 見分けるヘッダーは番号で引く（文字列を比べない）
+  const std::string& getHeader(HTTPHeaders::Known id) const {
+    return _headers.get(id);
+  }
+
+  // ボディ全体のバイト数
+  size_t getBodySize() const;
+  // ボディ全体を先頭からsinkに書き込む
+  bool writeBodyTo(BodySink& sink) const;
+  // ボディ全体をresultに読み出す（ボディの大きさだけメモリを使う）
+  bool readBody(std::string& result) const;
+  // ボディを溜めた一時ファイル（ボディがメモリにあれば-1）
+  int getBodyFd() const;
+  // パーサーが一時ファイルに溜めたボディを使う（パーサーのresetまで有効）
+  void setBodySpool(const SpoolBodySink* spool) { _bodySpool = spool; }
 
   // URLリダイレクトの実装に必要であるため追加．URLリダイレクトとはすなわち，HTTPリクエストのURLを変更することである．
   void setURL(const std::string& url) { _url = url; }
 
   bool isValid() const { return _valid; }
   bool isKeepAlive() const { return _keepAlive; }  // keepAliveのゲッターを追加
+  // keepalive_requestsの上限などで，サーバー側から接続を閉じる場合に使う
+  void setKeepAlive(bool keepAlive) { _keepAlive = keepAlive; }
 };
@@ -6,15 +6,32 @@
 #include <cctype>
 
 #include "HTTPRequest.hpp"
+#include "HTTPScanner.hpp"
 
 HTTPRequestParser::HTTPRequestParser()
     : state(RequestMethodStart),
+      parsePos(0),
+      headerEnd(0),
+      lineStart(0),
+      maxLineSize(DEFAULT_LARGE_CLIENT_HEADER_BUFFER_SIZE),
+      maxHeaderSize(DEFAULT_LARGE_CLIENT_HEADER_BUFFER_SIZE *
+                    DEFAULT_LARGE_CLIENT_HEADER_BUFFERS),
       headersParsed(false),
       requestComplete(false),
       contentLength(0),
       chunked(false),
       chunkSize(0),
-      parsingError(false) {}
+      hasChunkSize(false),
+      headersBuilt(false),
+      sink(&spool),
+      bodyLength(0),
+      maxBodySize(static_cast<size_t>(-1)),
+      parsingError(false),
+      errorStatusCode(400) {
+  for (int id = 0; id < HTTPHeaders::KNOWN_COUNT; ++id) {
+    knownFields[id] = -1;
+  }
+}
 
 HTTPRequestParser::~HTTPRequestParser() {
   // 動的メモリ割り当てがないので、特別なクリーンアップは不要
@@ -32,15 +49,17 @@ HTTPRequest HTTPRequestParser::parseRequest(const std::string& buffer) {
   }
 
   // リクエストラインが正しく解析されたか確認
-  if (method.empty() || url.empty() || version.empty()) {
+  if (method.length == 0 || url.length == 0 || version.length == 0) {
     throw std::runtime_error("リクエストラインが不完全または不正です");
   }
 
   // メソッドの検証
-  if (method != "GET" && method != "POST" && method != "DELETE" &&
-      method != "PUT" && method != "HEAD" && method != "OPTIONS" &&
-      method != "TRACE" && method != "CONNECT") {
-    throw std::runtime_error("サポートされていないHTTPメソッド: " + method);
+  std::string methodName = getMethod();
+  if (methodName != "GET" && methodName != "POST" && methodName != "DELETE" &&
+      methodName != "PUT" && methodName != "HEAD" && methodName != "OPTIONS" &&
+      methodName != "TRACE" && methodName != "CONNECT") {
+    throw std::runtime_error("サポートされていないHTTPメソッド: " +
+                             methodName);
   }
 
   if (!isComplete()) {
@@ -57,7 +76,13 @@ bool HTTPRequestParser::feed(const char* data, size_t length) {
   rawBuffer.append(data, length);
 
   // 文字単位での解析を実装
-  ParseResult result = parse(rawBuffer);
+  ParseResult result = parse();
+
+  // ボディは受け取り先へ渡したので，バッファにはヘッダーと後続の分だけ残す
+  if (headersParsed && parsePos > headerEnd) {
+    rawBuffer.erase(headerEnd, parsePos - headerEnd);
+    parsePos = headerEnd;
+  }
 
   if (result == ParsingError) {
     parsingError = true;
@@ -67,13 +92,55 @@ bool HTTPRequestParser::feed(const char* data, size_t length) {
   return (result == ParsingCompleted);
 }
 
-// 残りのコードはそのまま、ただし戻り値型を修正
-HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
-  const char* begin = buffer.data();
-  const char* end = begin + buffer.length();
-  const char* currentPos = begin;
+// rawBufferのparsePosから解析する（文字列はコピーせず，位置だけを記録する）
+HTTPRequestParser::ParseResult HTTPRequestParser::parse() {
+  const char* begin = rawBuffer.data();
+  const char* end = begin + rawBuffer.length();
+  const char* currentPos = begin + parsePos;
 
   while (currentPos != end) {
+    // ボディは1バイトずつではなく，届いている分をまとめて受け取り先に渡す
+    if (state == MessageBody || state == ChunkData) {
+      size_t available = end - currentPos;
+      size_t remaining =
+          state == MessageBody ? contentLength - bodyLength : chunkSize;
+      size_t n = std::min(available, remaining);
+      if (!sink->write(currentPos, n)) {
+        errorMessage = "ボディを保存できません";
+        return ParsingError;
+      }
+      bodyLength += n;
+      currentPos += n;
+      if (state == MessageBody) {
+        if (bodyLength >= contentLength) {
+          parsePos = currentPos - begin;
+          requestComplete = true;
+          return ParsingCompleted;
+        }
+      } else {
+        chunkSize -= n;
+        if (chunkSize == 0) {
+          state = ChunkDataNewline_1;
+        }
+      }
+      continue;
+    }
+
+    // トークン・URI・ヘッダー値の途中なら，区切り文字か不正なバイトまで
+    // まとめて読み飛ばす（そのバイトは下の状態遷移で判定する）
+    if (state == HeaderValue) {
+      currentPos = HTTPScanner::skipFieldValue(currentPos, end);
+    } else if (state == HeaderName || state == RequestMethod) {
+      currentPos = HTTPScanner::skipToken(currentPos, end);
+    } else if (state == RequestUri) {
+      currentPos = HTTPScanner::skipURI(currentPos, end);
+    }
+    if (currentPos == end) {
+      break;
+    }
+
+    // 入力文字のrawBuffer内の位置
+    size_t at = currentPos - begin;
     char input = *currentPos++;
 
     switch (state) {
@@ -83,18 +150,17 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
           return ParsingError;
         } else {
           state = RequestMethod;
-          method.push_back(input);
+          method.offset = at;
         }
         break;
 
       case RequestMethod:
         if (input == ' ') {
+          method.length = at - method.offset;
           state = RequestUriStart;
         } else if (!isChar(input) || isControl(input) || isSpecial(input)) {
           errorMessage = "無効なリクエストメソッド文字";
           return ParsingError;
-        } else {
-          method.push_back(input);
         }
         break;
 
@@ -104,12 +170,13 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
           return ParsingError;
         } else {
           state = RequestUri;
-          url.push_back(input);
+          url.offset = at;
         }
         break;
 
       case RequestUri:
         if (input == ' ') {
+          url.length = at - url.offset;
           state = RequestHttpVersion_h;
         } else if (input == '\r') {
           // HTTP/0.9 simple requestではなくエラーとして扱う
@@ -118,13 +185,12 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
         } else if (isControl(input)) {
           errorMessage = "無効なURI文字";
           return ParsingError;
-        } else {
-          url.push_back(input);
         }
         break;
 
       case RequestHttpVersion_h:
         if (input == 'H') {
+          version.offset = at;
           state = RequestHttpVersion_ht;
         } else {
           errorMessage = "無効なHTTPバージョン";
@@ -162,7 +228,6 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
       case RequestHttpVersion_slash:
         if (input == '/') {
           state = RequestHttpVersion_majorStart;
-          version = "HTTP/";
         } else {
           errorMessage = "無効なHTTPバージョン";
           return ParsingError;
@@ -172,7 +237,6 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
       case RequestHttpVersion_majorStart:
         if (isDigit(input)) {
           state = RequestHttpVersion_major;
-          version.push_back(input);
         } else {
           errorMessage = "無効なHTTPメジャーバージョン";
           return ParsingError;
@@ -182,10 +246,7 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
       case RequestHttpVersion_major:
         if (input == '.') {
           state = RequestHttpVersion_minorStart;
-          version.push_back(input);
-        } else if (isDigit(input)) {
-          version.push_back(input);
-        } else {
+        } else if (!isDigit(input)) {
           errorMessage = "無効なHTTPメジャーバージョン";
           return ParsingError;
         }
@@ -194,7 +255,6 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
       case RequestHttpVersion_minorStart:
         if (isDigit(input)) {
           state = RequestHttpVersion_minor;
-          version.push_back(input);
         } else {
           errorMessage = "無効なHTTPマイナーバージョン";
           return ParsingError;
@@ -203,10 +263,9 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
 
       case RequestHttpVersion_minor:
         if (input == '\r') {
+          version.length = at - version.offset;
           state = ExpectingNewline_1;
-        } else if (isDigit(input)) {
-          version.push_back(input);
-        } else {
+        } else if (!isDigit(input)) {
           errorMessage = "無効なHTTPマイナーバージョン";
           return ParsingError;
         }
@@ -214,6 +273,10 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
 
       case ExpectingNewline_1:
         if (input == '\n') {
+          if (!checkHeaderSize(at + 1)) {
+            return ParsingError;
+          }
+          lineStart = at + 1;
           state = HeaderLineStart;
         } else {
           errorMessage = "改行文字が必要";
@@ -224,21 +287,25 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
       case HeaderLineStart:
         if (input == '\r') {
           state = ExpectingNewline_3;
-        } else if (!headers.empty() && (input == ' ' || input == '\t')) {
+        } else if (!fields.empty() && (input == ' ' || input == '\t')) {
+          // 直前のヘッダーの継続行
+          fields.back().folded = true;
           state = HeaderLws;
         } else if (!isChar(input) || isControl(input) || isSpecial(input)) {
           errorMessage = "無効なヘッダー名の開始";
           return ParsingError;
         } else {
-          currentHeaderName.clear();
-          currentHeaderValue.clear();
-          currentHeaderName.push_back(input);
+          fields.push_back(HeaderField());
+          fields.back().name.offset = at;
+          fields.back().folded = false;
+          fields.back().known = HTTPHeaders::UNKNOWN;
           state = HeaderName;
         }
         break;
 
       case HeaderLws:
         if (input == '\r') {
+          fields.back().value.length = at - fields.back().value.offset;
           state = ExpectingNewline_2;
         } else if (input == ' ' || input == '\t') {
           // スペースをスキップ
@@ -247,23 +314,22 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
           return ParsingError;
         } else {
           state = HeaderValue;
-          // 継続行の場合、スペースを追加
-          if (!headers[currentHeaderName].empty()) {
-            headers[currentHeaderName] += ' ';
-          }
-          headers[currentHeaderName] += input;
         }
         break;
 
       case HeaderName:
         if (input == ':') {
+          HeaderField& field = fields.back();
+          field.name.length = at - field.name.offset;
+          field.known = HTTPHeaders::lookup(
+              rawBuffer.data() + field.name.offset, field.name.length);
+          if (field.known != HTTPHeaders::UNKNOWN) {
+            knownFields[field.known] = static_cast<int>(fields.size() - 1);
+          }
           state = SpaceBeforeHeaderValue;
-          currentHeaderName = trimString(currentHeaderName);
         } else if (!isChar(input) || isControl(input) || isSpecial(input)) {
           errorMessage = "無効なヘッダー名";
           return ParsingError;
-        } else {
-          currentHeaderName.push_back(input);
         }
         break;
 
@@ -272,30 +338,34 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
           // スペースをスキップ
         } else if (input == '\r') {
           // 空のヘッダー値
-          headers[currentHeaderName] = "";
+          fields.back().value.offset = at;
+          fields.back().value.length = 0;
           state = ExpectingNewline_2;
         } else if (isControl(input)) {
           errorMessage = "無効なヘッダー値";
           return ParsingError;
         } else {
-          headers[currentHeaderName] = input;
+          fields.back().value.offset = at;
           state = HeaderValue;
         }
         break;
 
       case HeaderValue:
         if (input == '\r') {
+          fields.back().value.length = at - fields.back().value.offset;
           state = ExpectingNewline_2;
         } else if (isControl(input)) {
           errorMessage = "無効なヘッダー値";
           return ParsingError;
-        } else {
-          headers[currentHeaderName] += input;
         }
         break;
 
       case ExpectingNewline_2:
         if (input == '\n') {
+          if (!checkHeaderSize(at + 1)) {
+            return ParsingError;
+          }
+          lineStart = at + 1;
           state = HeaderLineStart;
         } else {
           errorMessage = "改行文字が必要";
@@ -305,32 +375,15 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
 
       case ExpectingNewline_3:
         if (input == '\n') {
-          headersParsed = true;
-
-          // Content-Lengthヘッダーをチェック
-          std::string contentLengthHeader = getHeader("Content-Length");
-          if (!contentLengthHeader.empty()) {
-            std::istringstream ss(contentLengthHeader);
-            ss >> contentLength;
-            if (ss.fail()) {
-              errorMessage = "無効なContent-Length値";
-              return ParsingError;
-            }
+          if (!checkHeaderSize(at + 1)) {
+            return ParsingError;
           }
-
-          // Transfer-Encoding: chunkedをチェック
-          std::string transferEncoding = getHeader("Transfer-Encoding");
-          if (transferEncoding == "chunked") {
-            chunked = true;
-            state = ChunkSize;
-          } else if (contentLength > 0) {
-            state = MessageBody;
-          } else {
-            // ボディなし
-            size_t processed = currentPos - begin;
-            buffer.erase(0, processed);
-            requestComplete = true;
-            return ParsingCompleted;
+          headersParsed = true;
+          headerEnd = at + 1;
+          parsePos = headerEnd;
+          ParseResult result = finishHeaders();
+          if (result != ParsingIncompleted) {
+            return result;
           }
         } else {
           errorMessage = "改行文字が必要";
@@ -338,28 +391,24 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
         }
         break;
 
-      case MessageBody:
-        body.push_back(input);
-        if (body.length() >= contentLength) {
-          size_t processed = currentPos - begin;
-          buffer.erase(0, processed);
-          requestComplete = true;
-          return ParsingCompleted;
-        }
-        break;
-
       case ChunkSize:
         if (isHexDigit(input)) {
-          chunkSizeStr.push_back(input);
+          int digit = isDigit(input) ? input - '0'
+                                     : std::tolower(input) - 'a' + 10;
+          if (chunkSize > (static_cast<size_t>(-1) >> 4)) {
+            errorMessage = "無効なチャンクサイズ";
+            return ParsingError;
+          }
+          chunkSize = chunkSize * 16 + digit;
+          hasChunkSize = true;
         } else if (input == ';') {
           state = ChunkExtension;
         } else if (input == '\r') {
-          if (chunkSizeStr.empty()) {
+          if (!hasChunkSize) {
             errorMessage = "チャンクサイズがありません";
             return ParsingError;
           }
-          chunkSize = std::strtol(chunkSizeStr.c_str(), NULL, 16);
-          chunkSizeStr.clear();
+          hasChunkSize = false;
           state = ChunkSizeNewline;
         } else {
           errorMessage = "無効なチャンクサイズ";
@@ -369,6 +418,7 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
 
       case ChunkExtension:
         if (input == '\r') {
+          hasChunkSize = false;
           state = ChunkSizeNewline;
         }
         break;
@@ -377,6 +427,10 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
         if (input == '\n') {
           if (chunkSize == 0) {
             state = ChunkTrailerStart;
+          } else if (exceedsMaxBodySize()) {
+            errorMessage = "ボディが大きすぎます";
+            errorStatusCode = 413;
+            return ParsingError;
           } else {
             state = ChunkData;
           }
@@ -386,14 +440,6 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
         }
         break;
 
-      case ChunkData:
-        body.push_back(input);
-        chunkSize--;
-        if (chunkSize == 0) {
-          state = ChunkDataNewline_1;
-        }
-        break;
-
       case ChunkDataNewline_1:
         if (input == '\r') {
           state = ChunkDataNewline_2;
@@ -422,14 +468,23 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
 
       case ChunkTrailer:
         if (input == '\r') {
-          state = ChunkTrailerNewline;
+          state = ChunkTrailerLineNewline;
+        }
+        break;
+
+      case ChunkTrailerLineNewline:
+        // トレーラーは空行まで続く（空行の後ろは次のリクエスト）
+        if (input == '\n') {
+          state = ChunkTrailerStart;
+        } else {
+          errorMessage = "改行文字が必要";
+          return ParsingError;
         }
         break;
 
       case ChunkTrailerNewline:
         if (input == '\n') {
-          size_t processed = currentPos - begin;
-          buffer.erase(0, processed);
+          parsePos = currentPos - begin;
           requestComplete = true;
           return ParsingCompleted;
         } else {
@@ -444,116 +499,290 @@ HTTPRequestParser::ParseResult HTTPRequestParser::parse(std::string& buffer) {
     }
   }
 
-  // バッファを消費した分だけ削除
-  buffer.clear();
+  // 行の途中でも，受信した分が上限を超えていれば終わりを待たずに断る
+  if (!headersParsed && !checkHeaderSize(end - begin)) {
+    return ParsingError;
+  }
+
+  // 解析し終えた位置を覚えて，次のデータが届くのを待つ
+  parsePos = currentPos - begin;
   return ParsingIncompleted;
 }
 
-bool HTTPRequestParser::parseRequestLine(const std::string& line) {
-  std::istringstream ss(line);
-  ss >> method >> url >> version;
-
-  if (ss.fail()) {
-    parsingError = true;
-    errorMessage = "無効なリクエスト行フォーマット";
+// Content-Lengthの値（前後の空白を除いて数字だけ．桁あふれは不正）
+static bool parseContentLength(const std::string& value, size_t& length) {
+  size_t begin = value.find_first_not_of(" \t");
+  size_t end = value.find_last_not_of(" \t");
+  if (begin == std::string::npos) {
     return false;
   }
+  length = 0;
+  for (size_t i = begin; i <= end; ++i) {
+    if (value[i] < '0' || value[i] > '9') {
+      return false;
+    }
+    size_t digit = value[i] - '0';
+    if (length > (static_cast<size_t>(-1) - digit) / 10) {
+      return false;
+    }
+    length = length * 10 + digit;
+  }
+  return true;
+}
 
-  // メソッドを検証
-  if (method != "GET" && method != "POST" && method != "DELETE" &&
-      method != "PUT" && method != "HEAD" && method != "OPTIONS" &&
-      method != "TRACE" && method != "CONNECT") {
-    parsingError = true;
-    errorMessage = "サポートされていないHTTPメソッド";
-    return false;
+// ヘッダーを読み終えた時点で，ボディの形式（Content-Length・chunked）を決める
+// 接続の側はfeedの結果だけでリクエストの終わりを知る（ヘッダーを読み直さない）
+// 長さが曖昧なリクエストはリクエストスマグリングにつながるのでエラーにする
+HTTPRequestParser::ParseResult HTTPRequestParser::finishHeaders() {
+  bool hasContentLength = false;
+  const HeaderField* transferEncoding = NULL;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (fields[i].known == HTTPHeaders::CONTENT_LENGTH) {
+      // 複数ある場合は全て同じ値でなければならない
+      size_t length;
+      if (!parseContentLength(fieldValue(fields[i]), length) ||
+          (hasContentLength && length != contentLength)) {
+        errorMessage = "無効なContent-Length値";
+        return ParsingError;
+      }
+      contentLength = length;
+      hasContentLength = true;
+    } else if (fields[i].known == HTTPHeaders::TRANSFER_ENCODING) {
+      if (transferEncoding != NULL) {
+        errorMessage = "未対応のTransfer-Encoding";
+        return ParsingError;
+      }
+      transferEncoding = &fields[i];
+    }
   }
 
-  // HTTPバージョンを検証
-  if (version != "HTTP/1.0" && version != "HTTP/1.1") {
-    parsingError = true;
-    errorMessage = "サポートされていないHTTPバージョン";
-    return false;
+  if (transferEncoding != NULL) {
+    // 対応する転送コーディングはchunkedだけ（Content-Lengthとの併用も不可）
+    std::string value = fieldValue(*transferEncoding);
+    size_t begin = value.find_first_not_of(" \t");
+    size_t end = value.find_last_not_of(" \t");
+    if (hasContentLength || begin == std::string::npos ||
+        end - begin + 1 != 7 ||
+        strncasecmp(value.c_str() + begin, "chunked", 7) != 0) {
+      errorMessage = "未対応のTransfer-Encoding";
+      return ParsingError;
+    }
+    chunked = true;
+    state = ChunkSize;
+  } else if (exceedsMaxBodySize()) {
+    errorMessage = "ボディが大きすぎます";
+    errorStatusCode = 413;
+    return ParsingError;
+  } else if (contentLength > 0) {
+    state = MessageBody;
+  } else {
+    // ボディなし
+    requestComplete = true;
+    return ParsingCompleted;
   }
+  return ParsingIncompleted;
+}
 
-  return true;
+bool HTTPRequestParser::exceedsMaxBodySize() const {
+  if (!chunked) {
+    return contentLength > maxBodySize;
+  }
+  // chunkedは，受け取り終えた分と受け取り中のチャンクの残りで判断する
+  size_t pending =
+      state == ChunkData || state == ChunkSizeNewline ? chunkSize : 0;
+  return bodyLength > maxBodySize || pending > maxBodySize - bodyLength;
 }
 
-bool HTTPRequestParser::parseHeader(const std::string& line) {
-  std::string::size_type colonPos = line.find(':');
-  if (colonPos == std::string::npos) {
-    parsingError = true;
-    errorMessage = "無効なヘッダーフォーマット: コロンがありません";
+bool HTTPRequestParser::checkHeaderSize(size_t pos) {
+  // リクエストラインの状態はHeaderLineStartより前に並んでいる
+  if (state < HeaderLineStart) {
+    if (pos - lineStart > maxLineSize) {
+      errorMessage = "リクエストラインが長すぎます";
+      errorStatusCode = 414;
+      return false;
+    }
+  } else if (pos - lineStart > maxLineSize || pos > maxHeaderSize) {
+    errorMessage = "ヘッダーが大きすぎます";
+    errorStatusCode = 431;
     return false;
   }
+  return true;
+}
 
-  std::string key = trimString(line.substr(0, colonPos));
-  std::string value = trimString(line.substr(colonPos + 1));
+std::string HTTPRequestParser::spanString(const Span& span) const {
+  return rawBuffer.substr(span.offset, span.length);
+}
 
-  if (key.empty()) {
-    parsingError = true;
-    errorMessage = "空のヘッダーキー";
-    return false;
+// ヘッダーの値（継続行は前後の空白を除いて1つの空白でつなぐ）
+std::string HTTPRequestParser::fieldValue(const HeaderField& field) const {
+  if (!field.folded) {
+    return spanString(field.value);
   }
-
-  headers[key] = value;
-  return true;
+  std::string value;
+  size_t pos = field.value.offset;
+  size_t end = field.value.offset + field.value.length;
+  while (pos <= end) {
+    size_t lineEnd = rawBuffer.find("\r\n", pos);
+    if (lineEnd == std::string::npos || lineEnd > end) {
+      lineEnd = end;
+    }
+    size_t start = pos;
+    while (start < lineEnd &&
+           (rawBuffer[start] == ' ' || rawBuffer[start] == '\t')) {
+      ++start;
+    }
+    if (start < lineEnd) {
+      if (!value.empty()) value += ' ';
+      value.append(rawBuffer, start, lineEnd - start);
+    }
+    pos = lineEnd + 2;
+  }
+  return value;
 }
 
-std::string HTTPRequestParser::trimString(const std::string& str) const {
-  std::string result = str;
-  // 先頭の空白を削除
-  while (!result.empty() && std::isspace(result[0])) result.erase(0, 1);
+bool HTTPRequestParser::fieldNameIs(const HeaderField& field, const char* name,
+                                    size_t length) const {
+  // 大文字・小文字を区別しない（ヘッダー名はトークンなので'\0'を含まない）
+  return field.name.length == length &&
+         strncasecmp(rawBuffer.data() + field.name.offset, name, length) == 0;
+}
 
-  // 末尾の空白を削除
-  while (!result.empty() && std::isspace(result[result.length() - 1]))
-    result.erase(result.length() - 1);
+const HTTPRequestParser::HeaderField* HTTPRequestParser::findField(
+    const char* name, size_t length) const {
+  HTTPHeaders::Known id = HTTPHeaders::lookup(name, length);
+  if (id != HTTPHeaders::UNKNOWN) {
+    return findField(id);
+  }
+  // 同じ名前のヘッダーが複数あれば，後のものを使う
+  for (size_t i = fields.size(); i-- > 0;) {
+    if (fieldNameIs(fields[i], name, length)) {
+      return &fields[i];
+    }
+  }
+  return NULL;
+}
 
-  return result;
+const HTTPRequestParser::HeaderField* HTTPRequestParser::findField(
+    HTTPHeaders::Known id) const {
+  return knownFields[id] >= 0 ? &fields[knownFields[id]] : NULL;
 }
 
 bool HTTPRequestParser::isComplete() const { return requestComplete; }
 
 bool HTTPRequestParser::hasError() const { return parsingError; }
 
+bool HTTPRequestParser::isHeaderComplete() const { return headersParsed; }
+
+bool HTTPRequestParser::hasReceivedData() const {
+  return state != RequestMethodStart || requestComplete || parsingError;
+}
+
 std::string HTTPRequestParser::getErrorMessage() const { return errorMessage; }
 
-std::string HTTPRequestParser::getMethod() const { return method; }
+int HTTPRequestParser::getErrorStatusCode() const { return errorStatusCode; }
+
+std::string HTTPRequestParser::getMethod() const { return spanString(method); }
 
-std::string HTTPRequestParser::getURL() const { return url; }
+std::string HTTPRequestParser::getURL() const { return spanString(url); }
 
-std::string HTTPRequestParser::getVersion() const { return version; }
+std::string HTTPRequestParser::getVersion() const {
+  return spanString(version);
+}
 
 std::string HTTPRequestParser::getHeader(const std::string& key) const {
-  std::map<std::string, std::string>::const_iterator it = headers.find(key);
-  if (it != headers.end()) return it->second;
+  const HeaderField* field = findField(key.data(), key.size());
+  if (field != NULL) return fieldValue(*field);
+  return "";
+}
+
+std::string HTTPRequestParser::getHeader(HTTPHeaders::Known id) const {
+  const HeaderField* field = findField(id);
+  if (field != NULL) return fieldValue(*field);
   return "";
 }
 
-const std::map<std::string, std::string>& HTTPRequestParser::getHeaders()
-    const {
+const HTTPHeaders& HTTPRequestParser::getHeaders() const {
+  if (!headersBuilt) {
+    // 同じ名前のヘッダーは後のもので上書きする
+    for (size_t i = 0; i < fields.size(); ++i) {
+      headers.set(fields[i].known, spanString(fields[i].name),
+                  fieldValue(fields[i]));
+    }
+    headersBuilt = true;
+  }
   return headers;
 }
 
-std::string HTTPRequestParser::getBody() const { return body; }
+std::string HTTPRequestParser::getBody() const {
+  std::string body;
+  if (sink == &spool) {
+    spool.readAll(body);
+  }
+  return body;
+}
+
+void HTTPRequestParser::setBodySink(BodySink* bodySink) {
+  sink = bodySink != NULL ? bodySink : &spool;
+}
+
+void HTTPRequestParser::setMaxBodySize(size_t limit) {
+  maxBodySize = limit;
+  // ヘッダーの後で設定された場合は，その時点で分かっている長さで判断する
+  if (headersParsed && !parsingError && exceedsMaxBodySize()) {
+    errorMessage = "ボディが大きすぎます";
+    errorStatusCode = 413;
+    parsingError = true;
+  }
+}
+
+void HTTPRequestParser::setHeaderBufferLimits(size_t size, size_t count) {
+  maxLineSize = size;
+  maxHeaderSize = size * count;
+}
 
 void HTTPRequestParser::reset() {
+  // バッファとヘッダーの表は容量を残したまま空にする
   rawBuffer.clear();
+  parsePos = 0;
+  headerEnd = 0;
+  lineStart = 0;
   headersParsed = false;
   requestComplete = false;
   contentLength = 0;
   chunked = false;
-  method.clear();
-  url.clear();
-  version.clear();
+  method = Span();
+  url = Span();
+  version = Span();
+  fields.clear();
+  for (int id = 0; id < HTTPHeaders::KNOWN_COUNT; ++id) {
+    knownFields[id] = -1;
+  }
   headers.clear();
-  body.clear();
+  headersBuilt = false;
+  spool.clear();
+  sink = &spool;
+  bodyLength = 0;
+  maxBodySize = static_cast<size_t>(-1);
   parsingError = false;
   errorMessage.clear();
+  errorStatusCode = 400;
   state = RequestMethodStart;
   chunkSize = 0;
-  chunkSizeStr.clear();
-  currentHeaderName.clear();
-  currentHeaderValue.clear();
+  hasChunkSize = false;
+}
+
+bool HTTPRequestParser::startNextRequest() {
+  // 完了したリクエストの後ろに届いていた分を，バッファの先頭に詰める
+  rawBuffer.erase(0, parsePos);
+  std::string leftover;
+  leftover.swap(rawBuffer);
+  reset();
+  // バッファを使い回す（leftoverは空になったバッファと入れ替える）
+  rawBuffer.swap(leftover);
+  if (rawBuffer.empty()) {
+    return false;
+  }
+  return feed("", 0);
 }
 
 int ft_strcasecmp(const char* a, const char* b) {
@@ -571,22 +800,30 @@ HTTPRequest HTTPRequestParser::createRequest() const {
   }
 
   bool keepAlive = false;
+  std::string versionName = getVersion();
 
   // Keep-Aliveの判定
-  std::map<std::string, std::string>::const_iterator it =
-      headers.find("Connection");
-  if (it != headers.end()) {
-    if (ft_strcasecmp(it->second.c_str(), "keep-alive") == 0) {
+  const HeaderField* connection = findField(HTTPHeaders::CONNECTION);
+  if (connection != NULL) {
+    if (ft_strcasecmp(fieldValue(*connection).c_str(), "keep-alive") == 0) {
       keepAlive = true;
     }
   } else {
     // HTTP/1.1ではデフォルトでKeep-Alive
-    if (version == "HTTP/1.1") {
+    if (versionName == "HTTP/1.1") {
       keepAlive = true;
     }
   }
 
-  return HTTPRequest(method, url, version, headers, body, keepAlive);
+  // 小さなボディはHTTPRequestにコピーし，一時ファイルに溜めたものは参照させる
+  bool spooled = sink == &spool && !spool.inMemory();
+  HTTPRequest request(getMethod(), getURL(), versionName, getHeaders(),
+                      sink == &spool && !spooled ? spool.memory() : "",
+                      keepAlive);
+  if (spooled) {
+    request.setBodySpool(&spool);
+  }
+  return request;
 }
 
 // 追加のヘルパーメソッド
@@ -4,9 +4,17 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "BodySink.hpp"
+#include "HTTPHeaders.hpp"
 #include "HTTPRequest.hpp"
 
+// リクエストラインと1行のヘッダーの上限（large_client_header_buffersのサイズ）
+#define DEFAULT_LARGE_CLIENT_HEADER_BUFFER_SIZE (8 * 1024)
+// ヘッダー全体（リクエストラインを含む）の上限は，サイズ×この数
+#define DEFAULT_LARGE_CLIENT_HEADER_BUFFERS 4
+
 // Forward declaration
 class HTTPRequest;
 
@@ -21,6 +29,17 @@ class HTTPRequest;
  * エラー処理戦略:
  * - 例外ではなくエラーフラグとメッセージを使用
  * - 呼び出し側のコードは解析後にhasError()をチェックする必要がある
+ *
+ * メモリ:
+ * - リクエストラインとヘッダーは受信バッファ（rawBuffer）に残し，
+ *   メソッド・URL・各ヘッダーはバッファ内の位置と長さだけを記録する．
+ *   文字列はアクセサやcreateRequestで求められたときに作る
+ * - ボディはバッファに溜めず，届いた分をまとめて受け取り先（BodySink）へ渡す．
+ *   既定の受け取り先は，小さなボディはメモリに，大きなものは一時ファイルに置く
+ * - バッファとヘッダーの表は次のリクエストでも使い回すので，
+ *   同じ接続の2つ目以降のリクエストは解析中にメモリを確保しない
+ * - リクエストラインとヘッダーは上限（setHeaderBufferLimits）を超えた時点で
+ *   エラー（414・431）にするので，バッファは上限と1回の受信分までしか伸びない
  */
 class HTTPRequestParser {
  public:
@@ -44,6 +63,18 @@ class HTTPRequestParser {
    */
   bool isComplete() const;
 
+  /**
+   * @brief ヘッダーまで受信し終えたかチェック（ボディの受信中を含む）
+   * @return ヘッダーを解析し終えた場合はtrue
+   */
+  bool isHeaderComplete() const;
+
+  /**
+   * @brief 次のリクエストの一部でも受信したかチェック
+   * @return 1バイトでも解析した場合はtrue
+   */
+  bool hasReceivedData() const;
+
   /**
    * @brief 解析中にエラーが発生したかチェック
    * @return エラーがある場合はtrue、それ以外はfalse
@@ -56,14 +87,46 @@ class HTTPRequestParser {
    */
   std::string getErrorMessage() const;
 
+  /**
+   * @brief エラーに対して返すステータスコードを取得
+   * @return ボディが上限を超えた場合は413，リクエストラインが長すぎる場合は
+   *         414，ヘッダーが大きすぎる場合は431，それ以外の解析エラーは400
+   */
+  int getErrorStatusCode() const;
+
   // 解析されたデータのアクセサ
   std::string getMethod() const;
   std::string getURL() const;
   std::string getVersion() const;
   std::string getHeader(const std::string& key) const;
-  const std::map<std::string, std::string>& getHeaders() const;
+  std::string getHeader(HTTPHeaders::Known id) const;
+  const HTTPHeaders& getHeaders() const;
+  // 既定の受け取り先に溜めたボディ全体（テスト用．一時ファイルからも読み出す）
   std::string getBody() const;
 
+  /**
+   * @brief ボディの受け取り先を替える（resetまで有効．NULLなら既定に戻す）
+   *
+   * 受け取り先を替えると，createRequestのHTTPRequestにボディは含まれない
+   */
+  void setBodySink(BodySink* sink);
+
+  /**
+   * @brief ボディの上限（client_max_body_size）を設定する（resetまで有効）
+   *
+   * ヘッダーを解析し終えた後に呼んでもよい．Content-Lengthが上限を超えるか，
+   * チャンクのサイズを足して上限を超えた時点で，ボディを受け取らずに
+   * エラー（413）にする
+   */
+  void setMaxBodySize(size_t limit);
+
+  /**
+   * @brief リクエストラインとヘッダーの上限を設定する（resetの後も有効）
+   * @param size リクエストライン・ヘッダー1行の上限（バイト）
+   * @param count ヘッダー全体はsize×countバイトまで
+   */
+  void setHeaderBufferLimits(size_t size, size_t count);
+
   /**
    * @brief 解析されたデータからHTTPRequestを作成
    * @return HTTPRequestオブジェクト
@@ -75,6 +138,15 @@ class HTTPRequestParser {
    */
   void reset();
 
+  /**
+   * @brief 同じ接続で次のリクエストの解析を始める（パイプライン対応）
+   *
+   * 完了したリクエストの後ろに届いていたバイト列は捨てずに，
+   * 次のリクエストの先頭として解析し直す
+   * @return 残りのバイト列だけで次のリクエストが揃った場合はtrue
+   */
+  bool startNextRequest();
+
  private:
   // パース結果の列挙型
   enum ParseResult { ParsingCompleted, ParsingIncompleted, ParsingError };
@@ -111,40 +183,80 @@ class HTTPRequestParser {
     ChunkDataNewline_2,
     ChunkTrailerStart,
     ChunkTrailer,
+    ChunkTrailerLineNewline,
     ChunkTrailerNewline
   } state;
 
+  // rawBuffer内の文字列の位置
+  struct Span {
+    size_t offset;
+    size_t length;
+
+    Span() : offset(0), length(0) {}
+  };
+
+  // 1つのヘッダー（名前と値の位置）
+  struct HeaderField {
+    Span name;
+    Span value;   // 継続行があれば，継続行の終わりまで
+    bool folded;  // 継続行がある（値を取り出すときに行をつなぐ）
+    HTTPHeaders::Known known;  // 名前を読み終えた時点で見分ける
+  };
+
   // 内部状態
-  std::string rawBuffer;
+  std::string rawBuffer;  // 受信したバイト列（ヘッダーの終わりまでは残す）
+  size_t parsePos;        // rawBufferのうち解析し終えた位置
+  size_t headerEnd;       // ヘッダーの終わり（空行の直後）の位置
+  size_t lineStart;       // 解析中の行（リクエストライン・ヘッダー）の先頭
+  size_t maxLineSize;     // リクエストライン・ヘッダー1行の上限
+  size_t maxHeaderSize;   // ヘッダー全体の上限
   bool headersParsed;
   bool requestComplete;
   size_t contentLength;
   bool chunked;
   size_t chunkSize;
-  std::string chunkSizeStr;
-  std::string currentHeaderName;
-  std::string currentHeaderValue;
+  bool hasChunkSize;
 
   // 解析されたデータ
-  std::string method;
-  std::string url;
-  std::string version;
-  std::map<std::string, std::string> headers;
-  std::string body;
+  Span method;
+  Span url;
+  Span version;
+  std::vector<HeaderField> fields;
+  // 見分けるヘッダーのfields内の位置（同じ名前なら後のもの．なければ-1）
+  int knownFields[HTTPHeaders::KNOWN_COUNT];
+  // getHeadersで初めて参照されたときに作る
+  mutable HTTPHeaders headers;
+  mutable bool headersBuilt;
+  SpoolBodySink spool;  // 既定のボディの受け取り先
+  BodySink* sink;       // ボディの受け取り先
+  size_t bodyLength;    // 受け取り先に渡したボディのバイト数
+  size_t maxBodySize;   // ボディの上限（既定は無制限）
 
   // エラー処理
   bool parsingError;
   std::string errorMessage;
+  int errorStatusCode;
 
   // コピー防止
   HTTPRequestParser(const HTTPRequestParser&);
   HTTPRequestParser& operator=(const HTTPRequestParser&);
 
   // ヘルパーメソッド
-  bool parseRequestLine(const std::string& line);
-  bool parseHeader(const std::string& line);
-  std::string trimString(const std::string& str) const;
-  ParseResult parse(std::string& buffer);
+  ParseResult parse();
+  ParseResult finishHeaders();
+  // これから受け取るボディを含めて上限を超えるか
+  bool exceedsMaxBodySize() const;
+  // posまでのリクエストラインまたはヘッダーが上限に収まるか
+  // （収まらなければエラーのメッセージとステータスコードを設定する）
+  bool checkHeaderSize(size_t pos);
+  std::string spanString(const Span& span) const;
+  std::string fieldValue(const HeaderField& field) const;
+  // ヘッダー名がnameか（大文字・小文字を区別しない）
+  bool fieldNameIs(const HeaderField& field, const char* name,
+                   size_t length) const;
+  // 名前が一致する最後のヘッダー（なければNULL）
+  const HeaderField* findField(const char* name, size_t length) const;
+  const HeaderField* findField(HTTPHeaders::Known id) const;
 
   // 文字検証ヘルパーメソッド
   bool isChar(int c) const;
@@ -0,0 +1,242 @@
+#include "HTTPScanner.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__SSE2__)
+#define HTTP_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+// 1バイトずつの判定
+
+static bool isTokenChar(unsigned char c) {
+  if (c <= 0x20 || c >= 0x7f) {
+    return false;
+  }
+  switch (c) {
+    case '(':
+    case ')':
+    case '<':
+    case '>':
+    case '@':
+    case ',':
+    case ';':
+    case ':':
+    case '\\':
+    case '"':
+    case '/':
+    case '[':
+    case ']':
+    case '?':
+    case '=':
+    case '{':
+    case '}':
+      return false;
+    default:
+      return true;
+  }
+}
+
+// URIとヘッダー値はthreshold未満のバイトとDELで止まる（0x80以上は通す）
+static bool isVisible(unsigned char c, unsigned char threshold) {
+  return c >= threshold && c != 0x7f;
+}
+
+static const char *skipTokenScalar(const char *p, const char *end) {
+  while (p != end && isTokenChar(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+static const char *skipVisibleScalar(const char *p, const char *end,
+                                     unsigned char threshold) {
+  while (p != end && isVisible(*p, threshold)) {
+    ++p;
+  }
+  return p;
+}
+
+#ifdef HTTP_SCANNER_X86
+
+// SSE2（16バイトずつ）
+// 比較は符号付きなので，0x80以上のバイトは負の値として扱われる
+
+static __m128i inRange128(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+// tokenの文字なら0xff
+static __m128i tokenMask128(__m128i v) {
+  __m128i valid = inRange128(v, 0x21, 0x7e);
+  __m128i special = _mm_or_si128(inRange128(v, '(', ')'),
+                                 _mm_or_si128(inRange128(v, ':', '@'),
+                                              inRange128(v, '[', ']')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8('{')));
+  special = _mm_or_si128(special, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+  return _mm_andnot_si128(special, valid);
+}
+
+static __m128i visibleMask128(__m128i v, char threshold) {
+  __m128i valid =
+      _mm_or_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(threshold - 1)),
+                   _mm_cmplt_epi8(v, _mm_setzero_si128()));
+  return _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)), valid);
+}
+
+static const char *skipTokenSSE2(const char *p, const char *end) {
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned int stop = ~_mm_movemask_epi8(tokenMask128(v)) & 0xffff;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+    p += 16;
+  }
+  return skipTokenScalar(p, end);
+}
+
+static const char *skipVisibleSSE2(const char *p, const char *end,
+                                   unsigned char threshold) {
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned int stop =
+        ~_mm_movemask_epi8(visibleMask128(v, threshold)) & 0xffff;
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+    p += 16;
+  }
+  return skipVisibleScalar(p, end, threshold);
+}
+
+// AVX2（32バイトずつ．対応していないCPUでは呼ばない）
+
+#define HTTP_SCANNER_AVX2 __attribute__((target("avx2")))
+
+HTTP_SCANNER_AVX2 static __m256i inRange256(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+HTTP_SCANNER_AVX2 static __m256i tokenMask256(__m256i v) {
+  __m256i valid = inRange256(v, 0x21, 0x7e);
+  __m256i special = _mm256_or_si256(
+      inRange256(v, '(', ')'),
+      _mm256_or_si256(inRange256(v, ':', '@'), inRange256(v, '[', ']')));
+  special =
+      _mm256_or_si256(special, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+  special =
+      _mm256_or_si256(special, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+  special =
+      _mm256_or_si256(special, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+  special =
+      _mm256_or_si256(special, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')));
+  special =
+      _mm256_or_si256(special, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')));
+  return _mm256_andnot_si256(special, valid);
+}
+
+HTTP_SCANNER_AVX2 static __m256i visibleMask256(__m256i v, char threshold) {
+  __m256i valid = _mm256_or_si256(
+      _mm256_cmpgt_epi8(v, _mm256_set1_epi8(threshold - 1)),
+      _mm256_cmpgt_epi8(_mm256_setzero_si256(), v));
+  return _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)),
+                             valid);
+}
+
+HTTP_SCANNER_AVX2 static const char *skipTokenAVX2(const char *p,
+                                                   const char *end) {
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned int stop = ~static_cast<unsigned int>(
+        _mm256_movemask_epi8(tokenMask256(v)));
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+    p += 32;
+  }
+  return skipTokenSSE2(p, end);
+}
+
+HTTP_SCANNER_AVX2 static const char *skipVisibleAVX2(
+    const char *p, const char *end, unsigned char threshold) {
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned int stop = ~static_cast<unsigned int>(
+        _mm256_movemask_epi8(visibleMask256(v, threshold)));
+    if (stop != 0) {
+      return p + __builtin_ctz(stop);
+    }
+    p += 32;
+  }
+  return skipVisibleSSE2(p, end, threshold);
+}
+
+#endif  // HTTP_SCANNER_X86
+
+// 実装の選択（起動時に1度だけCPUを調べる）
+
+static HTTPScanner::Level g_level = HTTPScanner::bestLevel();
+
+HTTPScanner::Level HTTPScanner::bestLevel() {
+#ifdef HTTP_SCANNER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return AVX2;
+  }
+  return SSE2;
+#else
+  return SCALAR;
+#endif
+}
+
+HTTPScanner::Level HTTPScanner::level() { return g_level; }
+
+bool HTTPScanner::setLevel(Level level) {
+  if (level > bestLevel()) {
+    return false;
+  }
+  g_level = level;
+  return true;
+}
+
+const char *HTTPScanner::skipToken(const char *p, const char *end) {
+#ifdef HTTP_SCANNER_X86
+  if (g_level == AVX2) {
+    return skipTokenAVX2(p, end);
+  }
+  if (g_level == SSE2) {
+    return skipTokenSSE2(p, end);
+  }
+#endif
+  return skipTokenScalar(p, end);
+}
+
+const char *HTTPScanner::skipURI(const char *p, const char *end) {
+#ifdef HTTP_SCANNER_X86
+  if (g_level == AVX2) {
+    return skipVisibleAVX2(p, end, 0x21);
+  }
+  if (g_level == SSE2) {
+    return skipVisibleSSE2(p, end, 0x21);
+  }
+#endif
+  return skipVisibleScalar(p, end, 0x21);
+}
+
+const char *HTTPScanner::skipFieldValue(const char *p, const char *end) {
+#ifdef HTTP_SCANNER_X86
+  if (g_level == AVX2) {
+    return skipVisibleAVX2(p, end, 0x20);
+  }
+  if (g_level == SSE2) {
+    return skipVisibleSSE2(p, end, 0x20);
+  }
+#endif
+  return skipVisibleScalar(p, end, 0x20);
+}
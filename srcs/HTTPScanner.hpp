@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @class HTTPScanner
+ * @brief リクエストラインとヘッダーの区切り文字を探す
+ *
+ * トークン（メソッド・ヘッダー名），URI，ヘッダー値として正しいバイトが
+ * 続く間を読み飛ばし，最初の区切り文字（SP・CR・':'）または不正なバイトの
+ * 位置を返す．そのバイトの判定はHTTPRequestParserの状態遷移に任せる．
+ *
+ * x86ではSSE2で16バイトずつ，AVX2が使えるCPUでは32バイトずつ調べる
+ * （実行時にCPUを調べて選ぶ）．それ以外の環境と，端数はバイトずつ調べる
+ */
+class HTTPScanner {
+ public:
+  enum Level { SCALAR, SSE2, AVX2 };
+
+  // tokenの文字（0x21〜0x7Eのうち区切り文字を除く）が続く間を読み飛ばす
+  static const char *skipToken(const char *p, const char *end);
+  // URIの文字（SPと制御文字以外）が続く間を読み飛ばす
+  static const char *skipURI(const char *p, const char *end);
+  // ヘッダー値の文字（制御文字以外）が続く間を読み飛ばす
+  static const char *skipFieldValue(const char *p, const char *end);
+
+  // 使用中の実装
+  static Level level();
+  /**
+   * @brief 実装を切り替える（テスト・ベンチマーク用）
+   * @return CPUが対応していなければ切り替えずfalse
+   */
+  static bool setLevel(Level level);
+  // このCPUで使える最も速い実装
+  static Level bestLevel();
+};
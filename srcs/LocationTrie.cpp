@@ -0,0 +1,107 @@
+#include "LocationTrie.hpp"
+
+#include <algorithm>
+
+// 子の配列を先頭文字で二分探索するための比較
+static bool lessFirst(const std::pair<unsigned char, size_t> &child,
+                      unsigned char c) {
+  return child.first < c;
+}
+
+LocationTrie::LocationTrie() : _nodes(1), _size(0) {}
+
+size_t LocationTrie::findChild(size_t node, unsigned char c) const {
+  const std::vector<std::pair<unsigned char, size_t> > &children =
+      _nodes[node].children;
+  std::vector<std::pair<unsigned char, size_t> >::const_iterator it =
+      std::lower_bound(children.begin(), children.end(), c, lessFirst);
+  return (it != children.end() && it->first == c) ? it->second : 0;
+}
+
+// 先頭文字がcの子を追加する（既にあれば付け替える）
+void LocationTrie::setChild(size_t node, unsigned char c, size_t child) {
+  std::vector<std::pair<unsigned char, size_t> > &children =
+      _nodes[node].children;
+  std::vector<std::pair<unsigned char, size_t> >::iterator it =
+      std::lower_bound(children.begin(), children.end(), c, lessFirst);
+  if (it != children.end() && it->first == c) {
+    it->second = child;
+  } else {
+    children.insert(it, std::make_pair(c, child));
+  }
+}
+
+bool LocationTrie::insert(const std::string &prefix, int value) {
+  size_t node = 0;
+  size_t pos = 0;
+
+  while (pos < prefix.size()) {
+    unsigned char c = prefix[pos];
+    size_t child = findChild(node, c);
+
+    // 一致する辺がなければ，残りをラベルにした葉を追加する
+    if (child == 0) {
+      Node leaf;
+      leaf.label = prefix.substr(pos);
+      leaf.value = value;
+      _nodes.push_back(leaf);
+      setChild(node, c, _nodes.size() - 1);
+      ++_size;
+      return true;
+    }
+
+    // 辺のラベルと一致する長さ
+    const std::string &label = _nodes[child].label;
+    size_t common = 0;
+    while (common < label.size() && pos + common < prefix.size() &&
+           label[common] == prefix[pos + common]) {
+      ++common;
+    }
+
+    // 辺の途中で分かれる場合は，分かれ目に節を作って辺を2つに分ける
+    if (common < label.size()) {
+      Node middle;
+      middle.label = label.substr(0, common);
+      middle.children.push_back(
+          std::make_pair(static_cast<unsigned char>(label[common]), child));
+      _nodes[child].label.erase(0, common);
+      _nodes.push_back(middle);
+      setChild(node, c, _nodes.size() - 1);
+      child = _nodes.size() - 1;
+    }
+    node = child;
+    pos += common;
+  }
+
+  if (_nodes[node].value != -1) {
+    return false;
+  }
+  _nodes[node].value = value;
+  ++_size;
+  return true;
+}
+
+int LocationTrie::findLongestPrefix(const std::string &url,
+                                    size_t length) const {
+  size_t node = 0;
+  size_t pos = 0;
+  int best = _nodes[0].value;
+
+  while (pos < length) {
+    size_t child = findChild(node, url[pos]);
+    if (child == 0) {
+      break;
+    }
+    const std::string &label = _nodes[child].label;
+    if (label.size() > length - pos ||
+        url.compare(pos, label.size(), label) != 0) {
+      break;
+    }
+    node = child;
+    pos += label.size();
+    if (_nodes[node].value != -1) {
+      best = _nodes[node].value;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class LocationTrie
+ * @brief locationのパス（接頭辞）からURLに最も長く一致するものを引く圧縮トライ
+ *
+ * - 子を1つしか持たない節は辺のラベルにまとめる（radix trie）ので，
+ *   検索はlocationの数によらずURLの長さに比例する
+ * - 値はlocationの番号（RouteTable::VirtualServer::locationsの添字）
+ * - 一致は文字単位（"/docs"は"/docs"にも"/docs/a"にも"/docsx"にも一致する）
+ */
+class LocationTrie {
+ public:
+  LocationTrie();
+
+  /**
+   * @brief 接頭辞prefixに値valueを対応づける
+   * @return 既に同じ接頭辞があれば追加せずfalse
+   */
+  bool insert(const std::string &prefix, int value);
+
+  /**
+   * @brief urlの先頭lengthバイトに一致する接頭辞のうち，最も長いものの値
+   * @return 一致するものがなければ-1
+   */
+  int findLongestPrefix(const std::string &url, size_t length) const;
+  int findLongestPrefix(const std::string &url) const {
+    return findLongestPrefix(url, url.size());
+  }
+
+  // 登録されている接頭辞の数
+  size_t size() const { return _size; }
+
+ private:
+  // キャッシュの読み書きは節を直接扱う
+  friend class ConfigCache;
+
+  struct Node {
+    std::string label;  // 親からこの節への辺のラベル
+    int value;          // 値がなければ-1
+    // 辺のラベルの先頭文字 -> 子の節（先頭文字の昇順）
+    std::vector<std::pair<unsigned char, size_t> > children;
+
+    Node() : value(-1) {}
+  };
+
+  // 節は添字で参照する（追加で配列が伸びても参照が壊れないように）
+  std::vector<Node> _nodes;
+  size_t _size;
+
+  // 先頭文字がcの子の節の添字（なければ0．0は根なので子にはならない）
+  size_t findChild(size_t node, unsigned char c) const;
+  void setChild(size_t node, unsigned char c, size_t child);
+};
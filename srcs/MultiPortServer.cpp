@@ -1,6 +1,12 @@
 #include "MultiPortServer.hpp"
 
-MultiPortServer::MultiPortServer() {}
+#include <fcntl.h>
+
+#include <algorithm>
+
+#include "OSInit.hpp"
+
+MultiPortServer::MultiPortServer() : reuse_port(false), routes(NULL) {}
 
 MultiPortServer::~MultiPortServer() {
   // 全サーバーソケットを閉じる
@@ -22,17 +28,14 @@ const std::vector<int>& MultiPortServer::getPorts() const { return ports; }
 
 // FDからポート番号を逆引き
 int MultiPortServer::getPortByFd(int fd) const {
-  std::map<int, int>::const_iterator it = fd_to_port.find(fd);
-  if (it != fd_to_port.end()) {
-    return it->second;
+  if (fd < 0 || static_cast<size_t>(fd) >= fd_to_port.size()) {
+    return -1;  // 見つからない場合
   }
-  return -1;  // 見つからない場合
+  return fd_to_port[fd];
 }
 
-// 指定されたFDがサーバーFDかどうか
-bool MultiPortServer::isServerFd(int fd) const {
-  return fd_to_port.find(fd) != fd_to_port.end();
-}
+// 指定されたFDがサーバーFDかどうか（イベントごとに呼ばれるので表を直接引く）
+bool MultiPortServer::isServerFd(int fd) const { return getPortByFd(fd) != -1; }
 
 // すべてのサーバーソケットをクローズ
 void MultiPortServer::closeSockets() {
@@ -43,7 +46,9 @@ void MultiPortServer::closeSockets() {
   }
   server_fds.clear();
   fd_to_port.clear();
+  fd_to_listener.clear();
   addrs.clear();
+  ports.clear();
 }
 
 // OSInitで初期化したサーバーFDを追加するメソッド
@@ -52,7 +57,17 @@ void MultiPortServer::addServerFd(int fd, int port) {
     return;
   }
   server_fds.push_back(fd);
+  if (std::find(ports.begin(), ports.end(), port) == ports.end()) {
+    ports.push_back(port);
+  }
+  if (static_cast<size_t>(fd) >= fd_to_port.size()) {
+    fd_to_port.resize(fd + 1, -1);
+  }
   fd_to_port[fd] = port;
+  if (static_cast<size_t>(fd) >= fd_to_listener.size()) {
+    fd_to_listener.resize(fd + 1, NULL);
+  }
+  fd_to_listener[fd] = routes != NULL ? routes->findListener(port) : NULL;
 
   // アドレス情報も保存（必要に応じて）
   struct sockaddr_in address;
@@ -61,3 +76,60 @@ void MultiPortServer::addServerFd(int fd, int port) {
   address.sin_port = htons(port);
   addrs.push_back(address);
 }
+
+void MultiPortServer::setReusePort(bool reuse_port) {
+  this->reuse_port = reuse_port;
+}
+
+int MultiPortServer::openPort(int port) {
+  OSInit osInit;
+  ServerData server_data(port);
+  server_data.set_reuse_port(reuse_port);
+  if (!osInit.initServer(server_data)) {
+    return -1;
+  }
+
+  int server_fd = server_data.get_server_fd();
+  // acceptをEAGAINまで繰り返せるように，また複数のワーカーが同じリッスンソケットを
+  // 監視するとき，接続を取り損ねたワーカーがacceptで止まらないようにノンブロッキングにする
+  // CGIの子プロセスには引き継がない
+  if (fcntl(server_fd, F_SETFL, O_NONBLOCK) == -1 ||
+      fcntl(server_fd, F_SETFD, FD_CLOEXEC) == -1) {
+    perror("fcntl");
+  }
+  addServerFd(server_fd, port);
+  return server_fd;
+}
+
+void MultiPortServer::closePort(int port) {
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    int fd = server_fds[i];
+    if (fd_to_port[fd] != port) {
+      continue;
+    }
+    close(fd);
+    fd_to_port[fd] = -1;
+    fd_to_listener[fd] = NULL;
+    server_fds.erase(server_fds.begin() + i);
+    addrs.erase(addrs.begin() + i);
+    ports.erase(std::remove(ports.begin(), ports.end(), port), ports.end());
+    return;
+  }
+}
+
+void MultiPortServer::attachRoutes(const RouteTable& routes) {
+  this->routes = &routes;
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    int fd = server_fds[i];
+    fd_to_listener[fd] = routes.findListener(fd_to_port[fd]);
+  }
+}
+
+const RouteTable* MultiPortServer::getRoutes() const { return routes; }
+
+const RouteTable::Listener* MultiPortServer::getListenerByFd(int fd) const {
+  if (fd < 0 || static_cast<size_t>(fd) >= fd_to_listener.size()) {
+    return NULL;
+  }
+  return fd_to_listener[fd];
+}
@@ -12,12 +12,19 @@
 #include <string>
 #include <vector>
 
+#include "RouteTable.hpp"
+
 class MultiPortServer {
  private:
   std::vector<int> ports;         // 監視するポート番号のリスト
-  std::map<int, int> fd_to_port;  // サーバーFD→ポート番号のマッピング
+  // FDを添字にしたポート番号の表（サーバーFDでない添字は-1）
+  std::vector<int> fd_to_port;
   std::vector<int> server_fds;            // サーバーFDのリスト
   std::vector<struct sockaddr_in> addrs;  // 各ポートのアドレス情報
+  bool reuse_port;  // openPortで作るソケットにSO_REUSEPORTを設定するか
+  // FDを添字にした，各リスナーのホストの索引（routesのもの）
+  std::vector<const RouteTable::Listener*> fd_to_listener;
+  const RouteTable* routes;
 
  public:
   MultiPortServer();
@@ -37,4 +44,29 @@ class MultiPortServer {
 
   // OSInitと連携するための新しいメソッド
   void addServerFd(int fd, int port);
+
+  // openPortの前に呼ぶこと
+  void setReusePort(bool reuse_port);
+
+  /**
+   * @brief portでリッスンするソケットを作り，addServerFdで登録する
+   *
+   * ソケットはノンブロッキング・close-on-execにする．
+   * 設定の再読み込みで呼ばれるので，失敗してもプロセスは終了しない
+   * @return 登録したサーバーFD．失敗した場合は-1
+   */
+  int openPort(int port);
+
+  // portのサーバーソケットだけを閉じて登録を外す（なければ何もしない）
+  void closePort(int port);
+
+  /**
+   * @brief 各リスナーに，そのポートのホストの索引を付ける
+   * @note routesはこの後に付け替えるまで生きていること．
+   *       リスナーを追加した後も呼び直すこと
+   */
+  void attachRoutes(const RouteTable& routes);
+  const RouteTable* getRoutes() const;
+  // サーバーFDに付けたホストの索引（付けていなければNULL）
+  const RouteTable::Listener* getListenerByFd(int fd) const;
 };
@@ -4,13 +4,14 @@ OSInit::OSInit() {}
 
 OSInit::~OSInit() {}
 
-void OSInit::initServer(ServerData &server_data) {
+bool OSInit::initServer(ServerData &server_data) {
   try {
     // サーバーの構築
     server_data.set_address_data();
     server_data.set_server_fd();
     server_data.server_bind();
     server_data.server_listen();
+    return true;
   } catch (const std::exception &e) {
     std::cerr << "Error initializing server on port " << server_data.get_port()
               << ": " << e.what() << std::endl;
@@ -18,6 +19,7 @@ void OSInit::initServer(ServerData &server_data) {
     // エラー発生時にソケットをクローズ
     close_server_fd(server_data);
   }
+  return false;
 }
 
 void OSInit::close_server_fd(ServerData &server_data) {
@@ -16,7 +16,8 @@ class OSInit {
   OSInit();
   ~OSInit();
 
-  void initServer(ServerData &server_data);
+  // 失敗した場合はソケットを閉じてfalseを返す
+  bool initServer(ServerData &server_data);
 
   void close_server_fd(ServerData &server_data);
 };
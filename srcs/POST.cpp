@@ -7,19 +7,18 @@
 #include <cstdio>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 
-POST::POST(Directive rootDirective, HTTPRequest httpRequest)
-    : _rootDirective(rootDirective), _httpRequest(httpRequest) {}
+POST::POST(const Directive& rootDirective, const HTTPRequest& httpRequest)
+    : ContextHandler(rootDirective, httpRequest) {}
+
+POST::POST(RequestContext& context) : ContextHandler(context) {}
 
 // 完全なファイルパスを取得する関数
 std::string POST::getFullPath() const {
-  // ホストディレクティブからrootの値を取得
+  // ホストのrootの値を取得
   std::string rootValue;
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-  if (hostDirective != NULL) {
-    rootValue = hostDirective->getValue("root");
+  if (_server != NULL) {
+    rootValue = _server->root;
   }
 
   // URLとrootを結合して完全なパスを作成
@@ -70,34 +69,11 @@ bool POST::hasWritePermission(const std::string& path) const {
 }
 
 // リクエストボディサイズが制限内か確認する関数
-bool POST::isBodySizeAllowed(const std::string& body) const {
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-
-  if (hostDirective != NULL) {
-    std::string maxBodySizeStr =
-        hostDirective->getValue("client_max_body_size");
-    if (!maxBodySizeStr.empty()) {
-      // クライアント最大ボディサイズを解析
-      size_t maxBodySize = 0;
-      std::istringstream iss(maxBodySizeStr);
-      iss >> maxBodySize;
-
-      // サイズ単位（M, K, G）があれば考慮
-      if (iss.peek() == 'M' || iss.peek() == 'm') {
-        maxBodySize *= 1024 * 1024;  // メガバイト
-      } else if (iss.peek() == 'K' || iss.peek() == 'k') {
-        maxBodySize *= 1024;  // キロバイト
-      } else if (iss.peek() == 'G' || iss.peek() == 'g') {
-        maxBodySize *= 1024 * 1024 * 1024;  // ギガバイト
-      }
-
-      return body.size() <= maxBodySize;
-    }
-  }
-
+bool POST::isBodySizeAllowed(size_t bodySize) const {
   // 制限が指定されていない場合はデフォルトで1MBに制限
-  return body.size() <= 1024 * 1024;
+  size_t maxBodySize = _server != NULL ? _server->maxBodySize
+                                       : DEFAULT_CLIENT_MAX_BODY_SIZE;
+  return bodySize <= maxBodySize;
 }
 
 // 指定されたディレクトリにPOSTが許可されているか確認する関数
@@ -108,90 +84,21 @@ bool POST::isPostAllowedForPath(const std::string& path) const {
   // URLからパスを取得
   std::string url = _httpRequest.getURL();
 
-  // ホストディレクティブを取得
-  const Directive* hostDirective =
-      _rootDirective.findDirective(_httpRequest.getServerName());
-
-  if (hostDirective == NULL) {
-    return true;  // ホストディレクティブが見つからなければデフォルトで許可
-  }
-
-  // 最適なlocationディレクティブを探す
-  std::string bestMatch = "";
-  const Directive* bestLocationDirective = NULL;
-
-  // ホストディレクティブの子ディレクティブを探索
-  const Directive::DirectiveList& children = hostDirective->children();
-  for (size_t i = 0; i < children.size(); i++) {
-    if (children[i].name() == "location") {
-      // locationディレクティブからパス値を取得
-      std::string locationPath = "";
-      Directive::KVMap::const_iterator it =
-          children[i].keyValues().find("path");
-      if (it != children[i].keyValues().end() && !it->second.empty()) {
-        locationPath = it->second[0];
-      }
-
-      // URLがlocationPathで始まるかチェック
-      if (url.find(locationPath) == 0) {
-        // より長いマッチを優先 (より具体的なlocation)
-        if (locationPath.length() > bestMatch.length()) {
-          bestMatch = locationPath;
-          bestLocationDirective = &children[i];
-        }
-      }
-    }
+  if (_server == NULL) {
+    return true;  // ホストが見つからなければデフォルトで許可
   }
 
-  if (bestLocationDirective != NULL) {
-    // limit_except ディレクティブの値を確認
-    std::string allowedMethods =
-        bestLocationDirective->getValue("limit_except");
-    if (!allowedMethods.empty()) {
-      // POSTメソッドが許可されているか確認
-      return allowedMethods.find("POST") != std::string::npos;
-    }
+  // URLに最も長く一致するlocationのlimit_exceptの値を確認
+  const RouteTable::Location* location = _server->findLocation(url);
+  if (location != NULL && !location->limitExcept.empty()) {
+    // POSTメソッドが許可されているか確認
+    return location->limitExcept.find("POST") != std::string::npos;
   }
 
   // マッチするlocationディレクティブが見つからない場合はデフォルトで許可
   return true;
 }
 
-// チャンク転送エンコーディングを処理する関数
-std::string POST::processChunkedBody(const std::string& chunkedBody) {
-  std::string result;
-  size_t pos = 0;
-
-  while (pos < chunkedBody.size()) {
-    // チャンクサイズを読み取る
-    size_t eol = chunkedBody.find("\r\n", pos);
-    if (eol == std::string::npos) break;
-
-    std::string chunkSizeHex = chunkedBody.substr(pos, eol - pos);
-    // 16進数サイズを取得
-    size_t chunkSize = 0;
-    std::istringstream iss(chunkSizeHex);
-    iss >> std::hex >> chunkSize;
-
-    // サイズが0ならチャンク終了
-    if (chunkSize == 0) break;
-
-    // チャンクデータの開始位置
-    size_t dataStart = eol + 2;
-    if (dataStart + chunkSize <= chunkedBody.size()) {
-      // チャンクデータをresultに追加
-      result.append(chunkedBody, dataStart, chunkSize);
-      // 次のチャンクへ
-      pos = dataStart + chunkSize + 2;  // +2 for \r\n after chunk data
-    } else {
-      // チャンクデータが不完全
-      break;
-    }
-  }
-
-  return result;
-}
-
 // ファイルにデータを書き込む関数
 bool POST::writeToFile(const std::string& filePath,
                        const std::string& content) {
@@ -209,6 +116,24 @@ bool POST::writeToFile(const std::string& filePath,
   return success;
 }
 
+// リクエストボディをファイルに書き込む関数
+bool POST::writeBodyToFile(const std::string& filePath) {
+  // ファイルを開く（既存ファイルは上書き）
+  int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1) {
+    return false;
+  }
+
+  // 受信したボディを（一時ファイルにあれば少しずつ読み出して）書き込む
+  FileBodySink sink(fd);
+  bool success = _httpRequest.writeBodyTo(sink);
+  if (close(fd) == -1) {
+    success = false;
+  }
+
+  return success;
+}
+
 // HTTPステータスコードを設定する関数
 void POST::setHttpStatusCode(HTTPResponse& httpResponse,
                              const std::string& fullPath) {
@@ -226,16 +151,9 @@ void POST::setHttpStatusCode(HTTPResponse& httpResponse,
     return;
   }
 
-  // リクエストボディのサイズ確認
-  std::string body = _httpRequest.getBody();
-
-  // チャンク転送の場合はデコード
-  if (_httpRequest.getHeader("Transfer-Encoding") == "chunked") {
-    body = processChunkedBody(body);
-  }
-
   // ボディサイズ制限チェック
-  if (!isBodySizeAllowed(body)) {
+  // （チャンク転送のボディはパーサーがデコード済みなので，そのまま数える）
+  if (!isBodySizeAllowed(_httpRequest.getBodySize())) {
     httpResponse.setHttpStatusCode(413);  // Request Entity Too Large
     return;
   }
@@ -275,13 +193,15 @@ void POST::setHttpStatusCode(HTTPResponse& httpResponse,
 
 // マルチパートフォームデータかどうか確認する関数
 bool POST::isMultipartForm() const {
-  std::string contentType = _httpRequest.getHeader("Content-Type");
+  const std::string& contentType =
+      _httpRequest.getHeader(HTTPHeaders::CONTENT_TYPE);
   return contentType.find("multipart/form-data") != std::string::npos;
 }
 
 // Content-Typeヘッダーから境界区切り文字を抽出する関数
 std::string POST::extractBoundary() const {
-  std::string contentType = _httpRequest.getHeader("Content-Type");
+  const std::string& contentType =
+      _httpRequest.getHeader(HTTPHeaders::CONTENT_TYPE);
   size_t boundaryPos = contentType.find("boundary=");
 
   if (boundaryPos == std::string::npos) {
@@ -394,7 +314,6 @@ std::vector<POST::MultipartData> POST::parseMultipartFormData(
 // マルチパートフォームを処理する関数
 bool POST::handleMultipartForm(HTTPResponse& httpResponse,
                                const std::string& dirPath) {
-  std::string body = _httpRequest.getBody();
   std::string boundary = extractBoundary();
 
   if (boundary.empty()) {
@@ -402,6 +321,12 @@ bool POST::handleMultipartForm(HTTPResponse& httpResponse,
     return false;
   }
 
+  // パートの境界を探すため，マルチパートのボディはメモリに読み出す
+  std::string body;
+  if (!_httpRequest.readBody(body)) {
+    httpResponse.setHttpStatusCode(500);  // Internal Server Error
+    return false;
+  }
   std::vector<MultipartData> parts = parseMultipartFormData(body, boundary);
 
   if (parts.empty()) {
@@ -455,23 +380,16 @@ bool POST::handlePostRequest(HTTPResponse& httpResponse,
   }
 
   // 通常のPOST処理（既存のコード）
-  std::string body = _httpRequest.getBody();
-
-  // チャンク転送の場合はデコード
-  if (_httpRequest.getHeader("Transfer-Encoding") == "chunked") {
-    body = processChunkedBody(body);
-  }
-
   // CGIスクリプトかどうか確認
   if (fullPath.find(".py") != std::string::npos ||
       fullPath.find(".sh") != std::string::npos) {
     // CGIハンドラを呼び出す
-    CGI cgi = CGI(_rootDirective, _httpRequest);
+    CGI cgi(_context);
     cgi.handleRequest(httpResponse);
     return true;
   } else {
     // 通常のファイル書き込み
-    if (writeToFile(fullPath, body)) {
+    if (writeBodyToFile(fullPath)) {
       httpResponse.setHttpStatusCode(201);  // Created
       return true;
     } else {
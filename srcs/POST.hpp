@@ -1,14 +1,11 @@
 #pragma once
 
 #include "CGI.hpp"
+#include "ContextHandler.hpp"
 #include "GenerateHTTPResponse.hpp"
-#include "Handler.hpp"
 
-class POST : public Handler {
+class POST : public ContextHandler {
  private:
-  Directive _rootDirective;
-  HTTPRequest _httpRequest;
-
   // リクエストされたURLの完全なファイルパスを取得する関数
   std::string getFullPath() const;
 
@@ -23,8 +20,8 @@ class POST : public Handler {
   // ファイルにデータを書き込む関数
   bool writeToFile(const std::string& filePath, const std::string& content);
 
-  // チャンク転送エンコーディングを処理する関数
-  std::string processChunkedBody(const std::string& chunkedBody);
+  // リクエストボディをファイルに書き込む関数（ボディをメモリにまとめない）
+  bool writeBodyToFile(const std::string& filePath);
 
   // ファイルが存在するか確認する関数
   bool fileExists(const std::string& filePath) const;
@@ -36,7 +33,7 @@ class POST : public Handler {
   bool hasWritePermission(const std::string& path) const;
 
   // リクエストボディサイズが制限内か確認する関数
-  bool isBodySizeAllowed(const std::string& body) const;
+  bool isBodySizeAllowed(size_t bodySize) const;
 
   // 指定されたディレクトリにPOSTが許可されているか確認する関数
   bool isPostAllowedForPath(const std::string& path) const;
@@ -61,6 +58,7 @@ class POST : public Handler {
                            const std::string& dirPath);
 
  public:
-  POST(Directive rootDirective, HTTPRequest httpRequest);
+  POST(const Directive& rootDirective, const HTTPRequest& httpRequest);
+  explicit POST(RequestContext& context);
   void handleRequest(HTTPResponse& httpResponse);
 };
@@ -0,0 +1,94 @@
+#include "PollEventLoop.hpp"
+
+// EventLoopのフラグをpollのイベントに変換する
+static short toPollEvents(int events) {
+  short pollEvents = 0;
+  if (events & EventLoop::READ) pollEvents |= POLLIN;
+  if (events & EventLoop::WRITE) pollEvents |= POLLOUT;
+  return pollEvents;
+}
+
+// pollのイベントをEventLoopのフラグに変換する
+static int fromPollEvents(short revents) {
+  int events = 0;
+  if (revents & POLLIN) events |= EventLoop::READ;
+  if (revents & POLLOUT) events |= EventLoop::WRITE;
+  if (revents & (POLLERR | POLLHUP | POLLNVAL)) events |= EventLoop::ERROR;
+  return events;
+}
+
+PollEventLoop::PollEventLoop() {}
+
+PollEventLoop::~PollEventLoop() {}
+
+long PollEventLoop::indexOf(int fd) const {
+  if (fd < 0 || static_cast<size_t>(fd) >= fd_to_index.size()) {
+    return -1;
+  }
+  return fd_to_index[fd];
+}
+
+bool PollEventLoop::add(int fd, int events) {
+  if (fd < 0 || indexOf(fd) >= 0) {
+    return false;
+  }
+  if (static_cast<size_t>(fd) >= fd_to_index.size()) {
+    fd_to_index.resize(fd + 1, -1);
+  }
+  pollfd poll_fd;
+  poll_fd.fd = fd;
+  poll_fd.events = toPollEvents(events);
+  poll_fd.revents = 0;
+  fd_to_index[fd] = poll_fds.size();
+  poll_fds.push_back(poll_fd);
+  return true;
+}
+
+bool PollEventLoop::modify(int fd, int events) {
+  long index = indexOf(fd);
+  if (index < 0) {
+    return false;
+  }
+  poll_fds[index].events = toPollEvents(events);
+  return true;
+}
+
+void PollEventLoop::remove(int fd) {
+  long index = indexOf(fd);
+  if (index < 0) {
+    return;
+  }
+  // 末尾の要素を削除位置に移動してから末尾を取り除く（eraseによるずれを避ける）
+  size_t last = poll_fds.size() - 1;
+  if (static_cast<size_t>(index) != last) {
+    poll_fds[index] = poll_fds[last];
+    fd_to_index[poll_fds[index].fd] = index;
+  }
+  poll_fds.pop_back();
+  fd_to_index[fd] = -1;
+}
+
+int PollEventLoop::wait(std::vector<Event> &fired, int timeout_ms) {
+  fired.clear();
+  int ready = poll(poll_fds.data(), poll_fds.size(), timeout_ms);
+  if (ready <= 0) {
+    return ready;
+  }
+
+  // pollは発生したFDを教えてくれないので，全FDを調べる必要がある
+  for (size_t i = 0; i < poll_fds.size() && fired.size() < (size_t)ready;
+       ++i) {
+    if (poll_fds[i].revents == 0) {
+      continue;
+    }
+    Event event;
+    event.fd = poll_fds[i].fd;
+    event.events = fromPollEvents(poll_fds[i].revents);
+    fired.push_back(event);
+  }
+  return fired.size();
+}
+
+size_t PollEventLoop::size() const { return poll_fds.size(); }
+
+const char *PollEventLoop::name() const { return "poll"; }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <poll.h>
+
+#include <vector>
+
+#include "EventLoop.hpp"
+
+// poll()によるイベントループ（どのOSでも動くバックエンド）
+// 1回のwaitのコストは監視中のFDの総数に比例する
+class PollEventLoop : public EventLoop {
+ private:
+  std::vector<pollfd> poll_fds;
+  // FDを添字にしたpoll_fds内の位置（監視していないFDは-1）
+  // 削除時に末尾と入れ替えて詰めるために使う
+  std::vector<long> fd_to_index;
+
+  long indexOf(int fd) const;
+
+ public:
+  PollEventLoop();
+  ~PollEventLoop();
+
+  bool add(int fd, int events);
+  bool modify(int fd, int events);
+  void remove(int fd);
+  int wait(std::vector<Event> &fired, int timeout_ms);
+  size_t size() const;
+  const char *name() const;
+
+  const std::vector<pollfd> &get_poll_fds() const { return poll_fds; }
+};
@@ -17,6 +17,12 @@ void sendFileContent(int fd, int client_socket) {
 
 PrintResponse::PrintResponse(int client_socket) {
   this->client_socket = client_socket;
+  this->output_buffer = NULL;
+}
+
+PrintResponse::PrintResponse(std::string& output_buffer) {
+  this->client_socket = -1;
+  this->output_buffer = &output_buffer;
 }
 
 PrintResponse::~PrintResponse() {}
@@ -36,6 +42,16 @@ void sendABit(const int client_socket, const std::string& str) {
 }
 
 void PrintResponse::handleRequest(HTTPResponse& httpResponse) {
+  // 送信キューが指定されている場合は，レスポンス全体をキューに積むだけにする
+  // 実際の送信はpollループがPOLLOUTを受けてから少しずつ行う
+  if (output_buffer != NULL) {
+    output_buffer->append(httpResponse.getHttpStatusLine());
+    output_buffer->append(httpResponse.getHttpResponseHeader());
+    output_buffer->append("\r\n");
+    output_buffer->append(httpResponse.getHttpResponseBody());
+    return;
+  }
+
   // mock(httpResponse);
   // ステータスラインを送信
   if (send(client_socket, httpResponse.getHttpStatusLine().c_str(),
@@ -21,9 +21,12 @@
 class PrintResponse : public Handler {
  private:
   int client_socket;
+  // 非NULLの場合は，ソケットに直接送らずこのバッファ（送信キュー）に書き出す
+  std::string* output_buffer;
 
  public:
   PrintResponse(int client_socket);
+  PrintResponse(std::string& output_buffer);
   ~PrintResponse();
   void handleRequest(HTTPResponse& httpResponse);
   static std::vector<std::string> asshuku(int fd);
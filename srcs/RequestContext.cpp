@@ -0,0 +1,60 @@
+#include "RequestContext.hpp"
+
+RequestContext::RequestContext(const RouteTable &routes, HTTPRequest &request)
+    : _ownedRoutes(NULL),
+      _ownedRequest(NULL),
+      _routes(&routes),
+      _request(&request),
+      _server(routes.findServer(request.getServerName())),
+      _location(NULL),
+      _locationResolved(false) {}
+
+RequestContext::RequestContext(const RouteTable &routes,
+                               const RouteTable::Listener *listener,
+                               HTTPRequest &request)
+    : _ownedRoutes(NULL),
+      _ownedRequest(NULL),
+      _routes(&routes),
+      _request(&request),
+      _server(listener != NULL
+                  ? routes.findServer(*listener, request.getServerName())
+                  : NULL),
+      _location(NULL),
+      _locationResolved(false) {}
+
+RequestContext::RequestContext(const Directive &rootDirective,
+                               const HTTPRequest &request)
+    : _ownedRoutes(new RouteTable(rootDirective)),
+      _ownedRequest(new HTTPRequest(request)),
+      _routes(_ownedRoutes),
+      _request(_ownedRequest),
+      _server(_routes->findServer(request.getServerName())),
+      _location(NULL),
+      _locationResolved(false) {}
+
+RequestContext::~RequestContext() {
+  delete _ownedRoutes;
+  delete _ownedRequest;
+}
+
+const RouteTable::Location *RequestContext::getLocation() {
+  if (!_locationResolved) {
+    _location =
+        _server != NULL ? _server->findLocation(_request->getURL()) : NULL;
+    _locationResolved = true;
+  }
+  return _location;
+}
+
+const RouteTable::Route *RequestContext::getRoute() {
+  if (_server == NULL) {
+    return NULL;
+  }
+  const RouteTable::Location *location = getLocation();
+  return location != NULL ? &location->route : &_server->route;
+}
+
+void RequestContext::setURL(const std::string &url) {
+  _request->setURL(url);
+  _locationResolved = false;
+}
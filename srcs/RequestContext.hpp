@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include "Directive.hpp"
+#include "HTTPRequest.hpp"
+#include "RouteTable.hpp"
+
+/**
+ * @class RequestContext
+ * @brief 1つのリクエストを処理する間，Handlerの鎖が参照で共有する情報
+ *
+ * 設定のルーティング表とリクエストはコピーせずに参照し，
+ * ホストとlocationは1度だけ引いて覚えておく．
+ */
+class RequestContext {
+ public:
+  // 設定のルーティング表とリクエストを借りる（どちらもこの文脈より長く生きること）
+  RequestContext(const RouteTable &routes, HTTPRequest &request);
+  // 受け付けたポートの索引でホストを選ぶ（listenerがNULLならホストなし）
+  RequestContext(const RouteTable &routes, const RouteTable::Listener *listener,
+                 HTTPRequest &request);
+  // Directiveから作る（テストなど）．ルーティング表とリクエストは自分で持つ
+  RequestContext(const Directive &rootDirective, const HTTPRequest &request);
+  ~RequestContext();
+
+  HTTPRequest &getRequest() const { return *_request; }
+  const RouteTable &getRoutes() const { return *_routes; }
+
+  // リクエストのホスト（なければNULL）
+  const RouteTable::VirtualServer *getServer() const { return _server; }
+
+  // URLに最も長く一致するlocation（なければNULL）
+  const RouteTable::Location *getLocation();
+
+  /**
+   * @brief URLに対して有効な設定値（ホストが見つからなければNULL）
+   * @note locationがあればその値，なければホスト直下の値
+   */
+  const RouteTable::Route *getRoute();
+
+  // URLを書き換える（リダイレクト）．locationは次に参照されたときに引き直す
+  void setURL(const std::string &url);
+
+ private:
+  RouteTable *_ownedRoutes;
+  HTTPRequest *_ownedRequest;
+  const RouteTable *_routes;
+  HTTPRequest *_request;
+  const RouteTable::VirtualServer *_server;
+  const RouteTable::Location *_location;
+  bool _locationResolved;
+
+  // コピー防止（自分の持つルーティング表やリクエストを指すことがあるため）
+  RequestContext(const RequestContext &);
+  RequestContext &operator=(const RequestContext &);
+};
@@ -0,0 +1,326 @@
+#include "RouteTable.hpp"
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+// ディレクティブ以下（子を含む）に現れるキーを集める
+static void collectKeys(const Directive &directive,
+                        std::set<std::string> &keys) {
+  const Directive::KVMap &keyValues = directive.keyValues();
+  for (Directive::KVMap::const_iterator it = keyValues.begin();
+       it != keyValues.end(); ++it) {
+    keys.insert(it->first);
+  }
+  for (size_t i = 0; i < directive.children().size(); ++i) {
+    collectKeys(directive.children()[i], keys);
+  }
+}
+
+// 先頭が空文字列の値は指定されていないものとして扱う
+static bool hasValue(const std::vector<std::string> &values) {
+  return !values.empty() && !values[0].empty();
+}
+
+// "404"のような10進数のステータスコードか（"0404"などは一致しない）
+static bool parseStatusCode(const std::string &str, int &statusCode) {
+  if (str.empty() || str.size() > 3 || (str[0] == '0' && str.size() > 1)) {
+    return false;
+  }
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] < '0' || str[i] > '9') {
+      return false;
+    }
+  }
+  statusCode = std::atoi(str.c_str());
+  return true;
+}
+
+// "10M"のようなサイズを解析する（単位はK, M, G）
+static size_t parseBodySize(const std::string &str) {
+  size_t size = 0;
+  std::istringstream iss(str);
+  iss >> size;
+
+  if (iss.peek() == 'M' || iss.peek() == 'm') {
+    size *= 1024 * 1024;  // メガバイト
+  } else if (iss.peek() == 'K' || iss.peek() == 'k') {
+    size *= 1024;  // キロバイト
+  } else if (iss.peek() == 'G' || iss.peek() == 'g') {
+    size *= 1024 * 1024 * 1024;  // ギガバイト
+  }
+  return size;
+}
+
+RouteTable::RouteTable(const Directive &rootDirective) {
+  const Directive::DirectiveList &hosts = rootDirective.children();
+  for (size_t i = 0; i < hosts.size(); ++i) {
+    // 同じ名前のホストが複数あれば最初のものを使う
+    int index = static_cast<int>(_servers.size());
+    if (!_serverNames.insert(hosts[i].name(), index)) {
+      continue;
+    }
+    _servers.push_back(VirtualServer());
+    compileServer(hosts[i], _servers.back());
+    addListeners(index);
+  }
+}
+
+// ホストがlistenする各ポートの索引に，ホストを加える
+void RouteTable::addListeners(int index) {
+  const VirtualServer &server = _servers[index];
+  for (size_t i = 0; i < server.listen.size(); ++i) {
+    std::istringstream iss(server.listen[i]);
+    int port;
+    if (!(iss >> port)) {
+      continue;
+    }
+
+    Listener &listener = _listeners[port];
+    listener.port = port;
+    if (listener.defaultServer == -1) {
+      listener.defaultServer = index;
+    }
+    if (server.name.compare(0, 2, "*.") == 0) {
+      listener.wildcards.insert(server.name.substr(1), index);
+    } else {
+      listener.names.insert(server.name, index);
+    }
+  }
+}
+
+void RouteTable::compileServer(const Directive &hostDirective,
+                               VirtualServer &server) {
+  server.name = hostDirective.name();
+  server.root = hostDirective.getValue("root");
+  server.listen = hostDirective.getValues("listen");
+
+  std::string maxBodySize = hostDirective.getValue("client_max_body_size");
+  if (!maxBodySize.empty()) {
+    server.maxBodySize = parseBodySize(maxBodySize);
+  }
+
+  // ホスト直下の値
+  const Directive::KVMap &hostValues = hostDirective.keyValues();
+  for (Directive::KVMap::const_iterator it = hostValues.begin();
+       it != hostValues.end(); ++it) {
+    if (hasValue(it->second)) {
+      server.route.values.insert(*it);
+    }
+  }
+  compileRoute(server.route);
+
+  const Directive::DirectiveList &children = hostDirective.children();
+  bool errorPageFound = false;
+  for (size_t i = 0; i < children.size(); ++i) {
+    const Directive &child = children[i];
+
+    // [host.error_page]（最初のものだけを使う）
+    if (child.name() == "error_page" && !errorPageFound) {
+      errorPageFound = true;
+      std::set<std::string> keys;
+      collectKeys(child, keys);
+      for (std::set<std::string>::const_iterator it = keys.begin();
+           it != keys.end(); ++it) {
+        int statusCode;
+        std::string page = child.getValue(*it);
+        if (parseStatusCode(*it, statusCode) && !page.empty()) {
+          server.errorPages[statusCode] = page;
+        }
+      }
+    }
+    if (child.name() != "location") {
+      continue;
+    }
+
+    // [host.location]にpathがあれば，そのパスのlocationとして扱う
+    Directive::KVMap::const_iterator path = child.keyValues().find("path");
+    if (path != child.keyValues().end() && hasValue(path->second)) {
+      Directive::KVMap values = child.keyValues();
+      values.erase("path");
+      addLocation(server, path->second[0], values);
+    }
+
+    // [host.location."<path>"]
+    for (size_t j = 0; j < child.children().size(); ++j) {
+      const Directive &locationDirective = child.children()[j];
+      const std::string &name = locationDirective.name();
+
+      std::set<std::string> keys;
+      collectKeys(locationDirective, keys);
+      Directive::KVMap values;
+      for (std::set<std::string>::const_iterator it = keys.begin();
+           it != keys.end(); ++it) {
+        values[*it] = locationDirective.getValues(*it);
+      }
+      addLocation(server, name, values);
+
+      // [host.location."*.css"]のようなlocationはContent-Typeを指定する
+      std::string contentType = locationDirective.getValue("Content-Type");
+      if (name.size() > 1 && name[0] == '*' && !contentType.empty()) {
+        // セミコロンで終わっている場合は除去
+        if (contentType[contentType.length() - 1] == ';') {
+          contentType.erase(contentType.length() - 1);
+        }
+        server.mimeTypes.insert(std::make_pair(name.substr(1), contentType));
+      }
+    }
+  }
+}
+
+void RouteTable::addLocation(VirtualServer &server, const std::string &name,
+                             const Directive::KVMap &values) {
+  Location location;
+  location.exact = name.compare(0, 2, "= ") == 0;
+  location.path = location.exact ? name.substr(2) : name;
+  // "*.css"などはパスではない
+  if (location.path.empty() || location.path[0] != '/') {
+    return;
+  }
+
+  // 同じパスのlocationが複数あれば最初のものを使う
+  size_t index = server.locations.size();
+  if (location.exact) {
+    if (!server.exactLocations.insert(std::make_pair(location.path, index))
+             .second) {
+      return;
+    }
+  } else if (!server.prefixLocations.insert(location.path,
+                                            static_cast<int>(index))) {
+    return;
+  }
+
+  // location内の値を優先し，なければホスト直下の値で補う
+  for (Directive::KVMap::const_iterator it = values.begin();
+       it != values.end(); ++it) {
+    if (hasValue(it->second)) {
+      location.route.values.insert(*it);
+    }
+  }
+  location.index = location.route.getValue("index");
+  location.limitExcept = location.route.getValue("limit_except");
+  location.route.values.insert(server.route.values.begin(),
+                               server.route.values.end());
+  compileRoute(location.route);
+  server.locations.push_back(location);
+}
+
+void RouteTable::compileRoute(Route &route) {
+  route.root = route.getValue("root");
+  route.index = route.getValue("index");
+  route.autoindex = route.getValue("autoindex") == "on";
+  route.redirect = route.getValue("return");
+
+  const std::vector<std::string> &deny = route.getValues("deny");
+  for (size_t i = 0; i < deny.size(); ++i) {
+    unsigned int bit = methodBit(deny[i]);
+    if (bit != 0) {
+      route.denyMask |= bit;
+    } else {
+      route.denyOthers.push_back(deny[i]);
+    }
+  }
+}
+
+const RouteTable::VirtualServer *RouteTable::findServer(
+    const std::string &name) const {
+  int index = _serverNames.find(name);
+  return index >= 0 ? &_servers[index] : NULL;
+}
+
+const RouteTable::Listener *RouteTable::findListener(int port) const {
+  std::map<int, Listener>::const_iterator it = _listeners.find(port);
+  return it != _listeners.end() ? &it->second : NULL;
+}
+
+const RouteTable::VirtualServer *RouteTable::findServer(
+    const Listener &listener, const std::string &host) const {
+  int index = listener.names.find(host);
+
+  // "a.b.example.com"なら".b.example.com"，".example.com"，".com"の順に探す
+  for (size_t dot = host.find('.'); index < 0 && dot != std::string::npos;
+       dot = host.find('.', dot + 1)) {
+    index = listener.wildcards.find(host.data() + dot, host.size() - dot);
+  }
+
+  if (index < 0) {
+    index = listener.defaultServer;
+  }
+  return index >= 0 ? &_servers[index] : NULL;
+}
+
+unsigned int RouteTable::methodBit(const std::string &method) {
+  if (method == "GET") return METHOD_GET;
+  if (method == "HEAD") return METHOD_HEAD;
+  if (method == "POST") return METHOD_POST;
+  if (method == "PUT") return METHOD_PUT;
+  if (method == "DELETE") return METHOD_DELETE;
+  if (method == "OPTIONS") return METHOD_OPTIONS;
+  if (method == "PATCH") return METHOD_PATCH;
+  return 0;
+}
+
+const std::vector<std::string> &RouteTable::Route::getValues(
+    const std::string &key) const {
+  static const std::vector<std::string> empty;
+  Directive::KVMap::const_iterator it = values.find(key);
+  return it != values.end() ? it->second : empty;
+}
+
+std::string RouteTable::Route::getValue(const std::string &key) const {
+  Directive::KVMap::const_iterator it = values.find(key);
+  return it != values.end() ? it->second[0] : "";
+}
+
+bool RouteTable::Route::denies(const std::string &method) const {
+  unsigned int bit = methodBit(method);
+  if (bit != 0) {
+    return (denyMask & bit) != 0;
+  }
+  for (size_t i = 0; i < denyOthers.size(); ++i) {
+    if (denyOthers[i] == method) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const RouteTable::Location *RouteTable::VirtualServer::findLocation(
+    const std::string &url) const {
+  size_t length = url.find('?');
+  if (length == std::string::npos) {
+    length = url.size();
+  }
+
+  if (!exactLocations.empty()) {
+    std::map<std::string, size_t>::const_iterator it =
+        exactLocations.find(url.substr(0, length));
+    if (it != exactLocations.end()) {
+      return &locations[it->second];
+    }
+  }
+  int index = prefixLocations.findLongestPrefix(url, length);
+  return index >= 0 ? &locations[index] : NULL;
+}
+
+bool RouteTable::VirtualServer::listens(const std::string &port) const {
+  for (size_t i = 0; i < listen.size(); ++i) {
+    if (listen[i] == port) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::string *RouteTable::VirtualServer::findErrorPage(
+    int statusCode) const {
+  std::map<int, std::string>::const_iterator it = errorPages.find(statusCode);
+  return it != errorPages.end() ? &it->second : NULL;
+}
+
+const std::string *RouteTable::VirtualServer::findMimeType(
+    const std::string &extension) const {
+  std::map<std::string, std::string>::const_iterator it =
+      mimeTypes.find(extension);
+  return it != mimeTypes.end() ? &it->second : NULL;
+}
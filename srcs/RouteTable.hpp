@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Directive.hpp"
+#include "LocationTrie.hpp"
+#include "StringTable.hpp"
+
+// client_max_body_sizeが指定されていない場合の上限（1MB）
+#define DEFAULT_CLIENT_MAX_BODY_SIZE (1024 * 1024)
+
+/**
+ * @class RouteTable
+ * @brief 設定（Directiveの木）を読み込み時に1度だけ変換した，平らなルーティング表
+ *
+ * リクエストの処理ではDirectiveの木を辿らず，ホスト名でVirtualServerを，
+ * URLでLocationを1度ずつ引くだけで設定値が得られる．
+ * - ホストはポートごとの索引（Listener）から選ぶ．Hostヘッダーの名前と完全に
+ *   一致するもの，"*.example.com"のようなワイルドカード（長いものを優先），
+ *   そのポートで最初に定義されたホスト（デフォルト）の順に探す
+ * - locationはパスの前方一致で選び，最も長く一致するものを使う．
+ *   "= /"のように"= "で始まるlocationはURLと完全に一致する場合だけ使い，
+ *   前方一致より優先する
+ * - Locationの値は，location内で見つからない値をホスト直下の値で補ったもの
+ * - 先頭が空文字列の値は，指定されていないものとして扱う
+ */
+class RouteTable {
+ public:
+  // denyを判定するためのHTTPメソッドのビット
+  enum MethodBit {
+    METHOD_GET = 1 << 0,
+    METHOD_HEAD = 1 << 1,
+    METHOD_POST = 1 << 2,
+    METHOD_PUT = 1 << 3,
+    METHOD_DELETE = 1 << 4,
+    METHOD_OPTIONS = 1 << 5,
+    METHOD_PATCH = 1 << 6
+  };
+
+  // ホスト直下，またはlocationで有効な設定値
+  struct Route {
+    Directive::KVMap values;
+    std::string root;
+    std::string index;
+    bool autoindex;
+    std::string redirect;  // return
+    unsigned int denyMask;
+    std::vector<std::string> denyOthers;  // ビットを持たないメソッドのdeny
+
+    Route() : autoindex(false), denyMask(0) {}
+
+    // キーに対する値（なければ空のベクター）
+    const std::vector<std::string> &getValues(const std::string &key) const;
+    // キーに対する最初の値（なければ空文字列）
+    std::string getValue(const std::string &key) const;
+    // methodがdenyに含まれるか
+    bool denies(const std::string &method) const;
+  };
+
+  struct Location {
+    std::string path;
+    bool exact;  // "= "で始まるlocation
+    // location内で指定された値（ホストの値で補わない）
+    std::string index;
+    std::string limitExcept;
+    Route route;
+
+    Location() : exact(false) {}
+  };
+
+  struct VirtualServer {
+    std::string name;
+    std::string root;  // ホスト以下で最初に見つかるroot
+    std::vector<std::string> listen;
+    std::map<int, std::string> errorPages;
+    // 拡張子（".css"など）-> Content-Type
+    std::map<std::string, std::string> mimeTypes;
+    size_t maxBodySize;
+    Route route;
+    std::vector<Location> locations;
+    LocationTrie prefixLocations;  // パス -> locationsの添字
+    std::map<std::string, size_t> exactLocations;
+
+    VirtualServer() : maxBodySize(DEFAULT_CLIENT_MAX_BODY_SIZE) {}
+
+    // URL（クエリを除く）に一致するlocation（なければNULL）
+    const Location *findLocation(const std::string &url) const;
+    // portをlistenしているか
+    bool listens(const std::string &port) const;
+    // ステータスコードに対応するerror_page（なければNULL）
+    const std::string *findErrorPage(int statusCode) const;
+    // 拡張子に対応するContent-Type（なければNULL）
+    const std::string *findMimeType(const std::string &extension) const;
+  };
+
+  // 1つのポートでリッスンするホストの索引
+  struct Listener {
+    int port;
+    int defaultServer;    // このポートで最初に定義されたホスト
+    HostTable names;      // 完全に一致するホスト名
+    HostTable wildcards;  // "*.example.com"を".example.com"として持つ
+
+    Listener() : port(-1), defaultServer(-1) {}
+  };
+
+  RouteTable() {}
+  explicit RouteTable(const Directive &rootDirective);
+
+  // 名前と完全に一致するVirtualServer（なければNULL）
+  const VirtualServer *findServer(const std::string &name) const;
+  size_t size() const { return _servers.size(); }
+
+  // portの索引（そのポートでリッスンするホストがなければNULL）
+  const Listener *findListener(int port) const;
+
+  /**
+   * @brief portで受け付けたリクエストのHostヘッダーからVirtualServerを選ぶ
+   * @param host Hostヘッダーのホスト名（ポートを除いたもの）
+   */
+  const VirtualServer *findServer(const Listener &listener,
+                                  const std::string &host) const;
+
+  // HTTPメソッドのビット（ビットを持たないメソッドは0）
+  static unsigned int methodBit(const std::string &method);
+
+ private:
+  // キャッシュの読み書きは中身を直接扱う
+  friend class ConfigCache;
+
+  std::vector<VirtualServer> _servers;  // 設定に書かれた順
+  HostTable _serverNames;
+  std::map<int, Listener> _listeners;
+
+  void addListeners(int index);
+
+  static void compileServer(const Directive &hostDirective,
+                            VirtualServer &server);
+  static void addLocation(VirtualServer &server, const std::string &name,
+                          const Directive::KVMap &values);
+  static void compileRoute(Route &route);
+};
@@ -1,199 +1,640 @@
 #include "RunServer.hpp"
 
+#include <fcntl.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#include "BinaryUpgrade.hpp"
 #include "DeleteClientMethod.hpp"
 #include "GET.hpp"
 #include "HTTPRequestParser.hpp"
 #include "MultiPortServer.hpp"
 #include "POST.hpp"
-#include "TOMLParser.hpp"
+#include "ServerSignal.hpp"
 
-RunServer::RunServer() { setConfPath(DEFAULT_CONF_PATH); }
+// 接続をノンブロッキングかつclose-on-execのソケットとして受け付ける
+// 1つの接続の遅さがイベントループ全体を止めず，CGIの子プロセスにも引き継がれない
+static int acceptClient(int server_fd) {
+#ifdef SOCK_NONBLOCK
+  return accept4(server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  int new_socket = accept(server_fd, NULL, NULL);
+  if (new_socket == -1) {
+    return -1;
+  }
+  if (fcntl(new_socket, F_SETFL, O_NONBLOCK) == -1 ||
+      fcntl(new_socket, F_SETFD, FD_CLOEXEC) == -1) {
+    int saved_errno = errno;
+    close(new_socket);
+    errno = saved_errno;
+    return -1;
+  }
+  return new_socket;
+#endif
+}
 
-RunServer::~RunServer() {}
+RunServer::RunServer()
+    : _eventLoop(EventLoop::create("")),
+      _config(NULL),
+      _configStore(NULL),
+      _configGeneration(0),
+      _draining(false),
+      _keepaliveTimeout(DEFAULT_KEEPALIVE_TIMEOUT),
+      _keepaliveRequests(DEFAULT_KEEPALIVE_REQUESTS),
+      _clientHeaderTimeout(DEFAULT_CLIENT_HEADER_TIMEOUT),
+      _clientBodyTimeout(DEFAULT_CLIENT_BODY_TIMEOUT),
+      _sendTimeout(DEFAULT_SEND_TIMEOUT),
+      _acceptBatch(DEFAULT_ACCEPT_BATCH),
+      _headerBufferSize(DEFAULT_LARGE_CLIENT_HEADER_BUFFER_SIZE),
+      _headerBufferCount(DEFAULT_LARGE_CLIENT_HEADER_BUFFERS),
+      _timerWheel(TimerWheel::currentTimeMs()) {
+  // デフォルトのバックエンドが使えない環境ではpollにフォールバックする
+  if (_eventLoop == NULL) {
+    _eventLoop = EventLoop::create("poll");
+  }
+  setConfPath(DEFAULT_CONF_PATH);
+}
+
+RunServer::~RunServer() {
+  for (size_t fd = 0; fd < connections.size(); ++fd) {
+    if (connections[fd] != NULL) {
+      _timerWheel.disarm(connections[fd]->getTimer());
+      delete connections[fd];
+    }
+  }
+  delete _eventLoop;
+  set_config(NULL);
+}
 
 std::string RunServer::getConfPath() { return _confPath; }
-void RunServer::setConfPath(std::string confPath) { _confPath = confPath; }
+void RunServer::setConfPath(std::string confPath) {
+  _confPath = confPath;
+  // 読み込み済みの設定は別のファイルのものなので手放す
+  set_config(NULL);
+}
 
-std::vector<pollfd> &RunServer::get_poll_fds() { return poll_fds; }
+void RunServer::set_config(ConfigSnapshot *config) {
+  if (config != NULL) {
+    config->retain();
+  }
+  if (_config != NULL) {
+    _config->release();
+  }
+  _config = config;
+}
+
+ConfigSnapshot *RunServer::get_config() {
+  if (_config == NULL) {
+    _config = ConfigSnapshot::load(getConfPath());
+  }
+  return _config;
+}
+
+void RunServer::set_config_store(ConfigStore *store) {
+  _configStore = store;
+  if (_configStore == NULL) {
+    return;
+  }
+  ConfigSnapshot *config = _configStore->acquire(&_configGeneration);
+  set_config(config);
+  if (config != NULL) {
+    config->release();
+  }
+}
+
+bool RunServer::reload_config(MultiPortServer &server) {
+  if (_configStore == NULL) {
+    return false;
+  }
+  // シグナルを受け取ったワーカーが読み直し，他のワーカーは世代の変化で気づく
+  if (ServerSignal::takeReloadRequest()) {
+    _configStore->reload();
+  }
+  if (_configStore->getGeneration() == _configGeneration) {
+    return false;
+  }
+
+  ConfigSnapshot *config = _configStore->acquire(&_configGeneration);
+  if (config == NULL) {
+    return false;
+  }
+  set_config(config);
+  config->release();
+  // 古い設定は解放されうるので，リスナーの索引もすぐに付け替える
+  server.attachRoutes(_config->getRouteTable());
+  if (!_draining) {
+    sync_listeners(server, _config->getPorts());
+  }
+  std::cout << "Reloaded " << _config->getPath() << std::endl;
+  return true;
+}
+
+void RunServer::sync_listeners(MultiPortServer &server,
+                               const std::vector<int> &ports) {
+  // listenから消えたポートを閉じる（accept済みの接続はそのまま処理を続ける）
+  std::vector<int> listening = server.getPorts();
+  for (size_t i = 0; i < listening.size(); ++i) {
+    if (std::find(ports.begin(), ports.end(), listening[i]) != ports.end()) {
+      continue;
+    }
+    const std::vector<int> &server_fds = server.getServerFds();
+    for (size_t j = 0; j < server_fds.size(); ++j) {
+      if (server.getPortByFd(server_fds[j]) == listening[i]) {
+        _eventLoop->remove(server_fds[j]);
+        break;
+      }
+    }
+    server.closePort(listening[i]);
+  }
+  // listenに増えたポートを開く
+  for (size_t i = 0; i < ports.size(); ++i) {
+    if (std::find(listening.begin(), listening.end(), ports[i]) !=
+        listening.end()) {
+      continue;
+    }
+    int server_fd = server.openPort(ports[i]);
+    if (server_fd >= 0) {
+      add_watch_fd(server_fd);
+    }
+  }
+}
+
+void RunServer::begin_drain(MultiPortServer &server) {
+  if (_draining) {
+    return;
+  }
+  _draining = true;
+
+  // 新しい接続を受け付けない
+  const std::vector<int> &server_fds = server.getServerFds();
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    _eventLoop->remove(server_fds[i]);
+  }
+  server.closeSockets();
+
+  // 次のリクエストを待っているだけの接続は，待たずに閉じる
+  for (size_t fd = 0; fd < connections.size(); ++fd) {
+    Connection *connection = connections[fd];
+    if (connection != NULL &&
+        connection->getDeadline() == Connection::KEEPALIVE_DEADLINE) {
+      close_connection(static_cast<int>(fd));
+    }
+  }
+}
+
+bool RunServer::is_draining() const { return _draining; }
+
+EventLoop &RunServer::get_event_loop() { return *_eventLoop; }
+
+std::vector<EventLoop::Event> &RunServer::get_fired_events() {
+  return _firedEvents;
+}
+
+bool RunServer::set_event_backend(const std::string &backend) {
+  EventLoop *eventLoop = EventLoop::create(backend);
+  if (eventLoop == NULL) {
+    return false;
+  }
+  delete _eventLoop;
+  _eventLoop = eventLoop;
+  return true;
+}
 
 // MultiPortServer用のイベントループ実装
 void RunServer::runMultiPort(MultiPortServer &server) {
-  while (true) {
-    // pollシステムコールを呼び出し、イベントを待つ
-    poll(poll_fds.data(), poll_fds.size(), -1);
+  // 停止中は，処理中の接続がなくなった時点で抜ける
+  while (!_draining || _eventLoop->size() > 0) {
+    // イベントループ（poll/epoll）でイベントを待つ
+    // 次の期限が来たら起きるように，タイマーホイールからタイムアウトを決める
+    int timeout = _timerWheel.nextTimeout(TimerWheel::currentTimeMs());
+    if (_configStore != NULL &&
+        (timeout < 0 || timeout > CONFIG_CHECK_INTERVAL_MS)) {
+      timeout = CONFIG_CHECK_INTERVAL_MS;
+    }
+    _eventLoop->wait(_firedEvents, timeout);
     // イベント処理
     process_poll_events_multiport(server);
+    process_expired_timers();
+
+    // シグナルによる要求は，イベントを処理し終えてから反映する
+    if (ServerSignal::takeUpgradeRequest() && !_draining) {
+      // 新しいバイナリの準備ができると，SIGQUITで停止を求められる
+      BinaryUpgrade::spawn(server);
+    }
+    if (ServerSignal::isShutdownRequested()) {
+      begin_drain(server);
+    }
+    reload_config(server);
   }
 }
 
-// 新しいpollfdを追加する関数
-void RunServer::add_poll_fd(pollfd poll_fd) { poll_fds.push_back(poll_fd); }
+void RunServer::set_keepalive_timeout(int seconds) {
+  _keepaliveTimeout = seconds;
+}
 
-// 新しい接続を処理する関数
-void RunServer::handle_new_connection(int server_fd, int server_port) {
-  int new_socket = accept(server_fd, NULL, NULL);
-  if (new_socket == -1) {
-    perror("accept");
-    return;
+void RunServer::set_keepalive_requests(int requests) {
+  _keepaliveRequests = requests;
+}
+
+void RunServer::set_client_header_timeout(int seconds) {
+  _clientHeaderTimeout = seconds;
+}
+
+void RunServer::set_client_body_timeout(int seconds) {
+  _clientBodyTimeout = seconds;
+}
+
+void RunServer::set_send_timeout(int seconds) { _sendTimeout = seconds; }
+
+void RunServer::set_accept_batch(int batch) { _acceptBatch = batch; }
+
+void RunServer::set_large_client_header_buffers(int count, int size) {
+  _headerBufferCount = count;
+  _headerBufferSize = size;
+}
+
+void RunServer::arm_deadline(Connection &connection,
+                             Connection::Deadline deadline) {
+  int seconds = _clientHeaderTimeout;
+  if (deadline == Connection::BODY_DEADLINE) {
+    seconds = _clientBodyTimeout;
+  } else if (deadline == Connection::KEEPALIVE_DEADLINE) {
+    seconds = _keepaliveTimeout;
+  } else if (deadline == Connection::SEND_DEADLINE) {
+    seconds = _sendTimeout;
   }
+  connection.setDeadline(deadline);
+  _timerWheel.arm(connection.getTimer(), seconds * 1000UL,
+                  TimerWheel::currentTimeMs());
+}
 
-  // クライアントFDとサーバーポートの対応を保存
-  client_to_port[new_socket] = server_port;
-  pollfd client_fd_poll;
-  client_fd_poll.fd = new_socket;
-  client_fd_poll.events = POLLIN;
-  get_poll_fds().push_back(client_fd_poll);
+void RunServer::process_expired_timers() {
+  _timerWheel.advance(TimerWheel::currentTimeMs(), _expiredTimers);
+  for (size_t i = 0; i < _expiredTimers.size(); ++i) {
+    int client_socket = _expiredTimers[i]->fd;
+    Connection *connection = find_connection(client_socket);
+    if (connection == NULL) {
+      continue;
+    }
+    Connection::Deadline deadline = connection->getDeadline();
+    if ((deadline == Connection::HEADER_DEADLINE ||
+         deadline == Connection::BODY_DEADLINE) &&
+        connection->getParser().hasReceivedData()) {
+      // 受信途中のリクエストには408を返してから閉じる
+      queue_error_response(*connection, 408);  // Request Timeout
+    } else {
+      close_connection(client_socket);
+    }
+  }
+  _expiredTimers.clear();
+}
+
+void RunServer::write_error_response(Connection &connection, int statusCode) {
+  ConfigSnapshot *config = connection.getConfig();
+  if (config == NULL) config = get_config();
+
+  HTTPResponse httpResponse;
+  httpResponse.setHttpStatusCode(statusCode);
+  // リクエストが揃っていないので，中身のないHTTP/1.1のリクエストとして応答する
+  // （keep-aliveではないのでConnection: closeになる）
+  HTTPRequest httpRequest("", "", "HTTP/1.1",
+                          std::map<std::string, std::string>(), "");
+  RouteTable emptyRoutes;
+  RequestContext context(config != NULL ? config->getRouteTable() : emptyRoutes,
+                         httpRequest);
+  PrintResponse printResponse(connection.getWriteBuffer());
+  GenerateHTTPResponse generateHTTPResponse(context);
+  generateHTTPResponse.setNextHandler(&printResponse);
+  generateHTTPResponse.handleRequest(httpResponse);
+
+  connection.setKeepAlive(false);
+}
+
+void RunServer::queue_error_response(Connection &connection, int statusCode) {
+  write_error_response(connection, statusCode);
+  connection.setPhase(Connection::WRITING);
+  _eventLoop->modify(connection.getFd(), EventLoop::WRITE);
+  arm_deadline(connection, Connection::SEND_DEADLINE);
+}
+
+// 読み込みを監視するFD（サーバーソケットなど）を追加する関数
+void RunServer::add_watch_fd(int fd) { _eventLoop->add(fd, EventLoop::READ); }
+
+// 新しい接続を処理する関数
+void RunServer::handle_new_connection(int server_fd, int server_port,
+                                      const RouteTable::Listener *listener) {
+  // 1回の通知で，accept待ちの接続をEAGAINまで（最大_acceptBatch本）まとめて受け付ける
+  // （リッスンソケットはノンブロッキングであること）
+  for (int i = 0; i < _acceptBatch; ++i) {
+    int new_socket = acceptClient(server_fd);
+    if (new_socket == -1) {
+      // 待ちがなくなった，または他のワーカーが先に受け付けた場合
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+      // 受け付ける前に相手が切断した場合は次の接続へ
+      if (errno == ECONNABORTED || errno == EINTR) continue;
+      perror("accept");
+      return;
+    }
+
+    // クライアントFDに接続状態（サーバーポートを含む）を対応づけて保存
+    if (!_eventLoop->add(new_socket, EventLoop::READ)) {
+      perror("event loop");
+      close(new_socket);
+      continue;
+    }
+    get_connection(new_socket, server_port)->setListener(listener);
+  }
 }
 
 Handler *getHTTPMethodHandler(const std::string &HTTPMethod,
-                              Directive rootDirective,
-                              HTTPRequest httpRequest) {
+                              RequestContext &context) {
   // switch分岐でHTTPメソッドに対応するハンドラを返す
   if (HTTPMethod == "GET") {
-    return new GET(rootDirective, httpRequest);
+    return new GET(context);
   } else if (HTTPMethod == "POST") {
-    return new POST(rootDirective, httpRequest);
+    return new POST(context);
   } else if (HTTPMethod == "DELETE") {
-    return new DeleteClientMethod(httpRequest, rootDirective);
+    return new DeleteClientMethod(context);
   } else {
     // 未対応のHTTPメソッドの場合はGETハンドラを返す
     // GETハンドラは405 Method Not Allowedを返す
-    return new GET(rootDirective, httpRequest);
+    return new GET(context);
   }
 }
 
-// std::vector<std::string>の要素に"指定のメソッド"が含まれているか
-static bool isContain(std::vector<std::string> vec, std::string str) {
-  for (std::vector<std::string>::iterator itr = vec.begin(); itr != vec.end();
-       ++itr) {
-    if (*itr == str) {
-      return true;
-    }
+// クライアントFDに対応する接続状態を取得する（なければNULL）
+Connection *RunServer::find_connection(int client_socket) const {
+  if (client_socket < 0 ||
+      static_cast<size_t>(client_socket) >= connections.size()) {
+    return NULL;
+  }
+  return connections[client_socket];
+}
+
+// クライアントFDに対応する接続状態を取得する（なければ作成する）
+Connection *RunServer::get_connection(int client_socket, int server_port) {
+  Connection *connection = find_connection(client_socket);
+  if (connection != NULL) {
+    return connection;
   }
-  return false;
+  // FDはカーネルが小さい番号から割り当てるので，FDをそのまま添字にした表は密になる
+  if (static_cast<size_t>(client_socket) >= connections.size()) {
+    connections.resize(client_socket + 1, NULL);
+  }
+  connection = new Connection(client_socket, server_port);
+  connections[client_socket] = connection;
+  // ヘッダーの上限を超えたリクエストは，バッファに溜めずに断る
+  connection->getParser().setHeaderBufferLimits(_headerBufferSize,
+                                                _headerBufferCount);
+  // 処理中に設定が読み直されても，この接続は受け付けた時点の設定で処理する
+  connection->setConfig(get_config());
+  // 最初のリクエストヘッダーが届くまでの期限
+  arm_deadline(*connection, Connection::HEADER_DEADLINE);
+  return connection;
+}
+
+// 接続を閉じてイベントループと接続状態から取り除く
+void RunServer::close_connection(int client_socket) {
+  Connection *connection = find_connection(client_socket);
+  if (connection != NULL) {
+    _timerWheel.disarm(connection->getTimer());
+    delete connection;
+    connections[client_socket] = NULL;
+  }
+  // epollはclose前に外す必要があるため，先にイベントループから取り除く
+  _eventLoop->remove(client_socket);
+  close(client_socket);
 }
 
 // クライアントからのデータを処理する関数
-void RunServer::handle_client_data(size_t client_fd, std::string receivedPort) {
-  const size_t BUFFER = 4096;
-  std::string complete_request;
-  char buffer[BUFFER] = {0};
-  ssize_t bytes_read;
-  int client_socket = get_poll_fds()[client_fd].fd;
-  bool received_full_request = false;
-
-  // データを受信し、完全なリクエストを構築
-  while (!received_full_request) {
-    bytes_read = recv(client_socket, buffer, BUFFER - 1, 0);
-
-    if (bytes_read <= 0) {
-      if (bytes_read == -1) {
-        perror("recv");
-      }
-      close(client_socket);
-      get_poll_fds().erase(get_poll_fds().begin() + client_fd);
-      client_to_port.erase(client_socket);
-      return;
+void RunServer::handle_client_data(int client_socket,
+                                   std::string receivedPort) {
+  // 接続表に載せられない不正なFDは，受信エラーとして扱う
+  if (client_socket < 0) {
+    errno = EBADF;
+    perror("recv");
+    return;
+  }
+  handle_client_read(
+      *get_connection(client_socket, std::atoi(receivedPort.c_str())));
+}
+
+// 1回のPOLLINにつき1回だけ受信し，リクエストが揃うまではpollループに戻る
+void RunServer::handle_client_read(Connection &connection) {
+  if (!connection.readFromSocket()) {
+    close_connection(connection.getFd());
+    return;
+  }
+  if (!check_request_headers(connection)) {
+    return;
+  }
+
+  // リクエストがまだ揃っていなければ，続きを待つ
+  if (!connection.isRequestComplete()) {
+    if (connection.getParser().isHeaderComplete()) {
+      // ボディは受信するたびに期限を延ばす
+      arm_deadline(connection, Connection::BODY_DEADLINE);
+    } else if (connection.getDeadline() == Connection::KEEPALIVE_DEADLINE) {
+      // 次のリクエストが届き始めたら，ヘッダーの期限に切り替える
+      arm_deadline(connection, Connection::HEADER_DEADLINE);
     }
+    return;
+  }
 
-    buffer[bytes_read] = '\0';
-    // 受信したデータを完全なリクエストに追加
-    complete_request.append(buffer, bytes_read);
-
-    // Content-Lengthがある場合、完全なリクエストを受信したか確認
-    // ヘッダーとボディの区切り（空行）を見つけ、Content-Lengthに基づいてボディの長さを確認
-    size_t header_end = complete_request.find("\r\n\r\n");
-    // header_end != std::string::npos なら、ヘッダー部分の受信は完了している。
-    if (header_end != std::string::npos) {
-      std::string header_part = complete_request.substr(0, header_end);
-      std::string lower_header;
-      lower_header.reserve(header_part.length());
-      for (size_t i = 0; i < header_part.length(); ++i) {
-        lower_header += std::tolower(header_part[i]);
-      }
+  dispatch_requests(connection);
+}
 
-      // Content-Lengthを探す
-      size_t content_length_pos = lower_header.find("content-length:");
-      if (content_length_pos != std::string::npos) {
-        // Content-Lengthの値を取得
-        size_t value_start = lower_header.find_first_not_of(
-            " \t", content_length_pos + 15);  // 15は"content-length:"の長さ
-        if (value_start != std::string::npos) {
-          size_t value_end = lower_header.find_first_of("\r\n", value_start);
-          if (value_end != std::string::npos) {
-            std::string length_str =
-                lower_header.substr(value_start, value_end - value_start);
-            std::istringstream iss(length_str);
-            size_t content_length = 0;
-            iss >> content_length;
-
-            // ボディ部分の現在の長さを計算
-            size_t body_length = complete_request.length() -
-                                 (header_end + 4);  // 4は\r\n\r\nの長さ
-
-            // ボディが完全に受信されたか確認
-            if (body_length >= content_length) {
-              received_full_request = true;
-            }
-          }
-        }
-      } else {
-        // Content-Lengthがない場合は、ヘッダーを受信した時点で完了と見なす
-        received_full_request = true;
-      }
+bool RunServer::check_request_headers(Connection &connection) {
+  HTTPRequestParser &parser = connection.getParser();
+  if (connection.isHeaderChecked() || !parser.isHeaderComplete() ||
+      parser.hasError()) {
+    return true;
+  }
+  connection.setHeaderChecked(true);
+
+  // ボディの上限はHostヘッダーで選ばれるホストのclient_max_body_size
+  ConfigSnapshot *config = connection.getConfig();
+  if (config == NULL) config = get_config();
+  const RouteTable::VirtualServer *server = NULL;
+  if (config != NULL) {
+    const RouteTable &routes = config->getRouteTable();
+    const RouteTable::Listener *listener = connection.getListener();
+    if (listener == NULL) {
+      listener = routes.findListener(connection.getPort());
+    }
+    if (listener != NULL) {
+      std::string host = parser.getHeader(HTTPHeaders::HOST);
+      server = routes.findServer(*listener, host.substr(0, host.find(':')));
     }
   }
+  parser.setMaxBodySize(server != NULL ? server->maxBodySize
+                                       : DEFAULT_CLIENT_MAX_BODY_SIZE);
 
-  Directive *rootDirective = NULL;
-  try {
-    // HTTPリクエストをパース
-    HTTPRequestParser parser;
-    if (parser.feed(complete_request.c_str(), complete_request.size())) {
-      if (parser.hasError()) {
-        throw std::invalid_argument("Failed to parse HTTP request");
-      }
-    } else {
-      throw std::invalid_argument(
-          "Failed to parse HTTP request: more data needed");
+  // 上限を超えていれば，ボディを待たずに413を返す（100 Continueは送らない）
+  if (parser.hasError() || parser.isComplete() ||
+      parser.getVersion() != "HTTP/1.1" ||
+      strcasecmp(parser.getHeader(HTTPHeaders::EXPECT).c_str(),
+                 "100-continue") != 0) {
+    return true;
+  }
+  // クライアントはこの応答を待ってからボディを送る
+  connection.queueResponse("HTTP/1.1 100 Continue\r\n\r\n");
+  if (!connection.writeToSocket()) {
+    close_connection(connection.getFd());
+    return false;
+  }
+  // 一度に送りきれなかった分はPOLLOUTを待って送り，送り終えたら受信に戻る
+  if (connection.hasPendingWrite()) {
+    connection.setPhase(Connection::WRITING);
+    _eventLoop->modify(connection.getFd(), EventLoop::WRITE);
+    arm_deadline(connection, Connection::SEND_DEADLINE);
+  }
+  return true;
+}
+
+// 揃ったリクエストを処理し，レスポンスを送信キューに積んでPOLLOUTを待つ関数
+// パイプライン化されたリクエストは，既に届いている分を受信順にまとめて処理する
+// （レスポンスも同じ送信キューに順番に積まれるので，リクエストの順に返る）
+void RunServer::dispatch_requests(Connection &connection) {
+  do {
+    if (!check_request_headers(connection)) {
+      return;
+    }
+    process_request(connection);
+    if (!connection.isKeepAlive()) {
+      break;
     }
+    // 後続のリクエストがあれば，続けてパースする
+    connection.resetForNextRequest();
+    // ヘッダーだけ届いていれば，ボディを待つ前に検査する（100 Continue）
+    if (!check_request_headers(connection)) {
+      return;
+    }
+  } while (connection.isRequestComplete());
+
+  // キューに積んだレスポンスはPOLLOUTを待ってから送信する
+  // （100 Continueと一緒に送りきっていれば，送り終えたときと同じく続ける）
+  if (connection.hasPendingWrite()) {
+    connection.setPhase(Connection::WRITING);
+    _eventLoop->modify(connection.getFd(), EventLoop::WRITE);
+    arm_deadline(connection, Connection::SEND_DEADLINE);
+  } else {
+    finish_write(connection);
+  }
+}
+
+// 送信キューに溜まったレスポンスをクライアントへ送る関数
+void RunServer::handle_client_write(int client_socket) {
+  Connection *connection = find_connection(client_socket);
+  if (connection == NULL) {
+    close_connection(client_socket);
+    return;
+  }
+
+  if (!connection->writeToSocket()) {
+    close_connection(client_socket);
+    return;
+  }
+
+  if (connection->hasPendingWrite()) {
+    // 送信できている間は期限を延ばす
+    arm_deadline(*connection, Connection::SEND_DEADLINE);
+    return;
+  }
+  finish_write(*connection);
+}
+
+void RunServer::finish_write(Connection &connection) {
+  int client_socket = connection.getFd();
+  // 100 Continueを送り終えただけなら，受信中のリクエストのボディを待つ
+  if (!connection.isRequestComplete() && connection.isHeaderChecked()) {
+    connection.setPhase(Connection::READING);
+    _eventLoop->modify(client_socket, EventLoop::READ);
+    arm_deadline(connection, Connection::BODY_DEADLINE);
+    return;
+  }
+  // keep-aliveなら次のリクエストを待ち，そうでなければ送り終えた時点で閉じる
+  // （停止中は次のリクエストを待たない）
+  if (connection.isKeepAlive() && !_draining) {
+    connection.setPhase(Connection::READING);
+    _eventLoop->modify(client_socket, EventLoop::READ);
+    arm_deadline(connection,
+                 connection.getParser().hasReceivedData()
+                     ? Connection::HEADER_DEADLINE
+                     : Connection::KEEPALIVE_DEADLINE);
+  } else {
+    close_connection(client_socket);
+  }
+}
+
+// 受信し終えたリクエストを処理し，レスポンスを接続の送信キューに積む関数
+void RunServer::process_request(Connection &connection) {
+  HTTPRequestParser &parser = connection.getParser();
+
+  // 応答できなかった場合は接続を閉じる
+  connection.setKeepAlive(false);
+
+  // リクエストの終わりが分からない，またはボディを受け取らないので，
+  // エラーを返して接続を閉じる（後続のバイト列は次のリクエストとして扱えない）
+  if (parser.hasError()) {
+    std::cerr << "Bad request: " << parser.getErrorMessage() << std::endl;
+    // Bad RequestまたはContent Too Large
+    write_error_response(connection, parser.getErrorStatusCode());
+    return;
+  }
+
+  try {
     HTTPRequest httpRequest = parser.createRequest();
-    // ConfigからDirectiveを取得
-    TOMLParser toml_parser;
-    rootDirective = toml_parser.parseFromFile(getConfPath());
-    if (rootDirective == NULL)
-      throw std::invalid_argument("Failed to parse Conf");
+    // keepalive_requestsに達した場合・停止中の場合は，この応答で接続を閉じる
+    bool keepAlive = httpRequest.isKeepAlive() && !_draining &&
+                     _keepaliveTimeout > 0 &&
+                     static_cast<int>(connection.getRequestCount()) + 1 <
+                         _keepaliveRequests;
+    httpRequest.setKeepAlive(keepAlive);
+    connection.setKeepAlive(keepAlive);
+    // 読み込み時に変換したルーティング表を使う（リクエストごとに設定を辿らない）
+    ConfigSnapshot *config = connection.getConfig();
+    if (config == NULL) config = get_config();
+    if (config == NULL) throw std::invalid_argument("Failed to parse Conf");
+    // ホストは受け付けたリスナーの索引から選ぶ（テストなどで付いていなければポートで引く）
+    const RouteTable::Listener *listener = connection.getListener();
+    if (listener == NULL) {
+      listener = config->getRouteTable().findListener(connection.getPort());
+    }
+    // 鎖のハンドラはこの文脈を参照で共有する（設定やリクエストをコピーしない）
+    RequestContext context(config->getRouteTable(), listener, httpRequest);
 
     // HTTPレスポンスオブジェクトを作成
     HTTPResponse httpResponse;
 
     // URLリダイレクトが指定されている場合，httpRequestのURLをリダイレクト先に変更する
     // URLリダイレクトとはすなわち，HTTPリクエストのURLを変更することであるため．
-    GenerateHTTPResponse search(*rootDirective, httpRequest);
-    if (search.getDirectiveValue("return") != "") {
-      httpRequest.setURL(search.getDirectiveValue("return"));
+    // （denyは書き換える前のURLの設定で判定する）
+    const RouteTable::Route *route = context.getRoute();
+    if (route != NULL && !route->redirect.empty()) {
+      context.setURL(route->redirect);
     }
 
-    // 鎖をつなげる
-    PrintResponse printResponse(get_poll_fds()[client_fd].fd);
-    GenerateHTTPResponse generateHTTPResponse(*rootDirective, httpRequest);
+    // 鎖をつなげる（レスポンスは送信キューに書き出す）
+    PrintResponse printResponse(connection.getWriteBuffer());
+    GenerateHTTPResponse generateHTTPResponse(context);
     generateHTTPResponse.setNextHandler(&printResponse);
 
-    const Directive *hostDirective =
-        rootDirective->findDirective(httpRequest.getServerName());
-    if (hostDirective == NULL ||
-        !isContain(hostDirective->getValues("listen"), receivedPort)) {
-      // 指定ホストは指定のポートをリッスンしない場合
+    const RouteTable::VirtualServer *server = context.getServer();
+    if (server == NULL) {
+      // 受け付けたポートをリッスンするホストがない場合
       httpResponse.setHttpStatusCode(400);  // Bad Request
       generateHTTPResponse.handleRequest(httpResponse);
-    } else if (isContain(search.getDirectiveValues("deny"),
-                         httpRequest.getMethod())) {
+    } else if (route != NULL && route->denies(httpRequest.getMethod())) {
       // 実行メソッドが許可されていない場合
       httpResponse.setHttpStatusCode(405);  // Method Not Allowed
       generateHTTPResponse.handleRequest(httpResponse);
     } else {
       // 通常
-      Handler *handler = getHTTPMethodHandler(httpRequest.getMethod(),
-                                              *rootDirective, httpRequest);
+      Handler *handler = getHTTPMethodHandler(httpRequest.getMethod(), context);
       handler->setNextHandler(&generateHTTPResponse);
       handler->handleRequest(httpResponse);
       delete handler;
@@ -201,36 +642,36 @@ void RunServer::handle_client_data(size_t client_fd, std::string receivedPort) {
   } catch (const std::exception &e) {
     std::cerr << "Error handling client data: " << e.what() << std::endl;
   }
-  delete rootDirective;
-  // Connection: closeの場合は接続を閉じる
-  close(get_poll_fds()[client_fd].fd);
-  get_poll_fds().erase(get_poll_fds().begin() + client_fd);
-  client_to_port.erase(get_poll_fds()[client_fd].fd);
-}
-
-static std::string int2str(int nb) {
-  std::stringstream ss;
-  ss << nb;
-  return ss.str();
 }
 
 // MultiPortServer用のイベント処理
 void RunServer::process_poll_events_multiport(MultiPortServer &server) {
-  // すべてのファイルディスクリプタをチェック
-  for (size_t i = 0; i < get_poll_fds().size(); ++i) {
-    // イベントが発生したかチェック
-    if (get_poll_fds()[i].revents & POLLIN) {
-      int current_fd = get_poll_fds()[i].fd;
-
-      // サーバーソケットのイベントかチェック
-      if (server.isServerFd(current_fd)) {
-        int port = server.getPortByFd(current_fd);
-        handle_new_connection(current_fd, port);
-      } else {
-        // クライアント接続からのデータ
-        int server_port = client_to_port[current_fd];
-        handle_client_data(i, int2str(server_port));
+  // イベントが発生したFDだけを処理する
+  for (size_t i = 0; i < _firedEvents.size(); ++i) {
+    int current_fd = _firedEvents[i].fd;
+    int events = _firedEvents[i].events;
+
+    // サーバーソケットのイベントかチェック
+    if (server.isServerFd(current_fd)) {
+      if (events & EventLoop::READ) {
+        // 設定を読み込み直していれば，リスナーの索引を付け直す
+        ConfigSnapshot *config = get_config();
+        if (config != NULL && server.getRoutes() != &config->getRouteTable()) {
+          server.attachRoutes(config->getRouteTable());
+        }
+        handle_new_connection(current_fd, server.getPortByFd(current_fd),
+                              server.getListenerByFd(current_fd));
       }
+    } else if (events & EventLoop::READ) {
+      // クライアント接続からのデータ（接続状態はFDを添字にして直接引く）
+      handle_client_read(*get_connection(current_fd, -1));
+    } else if (events & EventLoop::WRITE) {
+      // クライアントへ送信可能になった
+      handle_client_write(current_fd);
+    } else if (events & EventLoop::ERROR) {
+      // 相手が切断した，またはFDが不正
+      close_connection(current_fd);
     }
   }
+  _firedEvents.clear();
 }
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <poll.h>
 #include <unistd.h>
 
 #include <cstddef>
@@ -8,35 +7,171 @@
 #include <string>
 #include <vector>
 
+#include "ConfigSnapshot.hpp"
+#include "ConfigStore.hpp"
+#include "Connection.hpp"
+#include "EventLoop.hpp"
 #include "HTTPResponse.hpp"
 #include "PrintResponse.hpp"
 #include "ServerData.hpp"
+#include "TimerWheel.hpp"
+
+// keep-aliveの接続をアイドルのまま維持する秒数（0ならkeep-aliveしない）
+#define DEFAULT_KEEPALIVE_TIMEOUT 75
+// 1本の接続で処理するリクエストの上限
+#define DEFAULT_KEEPALIVE_REQUESTS 100
+// リクエストヘッダーの受信・ボディの受信間隔・送信間隔のタイムアウト（秒）
+#define DEFAULT_CLIENT_HEADER_TIMEOUT 60
+#define DEFAULT_CLIENT_BODY_TIMEOUT 60
+#define DEFAULT_SEND_TIMEOUT 60
+// リッスンソケットの1回の通知でacceptする接続の上限
+#define DEFAULT_ACCEPT_BATCH 64
+// 共有の設定が差し替えられていないかを確かめる間隔（ミリ秒）
+// シグナルを受け取らなかったワーカーも，この間隔で新しい設定に切り替わる
+#define CONFIG_CHECK_INTERVAL_MS 1000
 
 // 前方宣言（循環参照を防ぐため）
 class MultiPortServer;
 
 class RunServer {
  private:
-  std::vector<pollfd> poll_fds;
+  // FDの監視（poll/epoll）を行うイベントループ
+  EventLoop *_eventLoop;
+  // 直近のwaitで発生したイベント
+  std::vector<EventLoop::Event> _firedEvents;
   std::string _confPath;
-  std::map<int, int> client_to_port;
+  // パース済みの設定（未設定ならget_configで_confPathから読み込む）
+  ConfigSnapshot *_config;
+  // 再読み込みで差し替えられる共有の設定（NULLなら再読み込みしない）
+  ConfigStore *_configStore;
+  // _configとして取得した設定の世代
+  unsigned long _configGeneration;
+  // 新しい接続の受け付けをやめ，処理中の接続が終わるのを待っている
+  bool _draining;
+  // FDを添字にした接続状態の表（接続のない添字はNULL）
+  // 接続ごとのリッスンポートもConnectionが直接持つ
+  std::vector<Connection *> connections;
+  int _keepaliveTimeout;
+  int _keepaliveRequests;
+  int _clientHeaderTimeout;
+  int _clientBodyTimeout;
+  int _sendTimeout;
+  // 1回の通知で受け付ける接続の上限
+  int _acceptBatch;
+  // リクエストライン・ヘッダー1行の上限と，ヘッダー全体に使える数
+  int _headerBufferSize;
+  int _headerBufferCount;
+  // 接続ごとの期限（ヘッダー・ボディ・keep-alive・送信）
+  TimerWheel _timerWheel;
+  // 直近に期限が切れたタイマー
+  std::vector<TimerWheel::Timer *> _expiredTimers;
+
+  Connection *find_connection(int client_socket) const;
+  Connection *get_connection(int client_socket, int server_port);
+  void close_connection(int client_socket);
+  void process_request(Connection &connection);
+  void dispatch_requests(Connection &connection);
+  void handle_client_read(Connection &connection);
+  // ヘッダーが揃った時点で，ボディを受け取る前にボディの上限を設定し，
+  // Expect: 100-continueに応える（リクエストごとに1回だけ）
+  // 応答を送れずに接続を閉じた場合はfalse（connectionはもう使えない）
+  bool check_request_headers(Connection &connection);
+  // 送信キューを送り終えた後，ボディか次のリクエストを待つか，接続を閉じる
+  void finish_write(Connection &connection);
+  // 接続の期限を設定し直す（deadlineの種類に応じたタイムアウトを使う）
+  void arm_deadline(Connection &connection, Connection::Deadline deadline);
+  // エラーのレスポンスを送信キューに書き出す（送り終えたら閉じる）
+  void write_error_response(Connection &connection, int statusCode);
+  // エラーのレスポンスを送信キューに積み，送信を待つ
+  void queue_error_response(Connection &connection, int statusCode);
+  // リッスンするポートをportsに合わせる（増えたポートを開き，消えたポートを閉じる）
+  void sync_listeners(MultiPortServer &server, const std::vector<int> &ports);
 
  public:
   RunServer();
   ~RunServer();
-  std::vector<pollfd> &get_poll_fds();
+  EventLoop &get_event_loop();
+  std::vector<EventLoop::Event> &get_fired_events();
+
+  /**
+   * @brief イベントループのバックエンドを切り替える（FDを追加する前に呼ぶこと）
+   * @param backend "poll"または"epoll"．空文字列ならデフォルト
+   * @return 未対応のバックエンドの場合はfalse（元のバックエンドのまま）
+   */
+  bool set_event_backend(const std::string &backend);
 
   void run(ServerData &server_data);
 
   // MultiPortServer対応の関数
+  // 停止の要求（SIGQUIT）を受けた場合は，処理中の接続がなくなった時点で戻る
   void runMultiPort(MultiPortServer &server);
 
-  void add_poll_fd(pollfd poll_fd);
-  void handle_new_connection(int server_fd, int server_port);
-  void handle_client_data(size_t i, std::string port);
+  void add_watch_fd(int fd);
+  /**
+   * @brief accept待ちの接続をまとめて受け付ける（accept_batch本まで）
+   * @param server_fd ノンブロッキングのリッスンソケット
+   * @param listener 受け付けた接続のホストを選ぶ索引（NULLならポートで引く）
+   */
+  void handle_new_connection(int server_fd, int server_port,
+                             const RouteTable::Listener *listener = NULL);
+  void handle_client_data(int client_socket, std::string port);
+  void handle_client_write(int client_socket);
   std::string getConfPath();
   void setConfPath(std::string confPath);
+  /**
+   * @brief リクエストの処理に使う設定を差し替える
+   *
+   * 新しい設定を参照し（retain），それまでの設定を手放す（release）
+   */
+  void set_config(ConfigSnapshot *config);
+  // 現在の設定（未設定なら_confPathを読み込む．失敗した場合はNULL）
+  ConfigSnapshot *get_config();
+  /**
+   * @brief 再読み込みで差し替えられる共有の設定を使う
+   *
+   * 現在の設定をstoreから取得し，以降はstoreの世代が変わるたびに取り直す
+   */
+  void set_config_store(ConfigStore *store);
+
+  /**
+   * @brief 再読み込みの要求（SIGHUP）を処理し，新しい設定に切り替える
+   *
+   * 設定が差し替えられていれば，リッスンするポートも新しいlistenに合わせる．
+   * 新しい設定を使うのはこれから受け付ける接続で，処理中の接続は
+   * 受け付けた時点の設定のまま終わる
+   * @return 新しい設定に切り替えた場合はtrue
+   */
+  bool reload_config(MultiPortServer &server);
+
+  /**
+   * @brief グレースフルな停止を始める
+   *
+   * リッスンソケットを閉じ，keep-aliveで待機中の接続を閉じる．
+   * 処理中の接続はレスポンスを送り終えた時点で閉じる
+   */
+  void begin_drain(MultiPortServer &server);
+  bool is_draining() const;
+  void set_keepalive_timeout(int seconds);
+  void set_keepalive_requests(int requests);
+  void set_client_header_timeout(int seconds);
+  void set_client_body_timeout(int seconds);
+  void set_send_timeout(int seconds);
+  void set_accept_batch(int batch);
+  /**
+   * @brief large_client_header_buffersを設定する（以後に受け付ける接続で使う）
+   *
+   * リクエストラインがsizeを超えれば414，ヘッダー1行がsizeを超えるか
+   * ヘッダー全体がsize×countを超えれば431を返して接続を閉じる
+   */
+  void set_large_client_header_buffers(int count, int size);
 
   // MultiPortServer対応のイベント処理
   void process_poll_events_multiport(MultiPortServer &server);
+
+  /**
+   * @brief 期限が切れた接続を処理する
+   *
+   * 受信途中のリクエストには408を返し，keep-aliveで待機中・送信中の接続は閉じる
+   */
+  void process_expired_timers();
 };
@@ -1,10 +1,27 @@
 #include "ServerData.hpp"
 
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// システムコールの失敗を例外にする（OSInitが受け取り，そのポートを諦める）
+static void throwSystemError(const std::string &what) {
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
 ServerData::ServerData()
-    : server_fd(-1), new_socket(0), addrlen(sizeof(address)), port(PORT) {}
+    : server_fd(-1),
+      new_socket(0),
+      addrlen(sizeof(address)),
+      port(PORT),
+      reuse_port(false) {}
 
 ServerData::ServerData(int port)
-    : server_fd(-1), new_socket(0), addrlen(sizeof(address)), port(port) {}
+    : server_fd(-1),
+      new_socket(0),
+      addrlen(sizeof(address)),
+      port(port),
+      reuse_port(false) {}
 
 ServerData::~ServerData() {}
 
@@ -22,31 +39,40 @@ int ServerData::get_port() const { return port; }
 
 void ServerData::set_port(int port) { this->port = port; }
 
+void ServerData::set_reuse_port(bool reuse_port) {
+  this->reuse_port = reuse_port;
+}
+
+bool ServerData::get_reuse_port() const { return reuse_port; }
+
 void ServerData::set_server_fd() {
   // ソケットの作成
-  if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-    perror("socket failed");
-    std::exit(EXIT_FAILURE);
+  if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    throwSystemError("socket failed");
   }
   // ソケットの再利用を許可する設定を追加
   int opt = 1;
   if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-    perror("setsockopt failed");
-    std::exit(EXIT_FAILURE);
+    throwSystemError("setsockopt failed");
+  }
+#ifdef SO_REUSEPORT
+  // 複数のイベントループが同じポートでリッスンし，カーネルに接続を振り分けさせる
+  if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt,
+                               sizeof(opt)) < 0) {
+    throwSystemError("setsockopt SO_REUSEPORT failed");
   }
+#endif
 }
 
 void ServerData::server_bind() {
   if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-    perror("bind failed");
-    std::exit(EXIT_FAILURE);
+    throwSystemError("bind failed");
   }
 }
 
 void ServerData::server_listen() {
   if (listen(server_fd, MAX_CONNECTION) < 0) {
-    perror("listen");
-    std::exit(EXIT_FAILURE);
+    throwSystemError("listen");
   }
 }
 
@@ -39,6 +39,7 @@ class ServerData : public IServerFunctions {
   struct sockaddr_in address;
   int addrlen;
   int port;  // ポート番号を保持する変数を追加
+  bool reuse_port;  // SO_REUSEPORTで同じポートを複数ソケットで共有するか
 
  public:
   ServerData();
@@ -56,4 +57,7 @@ class ServerData : public IServerFunctions {
   void set_new_socket(int new_socket);
   int get_port() const;     // ポート番号を取得するメソッド
   void set_port(int port);  // ポート番号を設定するメソッド
+  // set_server_fd()より前に呼ぶこと
+  void set_reuse_port(bool reuse_port);
+  bool get_reuse_port() const;
 };
@@ -0,0 +1,109 @@
+#include "ServerSignal.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+volatile sig_atomic_t ServerSignal::_reloadRequested = 0;
+volatile sig_atomic_t ServerSignal::_shutdownRequested = 0;
+volatile sig_atomic_t ServerSignal::_upgradeRequested = 0;
+volatile sig_atomic_t ServerSignal::_terminateRequested = 0;
+
+void ServerSignal::install(int signum, void (*handler)(int)) {
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  // 待機中のシステムコールを中断させ，すぐにイベントループへ戻す
+  action.sa_flags = 0;
+  if (sigaction(signum, &action, NULL) == -1) {
+    perror("sigaction");
+  }
+}
+
+void ServerSignal::handleReload() { install(SIGHUP, onReload); }
+
+void ServerSignal::handleShutdown() { install(SIGQUIT, onShutdown); }
+
+void ServerSignal::handleUpgrade() { install(SIGUSR2, onUpgrade); }
+
+void ServerSignal::handleTerminate() {
+  install(SIGTERM, onTerminate);
+  install(SIGINT, onTerminate);
+}
+
+void ServerSignal::resetTerminate() {
+  install(SIGTERM, SIG_DFL);
+  install(SIGINT, SIG_DFL);
+}
+
+void ServerSignal::ignoreReload() { install(SIGHUP, SIG_IGN); }
+
+void ServerSignal::ignoreUpgrade() { install(SIGUSR2, SIG_IGN); }
+
+void ServerSignal::handleChildExit() { install(SIGCHLD, onChildExit); }
+
+void ServerSignal::resetChildExit() { install(SIGCHLD, SIG_DFL); }
+
+void ServerSignal::masterSignals(sigset_t &set) {
+  sigemptyset(&set);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGQUIT);
+  sigaddset(&set, SIGUSR2);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGCHLD);
+}
+
+void ServerSignal::onReload(int signum) {
+  (void)signum;
+  _reloadRequested = 1;
+}
+
+void ServerSignal::onShutdown(int signum) {
+  (void)signum;
+  _shutdownRequested = 1;
+}
+
+void ServerSignal::onUpgrade(int signum) {
+  (void)signum;
+  _upgradeRequested = 1;
+}
+
+void ServerSignal::onTerminate(int signum) {
+  (void)signum;
+  _terminateRequested = 1;
+}
+
+// 待機中のsigsuspendを戻すだけ（終了したワーカーはwaitpidで調べる）
+void ServerSignal::onChildExit(int signum) { (void)signum; }
+
+bool ServerSignal::takeReloadRequest() {
+  return __sync_lock_test_and_set(&_reloadRequested, 0) != 0;
+}
+
+bool ServerSignal::isShutdownRequested() { return _shutdownRequested != 0; }
+
+bool ServerSignal::takeUpgradeRequest() {
+  return __sync_lock_test_and_set(&_upgradeRequested, 0) != 0;
+}
+
+bool ServerSignal::isReloadRequested() { return _reloadRequested != 0; }
+
+bool ServerSignal::isUpgradeRequested() { return _upgradeRequested != 0; }
+
+bool ServerSignal::isTerminateRequested() { return _terminateRequested != 0; }
+
+void ServerSignal::requestReload() { _reloadRequested = 1; }
+
+void ServerSignal::requestShutdown() { _shutdownRequested = 1; }
+
+void ServerSignal::requestUpgrade() { _upgradeRequested = 1; }
+
+void ServerSignal::requestTerminate() { _terminateRequested = 1; }
+
+void ServerSignal::clear() {
+  _reloadRequested = 0;
+  _shutdownRequested = 0;
+  _upgradeRequested = 0;
+  _terminateRequested = 0;
+}
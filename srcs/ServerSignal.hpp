@@ -0,0 +1,66 @@
+#pragma once
+
+#include <signal.h>
+
+/**
+ * @class ServerSignal
+ * @brief サーバーを操作するシグナルを受け取り，イベントループに伝える
+ *
+ * - SIGHUP: 設定ファイルを読み直す
+ * - SIGQUIT: 新しい接続の受け付けをやめ，処理中の接続を終えてから停止する
+ * - SIGUSR2: リッスンソケットを引き継いで新しいバイナリを起動する
+ * - SIGTERM・SIGINT: マスタープロセスがワーカーを止めてから終了する
+ *
+ * ハンドラはフラグを立てるだけで，実際の処理はイベントループが次の周回で行う．
+ * SA_RESTARTを付けないので，待機中のpoll/epoll・waitpidはEINTRで戻る．
+ * マスタープロセスはこれらとSIGCHLDを止めておき，sigsuspendで待つ
+ * （要求を確かめてから待つまでの間に届いたシグナルを取りこぼさない）
+ */
+class ServerSignal {
+ public:
+  static void handleReload();
+  static void handleShutdown();
+  static void handleUpgrade();
+  static void handleTerminate();
+  // ワーカープロセスはマスターから受け取ったSIGTERMでそのまま終了する
+  static void resetTerminate();
+  // ワーカープロセスではマスターだけが再読み込み・入れ替えをするので，
+  // SIGHUP・SIGUSR2を無視する
+  static void ignoreReload();
+  static void ignoreUpgrade();
+  // マスタープロセスでは，ワーカーの終了でsigsuspendから戻るようにする
+  // （ワーカーはCGIの子プロセスを待つので，既定の動作に戻す）
+  static void handleChildExit();
+  static void resetChildExit();
+  // handleReloadなどで受け取るシグナルとSIGCHLDの集合（sigprocmask用）
+  static void masterSignals(sigset_t &set);
+
+  // 再読み込みの要求を取り出す（複数のスレッドから呼んでも1度だけtrue）
+  static bool takeReloadRequest();
+  static bool isShutdownRequested();
+  static bool takeUpgradeRequest();
+  // 取り出していない再読み込み・入れ替えの要求があるか
+  static bool isReloadRequested();
+  static bool isUpgradeRequested();
+  static bool isTerminateRequested();
+
+  // テストやマスタープロセスから要求を立てる
+  static void requestReload();
+  static void requestShutdown();
+  static void requestUpgrade();
+  static void requestTerminate();
+  static void clear();
+
+ private:
+  static volatile sig_atomic_t _reloadRequested;
+  static volatile sig_atomic_t _shutdownRequested;
+  static volatile sig_atomic_t _upgradeRequested;
+  static volatile sig_atomic_t _terminateRequested;
+
+  static void onReload(int signum);
+  static void onShutdown(int signum);
+  static void onUpgrade(int signum);
+  static void onTerminate(int signum);
+  static void onChildExit(int signum);
+  static void install(int signum, void (*handler)(int));
+};
@@ -0,0 +1,95 @@
+#include "StringTable.hpp"
+
+// 空の表のスロット数
+#define STRING_TABLE_INITIAL_SLOTS 16
+
+template <typename Case>
+BasicStringTable<Case>::BasicStringTable()
+    : _slots(STRING_TABLE_INITIAL_SLOTS), _size(0) {}
+
+// FNV-1a（文字をそろえてからハッシュする）
+template <typename Case>
+size_t BasicStringTable<Case>::hash(const char *name, size_t length) {
+  unsigned long h = 2166136261UL;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= Case::fold(name[i]);
+    h *= 16777619UL;
+  }
+  return static_cast<size_t>(h);
+}
+
+template <typename Case>
+bool BasicStringTable<Case>::equals(const std::string &a, const char *b,
+                                    size_t length) {
+  if (a.size() != length) {
+    return false;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    if (Case::fold(a[i]) != Case::fold(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Case>
+size_t BasicStringTable<Case>::probe(const char *name, size_t length,
+                                     size_t h) const {
+  size_t mask = _slots.size() - 1;
+  size_t index = h & mask;
+  while (_slots[index].value != -1 &&
+         (_slots[index].hash != h ||
+          !equals(_slots[index].name, name, length))) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+template <typename Case>
+void BasicStringTable<Case>::grow() {
+  std::vector<Slot> old;
+  old.swap(_slots);
+  _slots.resize(old.size() * 2);
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (old[i].value != -1) {
+      Slot &slot =
+          _slots[probe(old[i].name.data(), old[i].name.size(), old[i].hash)];
+      slot.name.swap(old[i].name);
+      slot.hash = old[i].hash;
+      slot.value = old[i].value;
+    }
+  }
+}
+
+template <typename Case>
+bool BasicStringTable<Case>::insert(const std::string &name, int value) {
+  // 空きスロットが半分を切らないように広げる
+  if ((_size + 1) * 2 > _slots.size()) {
+    grow();
+  }
+  size_t h = hash(name.data(), name.size());
+  Slot &slot = _slots[probe(name.data(), name.size(), h)];
+  if (slot.value != -1) {
+    return false;
+  }
+  slot.name = name;
+  slot.hash = h;
+  slot.value = value;
+  ++_size;
+  return true;
+}
+
+template <typename Case>
+int BasicStringTable<Case>::find(const char *name, size_t length) const {
+  return _slots[probe(name, length, hash(name, length))].value;
+}
+
+template <typename Case>
+void BasicStringTable<Case>::clear() {
+  std::vector<Slot>(STRING_TABLE_INITIAL_SLOTS).swap(_slots);
+  _size = 0;
+}
+
+// 使う表の分だけ実体化する
+template class BasicStringTable<CaseSensitive>;
+template class BasicStringTable<IgnoreCase>;
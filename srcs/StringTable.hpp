@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 名前をそのまま比べる（設定のセクション名など）
+struct CaseSensitive {
+  static unsigned char fold(char c) { return static_cast<unsigned char>(c); }
+};
+
+// 大文字・小文字を区別しない（Hostヘッダーの表記ゆれを吸収する）
+struct IgnoreCase {
+  static unsigned char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a')
+                                  : static_cast<unsigned char>(c);
+  }
+};
+
+/**
+ * @class BasicStringTable
+ * @brief 文字列から値（番号）を引くハッシュ表
+ *
+ * - 名前の比較とハッシュはCase::foldで文字をそろえてから行う
+ * - オープンアドレス法（線形探索）で，要素数の2倍以上のスロットを保つ
+ * - 検索はメモリ確保をせず，文字列の一部（ポートを除いた部分など）でも引ける
+ */
+template <typename Case>
+class BasicStringTable {
+ public:
+  BasicStringTable();
+
+  /**
+   * @brief nameに値valueを対応づける
+   * @return 既に同じ名前があれば追加せずfalse
+   */
+  bool insert(const std::string &name, int value);
+
+  // nameに対応する値（なければ-1）
+  int find(const char *name, size_t length) const;
+  int find(const std::string &name) const {
+    return find(name.data(), name.size());
+  }
+
+  size_t size() const { return _size; }
+  void clear();
+
+ private:
+  // キャッシュの読み書きはスロットを直接扱う
+  friend class ConfigCache;
+
+  struct Slot {
+    std::string name;
+    size_t hash;  // 名前を比べる前に比べる（別の名前の文字列を読まない）
+    int value;    // 空きスロットは-1
+
+    Slot() : hash(0), value(-1) {}
+  };
+
+  std::vector<Slot> _slots;  // 大きさは2のべき乗
+  size_t _size;
+
+  static size_t hash(const char *name, size_t length);
+  static bool equals(const std::string &a, const char *b, size_t length);
+  // nameが入っている，または入れるべきスロットの添字（hはnameのハッシュ）
+  size_t probe(const char *name, size_t length, size_t h) const;
+  void grow();
+};
+
+// 設定のセクション名などの表
+typedef BasicStringTable<CaseSensitive> StringTable;
+// ホスト名の表
+typedef BasicStringTable<IgnoreCase> HostTable;
@@ -1,125 +1,196 @@
 #include "TOMLParser.hpp"
 
-#include <algorithm>
-#include <cctype>
-#include <fstream>
-#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iterator>
+
+// ディレクティブの検索に使うキー（親の添字の4バイトに続けて子の名前を置く）
+// パス全体ではなく親子の組で引くので，キーは短く，要素の区切りも要らない
+static void setChildKey(std::string& key, size_t parent,
+                        const std::string& component) {
+  key.clear();
+  for (int i = 0; i < 4; ++i) {
+    key += static_cast<char>((parent >> (8 * i)) & 0xff);
+  }
+  key += component;
+}
+
+// 前後の空白を除いた文字列
+static std::string trimmed(const std::string& str) {
+  const char* whitespace = " \t\r\n";
+  size_t start = str.find_first_not_of(whitespace);
+  if (start == std::string::npos) {
+    return "";
+  }
+  return str.substr(start, str.find_last_not_of(whitespace) - start + 1);
+}
+
+// エスケープシーケンス（\の次の1文字）をoutに加える．未知のものはfalse
+static bool appendEscaped(char c, std::string& out) {
+  switch (c) {
+    case '"':
+      out += '"';
+      return true;
+    case '\'':
+      out += '\'';
+      return true;
+    case '\\':
+      out += '\\';
+      return true;
+    case 'n':
+      out += '\n';
+      return true;
+    case 'r':
+      out += '\r';
+      return true;
+    case 't':
+      out += '\t';
+      return true;
+    default:
+      return false;
+  }
+}
 
-TOMLParser::TOMLParser() : m_hasError(false) {}
+TOMLParser::TOMLParser() : m_cursor(NULL), m_end(NULL), m_line(0) {}
 
 TOMLParser::~TOMLParser() {}
 
 Directive* TOMLParser::parseFromFile(const std::string& filename) {
-  std::ifstream file(filename.c_str());
-  if (!file) {
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
     return NULL;
   }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    // 通常のファイルはmmapして，読み込んだ領域をそのまま走査する
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      return NULL;
+    }
+    Directive* rootDirective = parse(static_cast<const char*>(mapped), size);
+    munmap(mapped, size);
+    return rootDirective;
+  }
+  close(fd);
 
-  m_hasError = false;
-  m_sections.clear();
-
-  Directive* rootDirective = new Directive("root");
-  if (!parseLines(file, *rootDirective)) {
-    delete rootDirective;
+  // 空のファイルやパイプなどは読み込んでからパースする
+  std::ifstream file(filename.c_str());
+  if (!file) {
     return NULL;
   }
-  return rootDirective;
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  return parseFromString(content);
 }
 
 Directive* TOMLParser::parseFromString(const std::string& content) {
-  std::istringstream stream(content);
-
-  m_hasError = false;
-  m_sections.clear();
-
-  Directive* rootDirective = new Directive("root");
-  if (!parseLines(stream, *rootDirective)) {
-    delete rootDirective;
-    return NULL;
-  }
-  return rootDirective;
+  return parse(content.data(), content.size());
 }
 
-bool TOMLParser::parseLines(std::istream& stream, Directive& rootDirective) {
-  std::string line;
-  int lineNum = 0;
-  SectionPath currentPath;
-
-  // 最初はHTTPセクションを想定
-  currentPath.addComponent("http");
-
-  while (std::getline(stream, line)) {
-    lineNum++;
+TOMLParser::Token TOMLParser::nextToken() {
+  Token token;
+  while (m_cursor < m_end) {
+    const char* newline =
+        static_cast<const char*>(std::memchr(m_cursor, '\n', m_end - m_cursor));
+    const char* lineEnd = newline != NULL ? newline : m_end;
+    Slice line = trim(Slice(m_cursor, lineEnd - m_cursor));
+    m_cursor = newline != NULL ? newline + 1 : m_end;
+    token.line = ++m_line;
 
     // 空行とコメント行はスキップ
-    std::string trimmed = trim(line);
-    if (trimmed.empty() || trimmed[0] == '#') {
+    if (line.empty() || line.front() == '#') {
       continue;
     }
 
-    // インラインテーブルやテーブル配列のチェック
-    if (isTableArrayOrInlineTable(trimmed)) {
-      return false;
+    token.type = TOKEN_ERROR;
+    // インラインテーブルやテーブル配列，1行に複数のキーと値がある行は扱わない
+    if (isTableArrayOrInlineTable(line) || hasMultipleKeyValuesOnLine(line)) {
+      return token;
     }
 
-    // 1行に複数のキーと値があるかチェック
-    if (hasMultipleKeyValuesOnLine(trimmed)) {
-      return false;
+    // セクション行
+    if (line.front() == '[' && line.back() == ']') {
+      token.type = TOKEN_SECTION;
+      token.key = trim(line.sub(1, line.size - 2));
+      return token;
     }
 
-    // セクション行の解析
-    if (trimmed[0] == '[' && trimmed[trimmed.size() - 1] == ']') {
-      if (!parseSectionHeader(trimmed, currentPath, lineNum)) {
-        return false;
-      }
+    // キーと値
+    const char* equal =
+        static_cast<const char*>(std::memchr(line.data, '=', line.size));
+    if (equal != NULL) {
+      size_t equalPos = equal - line.data;
+      token.type = TOKEN_KEY_VALUE;
+      token.key = trim(line.sub(0, equalPos));
+      token.value = trim(line.sub(equalPos + 1, line.size - equalPos - 1));
+    }
+    return token;
+  }
+  token.type = TOKEN_EOF;
+  token.line = m_line;
+  return token;
+}
 
-      // セクションパスが重複していないかチェック
-      std::string sectionPathStr = currentPath.toString();
-      if (isDuplicateSection(m_sections, sectionPathStr)) {
-        return false;
-      }
-      m_sections.insert(sectionPathStr);
+Directive* TOMLParser::parse(const char* data, size_t size) {
+  m_cursor = data;
+  m_end = data + size;
+  m_line = 0;
+  m_directives.clear();
+  m_nodes.clear();
+  m_nodes.push_back(Node());
+  m_nodes.back().name = "root";
+  m_nodes.back().attached = true;
 
-      // セクションとキーの名前衝突をチェック
-      if (isSectionOrKeyConflict(rootDirective, currentPath)) {
-        return false;
+  // 最初はHTTPセクションを想定
+  SectionPath currentPath(1, "http");
+  size_t section = findOrCreateNode(currentPath);
+
+  for (Token token = nextToken(); token.type != TOKEN_EOF;
+       token = nextToken()) {
+    bool ok = false;
+    if (token.type == TOKEN_SECTION) {
+      // セクションパスが重複していないか，キーと名前が衝突しないかチェック
+      ok = parseSectionHeader(token.key, currentPath);
+      if (ok) {
+        section = findOrCreateNode(currentPath);
+        ok = !m_nodes[section].declared && !isSectionOrKeyConflict(section);
+        m_nodes[section].declared = true;
       }
+    } else if (token.type == TOKEN_KEY_VALUE) {
+      // キーのあるセクションだけを木に加える
+      attachNode(section);
+      ok = parseKeyValue(token, m_nodes[section].values);
     }
-    // キーと値の解析
-    else if (trimmed.find('=') != std::string::npos) {
-      Directive& sectionDirective =
-          createNestedDirectives(rootDirective, currentPath);
-      if (!parseKeyValue(trimmed, sectionDirective, lineNum)) {
-        return false;
-      }
-    } else {
-      // 無効な形式の行
-      return false;
+    if (!ok) {
+      m_nodes.clear();
+      return NULL;
     }
   }
 
-  return !m_hasError;
+  Directive* rootDirective = new Directive();
+  buildDirective(0, *rootDirective);
+  m_nodes.clear();
+  return rootDirective;
 }
 
-bool TOMLParser::parseSectionHeader(const std::string& line,
-                                    SectionPath& currentPath, int lineNum) {
-  // 未使用パラメータをvoidキャスト
-  (void)lineNum;
-
-  // [section.subsection] 形式からセクション名を抽出
-  std::string sectionName = line.substr(1, line.size() - 2);
-  sectionName = trim(sectionName);
-
+bool TOMLParser::parseSectionHeader(Slice name,
+                                    SectionPath& currentPath) const {
   // セクションパスをリセット
   currentPath.clear();
 
-  // セクション名を分解
+  // セクション名を分解（引用符の中の'.'では区切らない）
   std::string component;
   bool inQuote = false;
   char quoteChar = '\0';
 
-  for (size_t i = 0; i < sectionName.size(); ++i) {
-    char c = sectionName[i];
+  for (size_t i = 0; i < name.size; ++i) {
+    char c = name.data[i];
 
     if (!inQuote && (c == '"' || c == '\'')) {
       inQuote = true;
@@ -128,7 +199,7 @@ bool TOMLParser::parseSectionHeader(const std::string& line,
       inQuote = false;
       quoteChar = '\0';
     } else if (!inQuote && c == '.') {
-      currentPath.addComponent(trim(component));
+      currentPath.push_back(trimmed(component));
       component.clear();
     } else {
       component += c;
@@ -136,215 +207,133 @@ bool TOMLParser::parseSectionHeader(const std::string& line,
   }
 
   if (!component.empty()) {
-    currentPath.addComponent(trim(component));
+    currentPath.push_back(trimmed(component));
   }
 
-  // 引用符が閉じられていない場合はエラー
-  if (inQuote) {
-    return false;
-  }
-
-  // セクションパスが空の場合はエラー
-  if (currentPath.components.empty()) {
-    return false;
-  }
-
-  return true;
+  // 引用符が閉じられていない場合，セクションパスが空の場合はエラー
+  return !inQuote && !currentPath.empty();
 }
 
-bool TOMLParser::parseKeyValue(const std::string& line, Directive& directive,
-                               int lineNum) {
-  size_t equalPos = line.find('=');
-  if (equalPos == std::string::npos) {
-    return false;
-  }
-
-  std::string key = trim(line.substr(0, equalPos));
-  std::string valueStr = trim(line.substr(equalPos + 1));
-
-  // キーが空または有効でない場合はエラー
-  if (key.empty() || !isValidKey(key)) {
-    return false;
-  }
-
-  // 値が空の場合はエラー
-  if (valueStr.empty()) {
+bool TOMLParser::parseKeyValue(const Token& token,
+                               Directive::KVMap& keyValues) const {
+  // キーが空または有効でない場合，値が空の場合はエラー
+  if (token.key.empty() || !isValidKey(token.key) || token.value.empty()) {
     return false;
   }
 
   // 同じキーが既に存在するかチェック
-  if (hasDuplicateKeys(directive, key)) {
+  if (hasDuplicateKeys(keyValues, token.key)) {
     return false;
   }
 
-  bool error = false;
+  Slice value = token.value;
+  std::vector<std::string> values(1);
 
-  // 配列の解析
-  if (valueStr[0] == '[' && valueStr[valueStr.size() - 1] == ']') {
-    std::vector<std::string> values = parseArray(valueStr, lineNum, error);
-    if (error) {
+  if (value.front() == '[' && value.back() == ']') {
+    // 配列の解析（空の配列ならキーを追加しない）
+    values.clear();
+    if (!parseArray(value.sub(1, value.size - 2), values)) {
       return false;
     }
-    for (size_t i = 0; i < values.size(); ++i) {
-      directive.addKeyValue(key, values[i]);
+    if (values.empty()) {
+      return true;
     }
-  } else {
+  } else if ((value.front() == '"' && value.back() == '"') ||
+             (value.front() == '\'' && value.back() == '\'')) {
     // 文字列値の解析
-    if ((valueStr[0] == '"' && valueStr[valueStr.size() - 1] == '"') ||
-        (valueStr[0] == '\'' && valueStr[valueStr.size() - 1] == '\'')) {
-      valueStr = valueStr.substr(1, valueStr.size() - 2);
-      valueStr = unescapeString(valueStr, lineNum, error);
-      if (error) {
-        return false;
-      }
+    Slice content = value.size >= 2 ? value.sub(1, value.size - 2) : Slice();
+    if (!unescapeString(content, values[0])) {
+      return false;
     }
-    directive.addKeyValue(key, valueStr);
+  } else {
+    values[0] = value.str();
   }
-
+  // キーは重複していないので，値の配列をそのまま格納する
+  keyValues[token.key.str()].swap(values);
   return true;
 }
 
-std::vector<std::string> TOMLParser::parseArray(const std::string& arrayStr,
-                                                int lineNum, bool& error) {
-  std::vector<std::string> result;
-  std::string content = arrayStr.substr(1, arrayStr.size() - 2);
-
-  // 配列内に改行があるかチェック
-  if (content.find('\n') != std::string::npos) {
-    error = true;
-    return result;
-  }
-
+bool TOMLParser::parseArray(Slice content,
+                            std::vector<std::string>& values) const {
   size_t pos = 0;
-  while (pos < content.size()) {
+  while (pos < content.size) {
     // ホワイトスペースをスキップ
-    while (pos < content.size() && isWhitespace(content[pos])) {
+    while (pos < content.size && isWhitespace(content.data[pos])) {
       ++pos;
     }
+    if (pos >= content.size) {
+      break;
+    }
 
-    if (pos < content.size()) {
-      if (content[pos] == '"' || content[pos] == '\'') {
-        // 文字列の解析
-        std::string value = parseString(content, pos, lineNum, error);
-        if (error) {
-          return result;
-        }
-        result.push_back(value);
-      } else {
-        // 文字列以外（数値など）
-        size_t commaPos = content.find(',', pos);
-        if (commaPos == std::string::npos) {
-          commaPos = content.size();
-        }
-        std::string value = trim(content.substr(pos, commaPos - pos));
-        result.push_back(value);
-        pos = commaPos;
+    if (content.data[pos] == '"' || content.data[pos] == '\'') {
+      // 文字列の解析
+      values.push_back(std::string());
+      if (!parseString(content, pos, values.back())) {
+        return false;
       }
+    } else {
+      // 文字列以外（数値など）
+      const char* comma = static_cast<const char*>(
+          std::memchr(content.data + pos, ',', content.size - pos));
+      size_t commaPos = comma != NULL ? comma - content.data : content.size;
+      values.push_back(trim(content.sub(pos, commaPos - pos)).str());
+      pos = commaPos;
+    }
 
-      // 次の要素へ
-      while (pos < content.size() && content[pos] != ',') {
-        ++pos;
-      }
-      if (pos < content.size()) {
-        ++pos;  // カンマをスキップ
-      }
+    // 次の要素へ
+    while (pos < content.size && content.data[pos] != ',') {
+      ++pos;
+    }
+    if (pos < content.size) {
+      ++pos;  // カンマをスキップ
     }
   }
-
-  return result;
+  return true;
 }
 
-std::string TOMLParser::parseString(const std::string& str, size_t& pos,
-                                    int lineNum, bool& error) {
-  // 未使用パラメータをvoidキャスト
-  (void)lineNum;
-
-  char quoteChar = str[pos];
+bool TOMLParser::parseString(Slice str, size_t& pos,
+                             std::string& result) const {
+  char quoteChar = str.data[pos];
   ++pos;  // 開き引用符をスキップ
 
-  std::string result;
   bool escaped = false;
-
-  while (pos < str.size()) {
-    char c = str[pos];
+  for (; pos < str.size; ++pos) {
+    char c = str.data[pos];
 
     if (escaped) {
-      // エスケープシーケンス処理
-      switch (c) {
-        case '"':
-          result += '"';
-          break;
-        case '\'':
-          result += '\'';
-          break;
-        case '\\':
-          result += '\\';
-          break;
-        case 'n':
-          result += '\n';
-          break;
-        case 'r':
-          result += '\r';
-          break;
-        case 't':
-          result += '\t';
-          break;
-        default:
-          error = true;
-          return "";
+      if (!appendEscaped(c, result)) {
+        return false;
       }
       escaped = false;
     } else if (c == '\\') {
       escaped = true;
     } else if (c == quoteChar) {
       ++pos;  // 閉じ引用符をスキップ
-      return result;
+      return true;
     } else {
       result += c;
     }
-
-    ++pos;
   }
 
-  error = true;
-  return "";
+  // 閉じ引用符がない場合
+  return false;
 }
 
-std::string TOMLParser::unescapeString(const std::string& str, int lineNum,
-                                       bool& error) {
-  // 未使用パラメータをvoidキャスト
-  (void)lineNum;
+bool TOMLParser::unescapeString(Slice str, std::string& result) const {
+  // エスケープシーケンスがなければそのままコピーする
+  if (str.empty() || std::memchr(str.data, '\\', str.size) == NULL) {
+    result.assign(str.data, str.size);
+    return true;
+  }
 
-  std::string result;
+  result.reserve(str.size);
   bool escaped = false;
-
-  for (size_t i = 0; i < str.size(); ++i) {
-    char c = str[i];
+  for (size_t i = 0; i < str.size; ++i) {
+    char c = str.data[i];
 
     if (escaped) {
-      // エスケープシーケンス処理
-      switch (c) {
-        case '"':
-          result += '"';
-          break;
-        case '\'':
-          result += '\'';
-          break;
-        case '\\':
-          result += '\\';
-          break;
-        case 'n':
-          result += '\n';
-          break;
-        case 'r':
-          result += '\r';
-          break;
-        case 't':
-          result += '\t';
-          break;
-        default:
-          error = true;
-          return "";
+      if (!appendEscaped(c, result)) {
+        return false;
       }
       escaped = false;
     } else if (c == '\\') {
@@ -354,54 +343,70 @@ std::string TOMLParser::unescapeString(const std::string& str, int lineNum,
     }
   }
 
-  // 最後がエスケープシーケンスで終わっている場合
-  if (escaped) {
-    error = true;
-    return "";
-  }
-
-  return result;
+  // 最後がエスケープシーケンスで終わっている場合はエラー
+  return !escaped;
 }
 
-Directive& TOMLParser::createNestedDirectives(Directive& rootDirective,
-                                              const SectionPath& path) {
-  Directive* current = &rootDirective;
+size_t TOMLParser::findOrCreateNode(const SectionPath& path) {
+  size_t current = 0;
+  std::string key;
 
-  for (size_t i = 0; i < path.components.size(); ++i) {
-    const std::string& component = path.components[i];
-    bool found = false;
-
-    // 子ディレクティブの中から同じ名前のものを探す
-    for (size_t j = 0; j < current->children().size(); ++j) {
-      if (current->children()[j].name() == component) {
-        current = &current->children()[j];
-        found = true;
-        break;
-      }
+  for (size_t i = 0; i < path.size(); ++i) {
+    setChildKey(key, current, path[i]);
+    int found = m_directives.find(key);
+    if (found >= 0) {
+      current = static_cast<size_t>(found);
+      continue;
     }
 
-    // なければ新しく作成
-    if (!found) {
-      current->addChild(Directive(component));
-      current = &current->children()[current->children().size() - 1];
-    }
+    // なければ新しく作成（木に加えるのは最初のキーが現れたとき）
+    size_t child = m_nodes.size();
+    m_nodes.push_back(Node());
+    m_nodes.back().name = path[i];
+    m_nodes.back().parent = current;
+    m_directives.insert(key, static_cast<int>(child));
+    current = child;
   }
 
-  return *current;
+  return current;
 }
 
-// キーが有効かチェック（A-Za-z0-9のみ許容）
-bool TOMLParser::isValidKey(const std::string& key) const {
-  std::string unquotedKey = key;
+void TOMLParser::attachNode(size_t node) {
+  if (m_nodes[node].attached) {
+    return;
+  }
+  // 親から順に加える（子は添字を加えるだけで，木をコピーしない）
+  attachNode(m_nodes[node].parent);
+  m_nodes[m_nodes[node].parent].children.push_back(node);
+  m_nodes[node].attached = true;
+}
 
-  // 引用符で囲まれたキーの場合、引用符を取り除く
-  if ((key.size() >= 2 && key[0] == '"' && key[key.size() - 1] == '"') ||
-      (key.size() >= 2 && key[0] == '\'' && key[key.size() - 1] == '\'')) {
-    unquotedKey = key.substr(1, key.size() - 2);
+void TOMLParser::buildDirective(size_t node, Directive& directive) {
+  Node& source = m_nodes[node];
+  directive.setName(source.name);
+  directive.keyValues().swap(source.values);
+  // 子の配列は大きさを決めてから埋める（追加のたびに木をコピーしない）
+  Directive::DirectiveList& children = directive.children();
+  children.resize(source.children.size());
+  for (size_t i = 0; i < source.children.size(); ++i) {
+    buildDirective(source.children[i], children[i]);
   }
+}
+
+// 引用符で囲まれたキーの場合、引用符を取り除く
+TOMLParser::Slice TOMLParser::unquote(Slice key) {
+  if (key.size >= 2 && (key.front() == '"' || key.front() == '\'') &&
+      key.back() == key.front()) {
+    return key.sub(1, key.size - 2);
+  }
+  return key;
+}
 
-  for (size_t i = 0; i < unquotedKey.size(); ++i) {
-    char c = unquotedKey[i];
+// キーが有効かチェック（A-Za-z0-9_のみ許容）
+bool TOMLParser::isValidKey(Slice key) {
+  Slice unquotedKey = unquote(key);
+  for (size_t i = 0; i < unquotedKey.size; ++i) {
+    char c = unquotedKey.data[i];
     if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
           (c >= '0' && c <= '9') || c == '_')) {
       return false;
@@ -411,69 +416,41 @@ bool TOMLParser::isValidKey(const std::string& key) const {
 }
 
 // 同じキーが存在するかチェック
-bool TOMLParser::hasDuplicateKeys(const Directive& directive,
-                                  const std::string& key) const {
-  // キーが引用符で囲まれている場合は、引用符なしの同じキーと比較する
-  std::string unquotedKey = key;
-  if ((key.size() >= 2 && key[0] == '"' && key[key.size() - 1] == '"') ||
-      (key.size() >= 2 && key[0] == '\'' && key[key.size() - 1] == '\'')) {
-    unquotedKey = key.substr(1, key.size() - 2);
-  }
-
-  const std::map<std::string, std::vector<std::string> >& keyValues =
-      directive.keyValues();
-  for (std::map<std::string, std::vector<std::string> >::const_iterator it =
-           keyValues.begin();
-       it != keyValues.end(); ++it) {
-    std::string existingKey = it->first;
-
-    // 既存キーの引用符も取り除いて比較
-    if ((existingKey.size() >= 2 && existingKey[0] == '"' &&
-         existingKey[existingKey.size() - 1] == '"') ||
-        (existingKey.size() >= 2 && existingKey[0] == '\'' &&
-         existingKey[existingKey.size() - 1] == '\'')) {
-      existingKey = existingKey.substr(1, existingKey.size() - 2);
-    }
-
-    if (existingKey == unquotedKey) {
-      return true;  // 重複あり
-    }
-  }
-
-  return false;  // 重複なし
+// （引用符で囲まれたキーと，引用符なしの同じキーは同じものとみなす）
+bool TOMLParser::hasDuplicateKeys(const Directive::KVMap& keyValues,
+                                  Slice key) const {
+  std::string unquotedKey = unquote(key).str();
+  return keyValues.find(unquotedKey) != keyValues.end() ||
+         keyValues.find('"' + unquotedKey + '"') != keyValues.end() ||
+         keyValues.find('\'' + unquotedKey + '\'') != keyValues.end();
 }
 
 // テーブル配列かインラインテーブルかチェック
-bool TOMLParser::isTableArrayOrInlineTable(const std::string& line) const {
+bool TOMLParser::isTableArrayOrInlineTable(Slice line) {
   // テーブル配列 [[...]] のチェック
-  if (line.size() >= 2 && line[0] == '[' && line[1] == '[') {
+  if (line.size >= 2 && line.data[0] == '[' && line.data[1] == '[') {
     return true;
   }
 
   // インラインテーブル {key = val} のチェック
-  if (line.find('{') != std::string::npos) {
-    return true;
-  }
-
-  return false;
+  return std::memchr(line.data, '{', line.size) != NULL;
 }
 
 // 1行に複数のキーと値のペアがあるかチェック
-bool TOMLParser::hasMultipleKeyValuesOnLine(const std::string& line) const {
+bool TOMLParser::hasMultipleKeyValuesOnLine(Slice line) {
   bool inQuote = false;
   char quoteChar = '\0';
   size_t equalCount = 0;
 
-  for (size_t i = 0; i < line.size(); ++i) {
-    char c = line[i];
+  for (size_t i = 0; i < line.size; ++i) {
+    char c = line.data[i];
 
     if (!inQuote && (c == '"' || c == '\'')) {
       inQuote = true;
       quoteChar = c;
     } else if (inQuote && c == quoteChar &&
-               (i == 0 ||
-                line[i - 1] !=
-                    '\\')) {  // バックスラッシュでエスケープされていない
+               (i == 0 || line.data[i - 1] != '\\')) {
+      // バックスラッシュでエスケープされていない閉じ引用符
       inQuote = false;
     } else if (!inQuote && c == '=') {
       equalCount++;
@@ -487,88 +464,30 @@ bool TOMLParser::hasMultipleKeyValuesOnLine(const std::string& line) const {
 }
 
 // セクションとキーの衝突をチェック
-bool TOMLParser::isSectionOrKeyConflict(const Directive& directive,
-                                        const SectionPath& path) const {
-  Directive* current = const_cast<Directive*>(&directive);
-
-  // ルートディレクティブを確認
-  for (size_t i = 0; i < path.components.size() - 1; ++i) {
-    const std::string& component = path.components[i];
-    bool found = false;
-
-    for (size_t j = 0; j < current->children().size(); ++j) {
-      if (current->children()[j].name() == component) {
-        current = &current->children()[j];
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      return false;  // セクションがまだ存在しないので衝突なし
-    }
-  }
-
-  // 最後のコンポーネントがキーとして既に存在するかチェック
-  if (!path.components.empty()) {
-    const std::string& lastComponent = path.components.back();
-    const std::map<std::string, std::vector<std::string> >& keyValues =
-        current->keyValues();
-
-    for (std::map<std::string, std::vector<std::string> >::const_iterator it =
-             keyValues.begin();
-         it != keyValues.end(); ++it) {
-      if (it->first == lastComponent) {
-        return true;  // 衝突あり
-      }
-    }
-  }
-
-  return false;
-}
-
-// セクションが重複しているかチェック
-bool TOMLParser::isDuplicateSection(const std::set<std::string>& sections,
-                                    const std::string& sectionPath) const {
-  return sections.find(sectionPath) != sections.end();
+bool TOMLParser::isSectionOrKeyConflict(size_t node) const {
+  // セクションの名前が，親のセクションのキーとして既に存在するかチェック
+  // （キーのない親は値を持たないので衝突しない）
+  const Node& parent = m_nodes[m_nodes[node].parent];
+  return parent.values.find(m_nodes[node].name) != parent.values.end();
 }
 
-std::string TOMLParser::trim(const std::string& str) const {
+TOMLParser::Slice TOMLParser::trim(Slice str) {
   size_t start = 0;
-  size_t end = str.size();
+  size_t end = str.size;
 
   // 先頭の空白をスキップ
-  while (start < end && isWhitespace(str[start])) {
+  while (start < end && isWhitespace(str.data[start])) {
     ++start;
   }
 
   // 末尾の空白をスキップ
-  while (start < end && isWhitespace(str[end - 1])) {
+  while (start < end && isWhitespace(str.data[end - 1])) {
     --end;
   }
 
-  if (start >= end) {
-    return "";
-  }
-
-  return str.substr(start, end - start);
-}
-
-bool TOMLParser::startsWith(const std::string& str,
-                            const std::string& prefix) const {
-  if (str.size() < prefix.size()) {
-    return false;
-  }
-
-  for (size_t i = 0; i < prefix.size(); ++i) {
-    if (str[i] != prefix[i]) {
-      return false;
-    }
-  }
-
-  return true;
+  return str.sub(start, end - start);
 }
 
-bool TOMLParser::isWhitespace(char c) const {
+bool TOMLParser::isWhitespace(char c) {
   return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 }
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "Directive.hpp"
+#include "StringTable.hpp"
 #include "TOMLException.hpp"
 
+/**
+ * @class TOMLParser
+ * @brief 設定ファイル（TOMLのサブセット）をDirectiveの木にする
+ *
+ * 入力（ファイルはmmapしたもの）を先頭から1度だけ走査し，1行を1つのトークン
+ * （入力の一部を指すSlice）にする．文字列を作るのはDirectiveに格納する
+ * 名前と値だけで，行やキーをコピーしない．
+ * セクションの重複とDirectiveの検索はハッシュ表で引くので，
+ * パースにかかる時間は入力の大きさに比例する
+ */
 class TOMLParser {
  public:
   TOMLParser();
@@ -23,92 +34,93 @@ class TOMLParser {
   Directive* parseFromString(const std::string& content);
 
  private:
-  // セクション名とセクションパスを表現する構造体
-  struct SectionPath {
-    std::vector<std::string> components;
-
-    SectionPath() {}
-
-    void clear() { components.clear(); }
-
-    void addComponent(const std::string& component) {
-      components.push_back(component);
-    }
-
-    std::string toString() const {
-      std::string result;
-      for (size_t i = 0; i < components.size(); ++i) {
-        if (i > 0) {
-          result += ".";
-        }
-        result += components[i];
-      }
-      return result;
+  // 入力の一部を指す文字列（コピーしない）
+  struct Slice {
+    const char* data;
+    size_t size;
+
+    Slice() : data(NULL), size(0) {}
+    Slice(const char* d, size_t s) : data(d), size(s) {}
+
+    bool empty() const { return size == 0; }
+    char front() const { return data[0]; }
+    char back() const { return data[size - 1]; }
+    Slice sub(size_t pos, size_t length) const {
+      return Slice(data + pos, length);
     }
+    std::string str() const { return std::string(data, size); }
   };
 
   // トークンタイプを表す列挙型
   enum TokenType {
-    TOKEN_NONE,
-    TOKEN_SECTION_START,
-    TOKEN_SECTION_END,
-    TOKEN_KEY,
-    TOKEN_EQUAL,
-    TOKEN_VALUE,
-    TOKEN_ARRAY_START,
-    TOKEN_ARRAY_END,
-    TOKEN_COMMA,
-    TOKEN_DOT,
-    TOKEN_STRING,
-    TOKEN_EOF
+    TOKEN_SECTION,    // [section.subsection]
+    TOKEN_KEY_VALUE,  // key = value
+    TOKEN_EOF,
+    TOKEN_ERROR  // どちらの形式でもない行
   };
 
-  // トークンを表す構造体
+  // 1行を表すトークン（空行とコメント行はトークンにならない）
   struct Token {
     TokenType type;
-    std::string value;
+    Slice key;    // セクション名（[]の中）またはキー
+    Slice value;  // 値（TOKEN_KEY_VALUEのみ）
     int line;
+  };
+
+  // セクションのパス（"a.b"なら{"a", "b"}）
+  typedef std::vector<std::string> SectionPath;
 
-    Token() : type(TOKEN_NONE), line(1) {}
-    Token(TokenType t, const std::string& v, int l)
-        : type(t), value(v), line(l) {}
+  // パース中のディレクティブ（子は添字で持ち，最後にDirectiveの木にする）
+  struct Node {
+    std::string name;
+    Directive::KVMap values;
+    std::vector<size_t> children;  // m_nodesの添字（木に加えた順）
+    size_t parent;
+    bool declared;  // セクションとして書かれたか（重複の検査）
+    bool attached;  // 親のchildrenに加えたか（キーが現れるまでは加えない）
+
+    Node() : parent(0), declared(false), attached(false) {}
   };
 
+  // 字句解析：入力の次の行をトークンにする
+  Token nextToken();
+
   // 解析に必要なメソッド
-  bool parseLines(std::istream& stream, Directive& rootDirective);
-  bool parseSectionHeader(const std::string& line, SectionPath& currentPath,
-                          int lineNum);
-  bool parseKeyValue(const std::string& line, Directive& directive,
-                     int lineNum);
-  std::vector<std::string> parseArray(const std::string& arrayStr, int lineNum,
-                                      bool& error);
-  std::string parseString(const std::string& str, size_t& pos, int lineNum,
-                          bool& error);
+  Directive* parse(const char* data, size_t size);
+  bool parseSectionHeader(Slice name, SectionPath& currentPath) const;
+  bool parseKeyValue(const Token& token, Directive::KVMap& keyValues) const;
+  bool parseArray(Slice content, std::vector<std::string>& values) const;
+  bool parseString(Slice str, size_t& pos, std::string& result) const;
 
   // エスケープシーケンス処理
-  std::string unescapeString(const std::string& str, int lineNum, bool& error);
+  bool unescapeString(Slice str, std::string& result) const;
 
-  // ディレクティブ構築処理
-  Directive& createNestedDirectives(Directive& rootDirective,
-                                    const SectionPath& path);
+  // ディレクティブ構築処理（pathのディレクティブのm_nodesの添字）
+  size_t findOrCreateNode(const SectionPath& path);
+  // nodeとその祖先を，まだなら木に加える
+  void attachNode(size_t node);
+  // m_nodes[node]以下をdirectiveに移す（名前と値はコピーせずに入れ替える）
+  void buildDirective(size_t node, Directive& directive);
 
   // 文字列処理ヘルパー
-  std::string trim(const std::string& str) const;
-  bool startsWith(const std::string& str, const std::string& prefix) const;
-  bool isWhitespace(char c) const;
+  static Slice trim(Slice str);
+  static Slice unquote(Slice key);
+  static bool isWhitespace(char c);
 
   // バリデーションチェック
-  bool isValidKey(const std::string& key) const;
-  bool hasDuplicateKeys(const Directive& directive,
-                        const std::string& key) const;
-  bool isTableArrayOrInlineTable(const std::string& line) const;
-  bool hasMultipleKeyValuesOnLine(const std::string& line) const;
-  bool isSectionOrKeyConflict(const Directive& directive,
-                              const SectionPath& path) const;
-  bool isDuplicateSection(const std::set<std::string>& sections,
-                          const std::string& sectionPath) const;
-
-  // エラー状態を記録するためのフラグ
-  bool m_hasError;
-  std::set<std::string> m_sections;
+  static bool isValidKey(Slice key);
+  bool hasDuplicateKeys(const Directive::KVMap& keyValues, Slice key) const;
+  static bool isTableArrayOrInlineTable(Slice line);
+  static bool hasMultipleKeyValuesOnLine(Slice line);
+  bool isSectionOrKeyConflict(size_t node) const;
+
+  // 字句解析の状態（パース中の入力）
+  const char* m_cursor;
+  const char* m_end;
+  int m_line;
+
+  // 作成したディレクティブを，親の添字と名前から引く（値はm_nodesの添字）
+  StringTable m_directives;
+  // パース中のディレクティブ（m_nodes[0]が根．追加しても要素は移動しない）
+  std::deque<Node> m_nodes;
 };
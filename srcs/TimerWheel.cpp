@@ -0,0 +1,157 @@
+#include "TimerWheel.hpp"
+
+#include <time.h>
+
+// 階層levelの1スロットが表すティック数のビット数
+static int levelShift(int level) {
+  return level == 0 ? 0 : TIMER_LEVEL0_BITS + TIMER_LEVEL_BITS * (level - 1);
+}
+
+// 階層levelまでで表せるティック数のビット数
+static int levelRange(int level) {
+  return TIMER_LEVEL0_BITS + TIMER_LEVEL_BITS * level;
+}
+
+static size_t levelSize(int level) {
+  return static_cast<size_t>(1)
+         << (level == 0 ? TIMER_LEVEL0_BITS : TIMER_LEVEL_BITS);
+}
+
+// ミリ秒を（切り上げて）ティックに変換する
+static unsigned long toTick(unsigned long ms) {
+  return (ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+}
+
+TimerWheel::TimerWheel(unsigned long nowMs)
+    : _currentTick(nowMs / TIMER_TICK_MS), _size(0) {
+  for (int level = 0; level < TIMER_LEVELS; ++level) {
+    _slots[level].resize(levelSize(level));
+    for (size_t i = 0; i < _slots[level].size(); ++i) {
+      Timer &head = _slots[level][i];
+      head.prev = &head;
+      head.next = &head;
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  // 残っているタイマーを未登録の状態に戻す（埋め込み先は別に解放される）
+  for (int level = 0; level < TIMER_LEVELS; ++level) {
+    for (size_t i = 0; i < _slots[level].size(); ++i) {
+      Timer &head = _slots[level][i];
+      while (head.next != &head) {
+        unlink(*head.next);
+      }
+    }
+  }
+}
+
+unsigned long TimerWheel::currentTimeMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<unsigned long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+void TimerWheel::link(Timer &head, Timer &timer) {
+  timer.prev = head.prev;
+  timer.next = &head;
+  head.prev->next = &timer;
+  head.prev = &timer;
+}
+
+void TimerWheel::unlink(Timer &timer) {
+  timer.prev->next = timer.next;
+  timer.next->prev = timer.prev;
+  timer.prev = NULL;
+  timer.next = NULL;
+}
+
+// 期限までの残りティックに応じた階層のスロットにつなぐ
+void TimerWheel::place(Timer &timer) {
+  unsigned long maxDelta = (1UL << levelRange(TIMER_LEVELS - 1)) - 1;
+  if (timer.expires < _currentTick) {
+    timer.expires = _currentTick;
+  } else if (timer.expires - _currentTick > maxDelta) {
+    timer.expires = _currentTick + maxDelta;
+  }
+
+  unsigned long delta = timer.expires - _currentTick;
+  int level = 0;
+  while (delta >= (1UL << levelRange(level))) {
+    ++level;
+  }
+  size_t index =
+      (timer.expires >> levelShift(level)) & (_slots[level].size() - 1);
+  link(_slots[level][index], timer);
+}
+
+void TimerWheel::arm(Timer &timer, unsigned long timeoutMs,
+                     unsigned long nowMs) {
+  if (timer.isArmed()) {
+    unlink(timer);
+  } else {
+    ++_size;
+  }
+  timer.expires = toTick(nowMs + timeoutMs);
+  place(timer);
+}
+
+void TimerWheel::disarm(Timer &timer) {
+  if (!timer.isArmed()) {
+    return;
+  }
+  unlink(timer);
+  --_size;
+}
+
+// 上の階層のスロットのタイマーを，残りティックに応じて下の階層へ振り分け直す
+void TimerWheel::cascade(int level, size_t index) {
+  Timer &head = _slots[level][index];
+  while (head.next != &head) {
+    Timer *timer = head.next;
+    unlink(*timer);
+    place(*timer);
+  }
+}
+
+void TimerWheel::advance(unsigned long nowMs, std::vector<Timer *> &expired) {
+  unsigned long targetTick = nowMs / TIMER_TICK_MS;
+  while (_currentTick <= targetTick) {
+    // 下の階層が1周したら，上の階層の次のスロットを下ろす
+    for (int level = 1; level < TIMER_LEVELS; ++level) {
+      if (_currentTick & ((1UL << levelShift(level)) - 1)) {
+        break;
+      }
+      cascade(level, (_currentTick >> levelShift(level)) &
+                         (_slots[level].size() - 1));
+    }
+
+    Timer &head = _slots[0][_currentTick & (_slots[0].size() - 1)];
+    while (head.next != &head) {
+      Timer *timer = head.next;
+      unlink(*timer);
+      --_size;
+      expired.push_back(timer);
+    }
+    ++_currentTick;
+  }
+}
+
+int TimerWheel::nextTimeout(unsigned long nowMs) const {
+  if (_size == 0) {
+    return -1;
+  }
+
+  // 1段目を次の振り分け直しの時点まで見る（それより先は振り分け直しで起きる）
+  unsigned long tick = _currentTick;
+  do {
+    const Timer &head = _slots[0][tick & (_slots[0].size() - 1)];
+    if (head.next != &head) {
+      break;
+    }
+    ++tick;
+  } while (tick & (_slots[0].size() - 1));
+
+  unsigned long wakeMs = tick * TIMER_TICK_MS;
+  return wakeMs <= nowMs ? 0 : static_cast<int>(wakeMs - nowMs);
+}
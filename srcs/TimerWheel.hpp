@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// 1ティックの長さ（ミリ秒）
+#define TIMER_TICK_MS 100
+// 各階層のスロット数（下の階層ほど細かい）
+#define TIMER_LEVEL0_BITS 8
+#define TIMER_LEVEL_BITS 6
+#define TIMER_LEVELS 3
+
+/**
+ * @class TimerWheel
+ * @brief 接続ごとの期限（ヘッダー受信・ボディ受信・keep-alive・送信）を管理する階層型タイマーホイール
+ *
+ * - タイマーは接続に埋め込まれたノード（侵入型の双方向リスト）なので，
+ *   登録（arm）・解除（disarm）はどちらもO(1)で，メモリ確保もしない
+ * - 1段目は1ティック単位，2段目以降は下の段の1周分を1スロットとして持ち，
+ *   下の段が1周するたびに上の段のスロットを下の段へ振り分け直す
+ * - 表せる最大の期限（約29時間）を超えるタイマーは最大の期限に丸める
+ */
+class TimerWheel {
+ public:
+  // 期限を管理したいオブジェクトに埋め込むノード
+  struct Timer {
+    Timer *prev;
+    Timer *next;
+    unsigned long expires;  // 期限（ティック）
+    int fd;                 // 期限切れの通知先（接続のFD）
+
+    Timer() : prev(NULL), next(NULL), expires(0), fd(-1) {}
+    bool isArmed() const { return next != NULL; }
+  };
+
+  explicit TimerWheel(unsigned long nowMs);
+  ~TimerWheel();
+
+  /**
+   * @brief timeoutMsミリ秒後に期限が切れるよう登録する（登録済みなら付け替える）
+   */
+  void arm(Timer &timer, unsigned long timeoutMs, unsigned long nowMs);
+
+  // 登録を解除する（未登録なら何もしない）
+  void disarm(Timer &timer);
+
+  /**
+   * @brief 時刻nowMsまでに期限が切れたタイマーを取り外し，expiredに入れる
+   */
+  void advance(unsigned long nowMs, std::vector<Timer *> &expired);
+
+  /**
+   * @brief 次に期限が切れる可能性のある時刻までのミリ秒
+   * @return poll/epollのタイムアウトにそのまま使える値．タイマーがなければ-1
+   */
+  int nextTimeout(unsigned long nowMs) const;
+
+  size_t size() const { return _size; }
+
+  // 単調増加する現在時刻（ミリ秒）
+  static unsigned long currentTimeMs();
+
+ private:
+  // 各スロットは番兵ノードを先頭に持つ循環リスト
+  std::vector<Timer> _slots[TIMER_LEVELS];
+  // 次に処理するティック
+  unsigned long _currentTick;
+  size_t _size;
+
+  void place(Timer &timer);
+  void cascade(int level, size_t index);
+  static void link(Timer &head, Timer &timer);
+  static void unlink(Timer &timer);
+
+  // コピー防止（スロットがノードを指しているため）
+  TimerWheel(const TimerWheel &);
+  TimerWheel &operator=(const TimerWheel &);
+};
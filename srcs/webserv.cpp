@@ -1,11 +1,22 @@
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <set>
 #include <vector>
 
+#include "BinaryUpgrade.hpp"
+#include "ConfigCache.hpp"
+#include "ConfigSnapshot.hpp"
+#include "ConfigStore.hpp"
 #include "MultiPortServer.hpp"
-#include "OSInit.hpp"
 #include "RunServer.hpp"  // 明示的にインクルード
-#include "TOMLParser.hpp"
+#include "ServerSignal.hpp"
+#include "webserv.hpp"
 
 // stoiの再実装．string型の文字列を数値として読み取り，int型の値に変換する
 static int string_to_int(const std::string str) {
@@ -16,75 +27,483 @@ static int string_to_int(const std::string str) {
   return (result);
 }
 
-//// 複数のポートを用意（本来はconfファイルから取得）の関数を作る
-std::vector<int> getPorts() {
+// 1つのイベントループ（ワーカー）を動かすための設定
+struct WorkerConfig {
   std::vector<int> ports;
-  TOMLParser toml_parser;
-  Directive* directive = toml_parser.parseFromFile("./conf/webserv.conf");
-  if (directive == NULL) {
-    std::cerr << "Failed to parse configuration file" << std::endl;
-    return ports;
-  }
-  // ポート番号を取得
-  std::vector<std::string> listen_directives = directive->getValues("listen");
-  for (size_t i = 0; i < listen_directives.size(); ++i) {
-    std::string port_str = listen_directives[i];
-    int port = string_to_int(port_str);
-    ports.push_back(port);
+  std::string confPath;
+  // 起動時に1度だけパースした設定（全ワーカーで共有する）
+  ConfigSnapshot* snapshot;
+  // SIGHUPで読み直した設定を共有する（NULLなら読み直さない）
+  ConfigStore* store;
+  std::string backend;
+  bool reusePort;  // ワーカーごとにSO_REUSEPORTでリッスンソケットを作るか
+  int keepaliveTimeout;
+  int keepaliveRequests;
+  int clientHeaderTimeout;
+  int clientBodyTimeout;
+  int sendTimeout;
+  int acceptBatch;
+  int headerBufferCount;
+  int headerBufferSize;
+};
+
+// 各ポートでリッスンするソケットを作り，serverに登録する
+// バイナリの入れ替えで引き継いだソケットがあれば，bindし直さずにそのまま使う
+// （SO_REUSEPORTでリッスンする場合は，古いプロセスと並べて新しくbindする）
+static bool bindListeners(const WorkerConfig& config, MultiPortServer& server) {
+  server.setReusePort(config.reusePort);
+
+  for (size_t i = 0; i < config.ports.size(); ++i) {
+    int inherited = config.reusePort
+                        ? -1
+                        : BinaryUpgrade::takeInheritedListener(config.ports[i]);
+    if (inherited >= 0) {
+      server.addServerFd(inherited, config.ports[i]);
+    } else if (server.openPort(config.ports[i]) < 0) {
+      std::cerr << "Failed to initialize sockets" << std::endl;
+      server.closeSockets();
+      return false;
+    }
   }
-  delete directive;
-  return ports;
+  return true;
 }
 
-int webserv(int argc, char** argv) {
-  ServerData server_data;
-  OSInit osInit;
+// serverのリッスンソケットを監視するイベントループを実行する
+static int runEventLoop(const WorkerConfig& config, MultiPortServer& server) {
   RunServer run_server;
-  std::vector<int> ports = getPorts();
+  run_server.setConfPath(config.confPath);
+  if (config.store != NULL) {
+    run_server.set_config_store(config.store);
+  } else {
+    run_server.set_config(config.snapshot);
+  }
 
-  if (argc == 2) {
-    run_server.setConfPath(argv[1]);
+  // イベントループのバックエンドを設定（未指定ならepoll，なければpoll）
+  if (!run_server.set_event_backend(config.backend)) {
+    std::cerr << "Unsupported event_backend: " << config.backend << std::endl;
+    return EXIT_FAILURE;
+  }
+  run_server.set_keepalive_timeout(config.keepaliveTimeout);
+  run_server.set_keepalive_requests(config.keepaliveRequests);
+  run_server.set_client_header_timeout(config.clientHeaderTimeout);
+  run_server.set_client_body_timeout(config.clientBodyTimeout);
+  run_server.set_send_timeout(config.sendTimeout);
+  run_server.set_accept_batch(config.acceptBatch);
+  run_server.set_large_client_header_buffers(config.headerBufferCount,
+                                             config.headerBufferSize);
+
+  // イベントループで各サーバーFDを監視する
+  const std::vector<int>& server_fds = server.getServerFds();
+  for (size_t i = 0; i < server_fds.size(); ++i) {
+    run_server.add_watch_fd(server_fds[i]);
   }
 
+  run_server.runMultiPort(
+      server);  // このメソッド名が正確に一致していることを確認
+
+  return EXIT_SUCCESS;
+}
+
+// 各ポートでリッスンし，イベントループを実行する
+// ワーカーはリッスンソケット・イベントループ・接続を全て自分で持ち，他と共有しない
+static int runWorker(const WorkerConfig& config) {
   // マルチポートサーバーを作成
   MultiPortServer server;
-  server.setPorts(ports);
+  if (!bindListeners(config, server)) {
+    return EXIT_FAILURE;
+  }
+
+  int status = runEventLoop(config, server);
+
+  // 停止した場合（リッスンソケットは停止を始めた時点で閉じている）
+  server.closeSockets();
+
+  return status;
+}
+
+// 引き継いだが使わなかったソケットを閉じ，引き継ぎ元のプロセスに停止を求める
+static void finishUpgrade() {
+  BinaryUpgrade::closeInheritedListeners();
+  BinaryUpgrade::notifyParent();
+}
 
-  bool success = false;
+// pthread_createから呼ばれるワーカースレッドの入口
+static void* workerThread(void* arg) {
+  runWorker(*static_cast<WorkerConfig*>(arg));
+  return NULL;
+}
 
-  // 各ポートに対してServerDataを作成し、OSInitを使用して初期化
-  for (size_t i = 0; i < ports.size(); ++i) {
-    ServerData server_data(ports[i]);
-    osInit.initServer(server_data);
+// ワーカープロセスをforkする．子プロセスは継承したリッスンソケットでイベントループを実行する
+static pid_t spawnWorkerProcess(const WorkerConfig& config,
+                                MultiPortServer& server) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    // 設定の再読み込み・バイナリの入れ替えはマスターが行い，
+    // ワーカーはSIGQUITで入れ替わる
+    ServerSignal::clear();
+    ServerSignal::ignoreReload();
+    ServerSignal::ignoreUpgrade();
+    ServerSignal::handleShutdown();
+    ServerSignal::resetChildExit();
+    ServerSignal::resetTerminate();
+    std::exit(runEventLoop(config, server));
+  }
+  if (pid < 0) {
+    perror("fork");
+  }
+  return pid;
+}
 
-    // 初期化したサーバーFDを追加
-    int server_fd = server_data.get_server_fd();
-    if (server_fd >= 0) {
-      server.addServerFd(server_fd, ports[i]);
-      success = true;
+static void spawnWorkerProcesses(const WorkerConfig& config,
+                                 MultiPortServer& server, int workerProcesses,
+                                 std::set<pid_t>& workers) {
+  for (int i = 0; i < workerProcesses; ++i) {
+    pid_t pid = spawnWorkerProcess(config, server);
+    if (pid > 0) {
+      workers.insert(pid);
     }
   }
+}
 
-  if (!success) {
-    std::cerr << "Failed to initialize sockets" << std::endl;
-    return EXIT_FAILURE;
+// 古いワーカーを全て停止させる（処理中の接続を終えてから終了する）
+static void retireWorkers(std::set<pid_t>& workers, std::set<pid_t>& retiring) {
+  for (std::set<pid_t>::iterator it = workers.begin(); it != workers.end();
+       ++it) {
+    kill(*it, SIGQUIT);
+    retiring.insert(*it);
   }
+  workers.clear();
+}
 
-  // pollのために各サーバーFDを設定
-  const std::vector<int>& server_fds = server.getServerFds();
-  for (size_t i = 0; i < server_fds.size(); ++i) {
-    pollfd poll_fd;
-    poll_fd.fd = server_fds[i];
-    poll_fd.events = POLLIN;
-    run_server.add_poll_fd(poll_fd);
+// 全てのワーカーを処理中の接続を待たずに停止させる
+static void terminateWorkers(std::set<pid_t>& workers,
+                             std::set<pid_t>& retiring) {
+  retiring.insert(workers.begin(), workers.end());
+  workers.clear();
+  for (std::set<pid_t>::iterator it = retiring.begin(); it != retiring.end();
+       ++it) {
+    kill(*it, SIGTERM);
   }
+}
 
-  std::cout << "Starting multiport server" << std::endl;
-  run_server.runMultiPort(
-      server);  // このメソッド名が正確に一致していることを確認
+/**
+ * @brief 設定ファイルを読み直し，新しい設定のワーカーに入れ替える
+ *
+ * リッスンソケットを新しいlistenに合わせてから新しいワーカーを起動し，
+ * 古いワーカーにはSIGQUITを送る．古いワーカーは新しい接続を受け付けず，
+ * 処理中の接続を古い設定のまま終えてから終了する
+ */
+static void reloadWorkers(WorkerConfig& config, MultiPortServer& server,
+                          int workerProcesses, std::set<pid_t>& workers,
+                          std::set<pid_t>& retiring) {
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(config.confPath);
+  if (snapshot == NULL) {
+    std::cerr << "Failed to reload " << config.confPath
+              << ", keeping the current configuration" << std::endl;
+    return;
+  }
+  // 古い設定は起動済みのワーカーがそれぞれ持っているので，マスターでは手放す
+  config.snapshot->release();
+  config.snapshot = snapshot;
+  config.ports = snapshot->getPorts();
+
+  // listenから消えたポートを閉じ，増えたポートを開く
+  std::vector<int> listening = server.getPorts();
+  for (size_t i = 0; i < listening.size(); ++i) {
+    if (std::find(config.ports.begin(), config.ports.end(), listening[i]) ==
+        config.ports.end()) {
+      server.closePort(listening[i]);
+    }
+  }
+  for (size_t i = 0; i < config.ports.size(); ++i) {
+    if (std::find(listening.begin(), listening.end(), config.ports[i]) ==
+        listening.end()) {
+      server.openPort(config.ports[i]);
+    }
+  }
+
+  retireWorkers(workers, retiring);
+  spawnWorkerProcesses(config, server, workerProcesses, workers);
+  std::cout << "Reloaded " << config.confPath << std::endl;
+}
+
+// マスタープロセス：ポートを一度だけbindし，ワーカープロセスを起動して監視する
+// クラッシュした（シグナルで終了した）ワーカーは起動し直す
+// SIGHUPを受けたら設定を読み直し，ワーカーを入れ替える
+// SIGUSR2を受けたら新しいバイナリを起動し，SIGQUITを受けたらワーカーを停止させて終了する
+// SIGTERM・SIGINTではワーカーをすぐに停止させ，回収してから終了する
+static int runMaster(const WorkerConfig& initialConfig, int workerProcesses) {
+  WorkerConfig config = initialConfig;
+  MultiPortServer server;
+  if (!bindListeners(config, server)) {
+    return EXIT_FAILURE;
+  }
+  finishUpgrade();
+
+  ServerSignal::handleReload();
+  ServerSignal::handleShutdown();
+  ServerSignal::handleUpgrade();
+  ServerSignal::handleTerminate();
+  ServerSignal::handleChildExit();
+  sigset_t masterSignals;
+  ServerSignal::masterSignals(masterSignals);
+  std::set<pid_t> workers;
+  // SIGQUITを送った古いワーカー
+  std::set<pid_t> retiring;
+  spawnWorkerProcesses(config, server, workerProcesses, workers);
+
+  bool stopping = false;
+  bool terminating = false;
+  while (!workers.empty() || !retiring.empty()) {
+    // シグナルを止めた状態で，終了したワーカーと要求を確かめてから待つ
+    // （確かめた後に届いたシグナルは，sigsuspendが止めを解いた時点で届く）
+    sigset_t waitMask;
+    sigprocmask(SIG_BLOCK, &masterSignals, &waitMask);
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    // 停止中は新しい要求を扱わないので，待たずに回り続けないようにする
+    bool requested =
+        (!terminating && ServerSignal::isTerminateRequested()) ||
+        (!stopping && (ServerSignal::isShutdownRequested() ||
+                       ServerSignal::isUpgradeRequested() ||
+                       ServerSignal::isReloadRequested()));
+    if (pid == 0 && !requested) {
+      sigsuspend(&waitMask);
+    }
+    // forkするワーカー・新しいバイナリにはシグナルを止めたまま渡さない
+    sigprocmask(SIG_SETMASK, &waitMask, NULL);
+    if (pid < 0) {
+      perror("waitpid");
+      break;
+    }
+
+    if (!terminating && ServerSignal::isTerminateRequested()) {
+      // マスターだけが終了してワーカーが残らないよう，止めてから回収する
+      // （グレースフルな停止の途中でも，残っているワーカーを止める）
+      terminating = true;
+      stopping = true;
+      server.closeSockets();
+      terminateWorkers(workers, retiring);
+    }
+    if (!stopping && ServerSignal::isShutdownRequested()) {
+      // 新しい接続はリッスンソケットを引き継いだ新しいプロセスか，
+      // 他のサーバーが受け付ける
+      stopping = true;
+      server.closeSockets();
+      retireWorkers(workers, retiring);
+    }
+    if (!stopping && ServerSignal::takeUpgradeRequest()) {
+      BinaryUpgrade::spawn(server);
+    }
+    if (!stopping && ServerSignal::takeReloadRequest()) {
+      reloadWorkers(config, server, workerProcesses, workers, retiring);
+    }
+    if (pid == 0) {
+      // シグナルで起きた（終了したワーカーは次の周回で調べる）
+      continue;
+    }
+    if (retiring.erase(pid) > 0 || workers.erase(pid) == 0) {
+      // 起動に失敗した新しいバイナリもここに来る（このプロセスは動き続ける）
+      continue;
+    }
+    if (WIFSIGNALED(status)) {
+      std::cerr << "Worker " << pid << " killed by signal "
+                << WTERMSIG(status) << ", respawning" << std::endl;
+      pid_t newPid = spawnWorkerProcess(config, server);
+      if (newPid > 0) {
+        workers.insert(newPid);
+      }
+    } else {
+      // 設定エラーなどで終了したワーカーは起動し直しても同じ結果になる
+      std::cerr << "Worker " << pid << " exited with status "
+                << WEXITSTATUS(status) << std::endl;
+    }
+  }
 
-  // クリーンアップ（実行されることはないが念のため）
   server.closeSockets();
+  return stopping ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// worker_threadsなど，整数の設定値を読む（未指定ならdefaultValue，範囲外なら-1）
+static int getConfCount(const ConfigSnapshot& snapshot,
+                        const std::string& key, int defaultValue, int minValue,
+                        int maxValue) {
+  std::string value = snapshot.getValue(key);
+  if (value.empty()) {
+    return defaultValue;
+  }
+  int count = string_to_int(value);
+  if (count < minValue || count > maxValue) {
+    std::cerr << "Invalid " << key << ": " << value << std::endl;
+    return -1;
+  }
+  return count;
+}
+
+// large_client_header_buffers = "<数> <サイズ>"を読む
+// サイズにはK・Mを付けられる．未指定なら既定値のまま．不正な値ならfalse
+static bool getHeaderBuffers(const ConfigSnapshot& snapshot, int& count,
+                             int& size) {
+  const std::string key = "large_client_header_buffers";
+  std::string value = snapshot.getValue(key);
+  if (value.empty()) {
+    return true;
+  }
+  std::istringstream iss(value);
+  long bytes = 0;
+  std::string unit;
+  if (!(iss >> count >> bytes)) {
+    count = -1;
+  }
+  std::getline(iss, unit);
+  if (unit == "K" || unit == "k") {
+    bytes *= 1024;
+  } else if (unit == "M" || unit == "m") {
+    bytes *= 1024 * 1024;
+  } else if (!unit.empty()) {
+    bytes = -1;
+  }
+  if (count < 1 || count > MAX_LARGE_CLIENT_HEADER_BUFFERS || bytes < 1 ||
+      bytes > MAX_LARGE_CLIENT_HEADER_BUFFER_SIZE) {
+    std::cerr << "Invalid " << key << ": " << value << std::endl;
+    return false;
+  }
+  size = static_cast<int>(bytes);
+  return true;
+}
 
+// --compile-config: 設定ファイルをパースしてキャッシュを書き出し，サーバーは起動しない
+static int compileConfig(const std::string& confPath) {
+  if (!ConfigCache::compile(confPath)) {
+    std::cerr << "Failed to compile " << confPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Compiled " << confPath << " to "
+            << ConfigCache::cachePath(confPath) << std::endl;
   return EXIT_SUCCESS;
 }
+
+int webserv(int argc, char** argv) {
+  WorkerConfig config;
+  config.confPath = DEFAULT_CONF_PATH;
+
+  if (argc >= 2 && std::string(argv[1]) == COMPILE_CONFIG_OPTION) {
+    return compileConfig(argc >= 3 ? argv[2] : DEFAULT_CONF_PATH);
+  }
+
+  if (argc == 2) {
+    config.confPath = argv[1];
+  }
+  // バイナリの入れ替えでは，同じコマンドラインで新しいバイナリを起動する
+  BinaryUpgrade::setArgv(argv);
+  BinaryUpgrade::loadInheritedListeners();
+
+  // 設定ファイルはここで1度だけパースし，以降はスナップショットを参照する
+  // （SIGHUPで読み直すまで使い続ける）
+  config.snapshot = ConfigSnapshot::load(config.confPath);
+  if (config.snapshot == NULL) {
+    std::cerr << "Failed to parse configuration file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const ConfigSnapshot& snapshot = *config.snapshot;
+  config.ports = snapshot.getPorts();
+  config.backend = snapshot.getValue("event_backend");
+
+  // イベントループの数（未指定なら1）
+  int workerThreads =
+      getConfCount(snapshot, "worker_threads", 1, 1, MAX_WORKER_THREADS);
+  // ワーカープロセスの数（未指定ならマスターを作らず，このプロセスで処理する）
+  int workerProcesses =
+      getConfCount(snapshot, "worker_processes", 0, 1, MAX_WORKER_PROCESSES);
+  // keep-aliveの設定（keepalive_timeout = 0ならkeep-aliveしない）
+  config.keepaliveTimeout =
+      getConfCount(snapshot, "keepalive_timeout", DEFAULT_KEEPALIVE_TIMEOUT, 0,
+                   MAX_TIMEOUT_SECONDS);
+  config.keepaliveRequests =
+      getConfCount(snapshot, "keepalive_requests",
+                   DEFAULT_KEEPALIVE_REQUESTS, 1, MAX_KEEPALIVE_REQUESTS);
+  // 受信・送信が止まった接続を閉じるまでの秒数
+  config.clientHeaderTimeout =
+      getConfCount(snapshot, "client_header_timeout",
+                   DEFAULT_CLIENT_HEADER_TIMEOUT, 1, MAX_TIMEOUT_SECONDS);
+  config.clientBodyTimeout =
+      getConfCount(snapshot, "client_body_timeout",
+                   DEFAULT_CLIENT_BODY_TIMEOUT, 1, MAX_TIMEOUT_SECONDS);
+  config.sendTimeout = getConfCount(snapshot, "send_timeout",
+                                    DEFAULT_SEND_TIMEOUT, 1,
+                                    MAX_TIMEOUT_SECONDS);
+  // リッスンソケットの1回の通知で受け付ける接続の上限
+  config.acceptBatch = getConfCount(snapshot, "accept_batch",
+                                    DEFAULT_ACCEPT_BATCH, 1, MAX_ACCEPT_BATCH);
+  // リクエストライン・ヘッダーの上限（超えたら414・431を返す）
+  config.headerBufferCount = DEFAULT_LARGE_CLIENT_HEADER_BUFFERS;
+  config.headerBufferSize = DEFAULT_LARGE_CLIENT_HEADER_BUFFER_SIZE;
+  if (!getHeaderBuffers(snapshot, config.headerBufferCount,
+                        config.headerBufferSize)) {
+    return EXIT_FAILURE;
+  }
+  if (workerThreads < 0 || workerProcesses < 0 ||
+      config.keepaliveTimeout < 0 || config.keepaliveRequests < 0 ||
+      config.clientHeaderTimeout < 0 || config.clientBodyTimeout < 0 ||
+      config.sendTimeout < 0 || config.acceptBatch < 0) {
+    return EXIT_FAILURE;
+  }
+  if (workerThreads > 1 && workerProcesses > 0) {
+    std::cerr << "worker_threads and worker_processes cannot be combined"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const char* backend =
+      config.backend.empty() ? DEFAULT_EVENT_BACKEND : config.backend.c_str();
+  if (workerProcesses > 0) {
+    // ワーカープロセスはマスターがbindしたリッスンソケットを共有する
+    // 設定の再読み込みはワーカーの入れ替えで行う
+    config.reusePort = false;
+    config.store = NULL;
+    std::cout << "Starting multiport server (" << backend << ", "
+              << workerProcesses << " worker process(es))" << std::endl;
+    int status = runMaster(config, workerProcesses);
+    config.snapshot->release();
+    return status;
+  }
+
+  // 複数のイベントループがある場合は，それぞれが同じポートでリッスンする
+  config.reusePort = workerThreads > 1;
+  // SIGHUPで読み直した設定を全スレッドで共有する
+  // （スナップショットの参照を引き取り，全スレッドを待った後に解放する）
+  ConfigStore store(config.snapshot);
+  config.store = &store;
+  ServerSignal::handleReload();
+  ServerSignal::handleShutdown();
+  ServerSignal::handleUpgrade();
+
+  std::cout << "Starting multiport server (" << backend << ", "
+            << workerThreads << " worker thread(s))" << std::endl;
+
+  // メインスレッドのリッスンソケットを先に用意し，引き継ぎ元に準備ができたことを伝える
+  MultiPortServer server;
+  if (!bindListeners(config, server)) {
+    return EXIT_FAILURE;
+  }
+  finishUpgrade();
+
+  // メインスレッドも1つのワーカーとして動くので，残りの数だけスレッドを作る
+  std::vector<pthread_t> threads;
+  for (int i = 1; i < workerThreads; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, workerThread, &config) != 0) {
+      std::cerr << "Failed to create worker thread" << std::endl;
+      break;
+    }
+    threads.push_back(thread);
+  }
+  int status = runEventLoop(config, server);
+  server.closeSockets();
+
+  // 停止する場合は，他のスレッドが処理中の接続を終えるのを待つ
+  for (size_t i = 0; i < threads.size(); ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  return status;
+}
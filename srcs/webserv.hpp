@@ -1,4 +1,20 @@
 #pragma once
 
+// worker_threadsの上限
+#define MAX_WORKER_THREADS 256
+// worker_processesの上限
+#define MAX_WORKER_PROCESSES 256
+// keepalive_timeoutなどのタイムアウト（秒）とkeepalive_requestsの上限
+#define MAX_TIMEOUT_SECONDS 3600
+#define MAX_KEEPALIVE_REQUESTS 100000
+// accept_batchの上限
+#define MAX_ACCEPT_BATCH 4096
+// large_client_header_buffersの数とサイズ（バイト）の上限
+#define MAX_LARGE_CLIENT_HEADER_BUFFERS 64
+#define MAX_LARGE_CLIENT_HEADER_BUFFER_SIZE (1024 * 1024)
+
+// 設定ファイルのキャッシュを書き出すオプション（webserv --compile-config [設定ファイル]）
+#define COMPILE_CONFIG_OPTION "--compile-config"
+
 // この関数は複数ポートに対応したサーバーを起動します
 int webserv(int argc, char **argv);
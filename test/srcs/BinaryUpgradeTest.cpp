@@ -0,0 +1,130 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "BinaryUpgrade.hpp"
+
+class BinaryUpgradeTest : public ::testing::Test {
+ protected:
+  virtual void TearDown() {
+    BinaryUpgrade::closeInheritedListeners();
+    BinaryUpgrade::setArgv(NULL);
+    unsetenv(LISTENERS_ENV);
+    unsetenv(UPGRADE_PARENT_ENV);
+  }
+
+  // ループバックでリッスンするソケット（ポートはOSに選ばせる）
+  static int listenOnLoopback() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 16) < 0) {
+      return -1;
+    }
+    return fd;
+  }
+};
+
+// 環境変数で渡されたリッスンソケットをポートごとに引き継ぐ
+TEST_F(BinaryUpgradeTest, LoadInheritedListeners) {
+  int listenFd = listenOnLoopback();
+  ASSERT_GE(listenFd, 0);
+  // リッスンしていないソケットは引き継がない
+  int plainFd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(plainFd, 0);
+
+  std::ostringstream value;
+  value << listenFd << ":8001;" << plainFd << ":8002;broken";
+  setenv(LISTENERS_ENV, value.str().c_str(), 1);
+  BinaryUpgrade::loadInheritedListeners();
+
+  // 子プロセスには渡さないように消される
+  EXPECT_EQ(std::getenv(LISTENERS_ENV), nullptr);
+  EXPECT_EQ(BinaryUpgrade::takeInheritedListener(8002), -1);
+  EXPECT_EQ(BinaryUpgrade::takeInheritedListener(8001), listenFd);
+  EXPECT_TRUE(fcntl(listenFd, F_GETFD) & FD_CLOEXEC);
+  // 引き継げるのは1度だけ
+  EXPECT_EQ(BinaryUpgrade::takeInheritedListener(8001), -1);
+
+  close(listenFd);
+  close(plainFd);
+}
+
+// 使われなかったソケットは閉じる
+TEST_F(BinaryUpgradeTest, CloseInheritedListeners) {
+  int listenFd = listenOnLoopback();
+  ASSERT_GE(listenFd, 0);
+  std::ostringstream value;
+  value << listenFd << ":8001";
+  setenv(LISTENERS_ENV, value.str().c_str(), 1);
+  BinaryUpgrade::loadInheritedListeners();
+
+  BinaryUpgrade::closeInheritedListeners();
+  EXPECT_EQ(fcntl(listenFd, F_GETFD), -1);
+  EXPECT_EQ(BinaryUpgrade::takeInheritedListener(8001), -1);
+}
+
+// 新しいプロセスには，リッスンソケットが開いたまま環境変数と一緒に渡される
+TEST_F(BinaryUpgradeTest, SpawnPassesListeners) {
+  MultiPortServer server;
+  int listenFd = listenOnLoopback();
+  ASSERT_GE(listenFd, 0);
+  ASSERT_NE(fcntl(listenFd, F_SETFD, FD_CLOEXEC), -1);
+  server.addServerFd(listenFd, 8001);
+
+  const std::string output = "/tmp/webserv_upgrade_test";
+  std::ostringstream script;
+  script << "echo \"$" << LISTENERS_ENV << "\" > " << output
+         << "; [ -e /proc/self/fd/" << listenFd << " ] && echo open >> "
+         << output;
+  std::string command = script.str();
+  char sh[] = "/bin/sh";
+  char c[] = "-c";
+  char* argv[] = {sh, c, &command[0], NULL};
+  BinaryUpgrade::setArgv(argv);
+
+  pid_t pid = BinaryUpgrade::spawn(server);
+  ASSERT_GT(pid, 0);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+
+  std::ifstream file(output.c_str());
+  std::string listeners, open;
+  std::getline(file, listeners);
+  std::getline(file, open);
+  std::ostringstream expected;
+  expected << listenFd << ":8001";
+  EXPECT_EQ(listeners, expected.str());
+  EXPECT_EQ(open, "open");
+  // 起動した側のソケットはclose-on-execのまま
+  EXPECT_TRUE(fcntl(listenFd, F_GETFD) & FD_CLOEXEC);
+  std::remove(output.c_str());
+}
+
+// コマンドラインが設定されていなければ起動しない
+TEST_F(BinaryUpgradeTest, SpawnWithoutArgv) {
+  MultiPortServer server;
+  EXPECT_EQ(BinaryUpgrade::spawn(server), -1);
+}
+
+// 親プロセスが引き継ぎ元でなければ，シグナルを送らない
+TEST_F(BinaryUpgradeTest, NotifyParentOnlyWhenParentMatches) {
+  setenv(UPGRADE_PARENT_ENV, "1", 1);
+  BinaryUpgrade::loadInheritedListeners();
+  EXPECT_EQ(std::getenv(UPGRADE_PARENT_ENV), nullptr);
+  // initにはSIGQUITを送らない（送った場合もテストは終了しない）
+  BinaryUpgrade::notifyParent();
+}
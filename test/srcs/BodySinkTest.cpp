@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "../../srcs/BodySink.hpp"
+
+namespace {
+// 書き込まれたボディを文字列に溜める受け取り先
+class StringSink : public BodySink {
+ public:
+  bool write(const char* data, size_t length) override {
+    out.append(data, length);
+    return true;
+  }
+  std::string out;
+};
+
+std::string pattern(size_t size) {
+  std::string result;
+  for (size_t i = 0; i < size; ++i) {
+    result += static_cast<char>('a' + i % 26);
+  }
+  return result;
+}
+}  // namespace
+
+// threshold以下のボディはメモリに置く
+TEST(BodySinkTest, SmallBodyStaysInMemory) {
+  SpoolBodySink spool(16);
+  ASSERT_TRUE(spool.write("hello ", 6));
+  ASSERT_TRUE(spool.write("world", 5));
+  EXPECT_TRUE(spool.inMemory());
+  EXPECT_EQ(spool.fd(), -1);
+  EXPECT_EQ(spool.size(), 11u);
+  EXPECT_EQ(spool.memory(), "hello world");
+
+  StringSink sink;
+  EXPECT_TRUE(spool.copyTo(sink));
+  EXPECT_EQ(sink.out, "hello world");
+}
+
+// thresholdを超えたら一時ファイルに移し，メモリは手放す
+TEST(BodySinkTest, LargeBodySpillsToFile) {
+  SpoolBodySink spool(1024);
+  std::string body = pattern(300000);
+  for (size_t pos = 0; pos < body.size(); pos += 1000) {
+    ASSERT_TRUE(spool.write(body.data() + pos, 1000));
+  }
+  EXPECT_FALSE(spool.inMemory());
+  EXPECT_NE(spool.fd(), -1);
+  EXPECT_TRUE(spool.memory().empty());
+  EXPECT_EQ(spool.size(), body.size());
+
+  std::string result;
+  EXPECT_TRUE(spool.readAll(result));
+  EXPECT_EQ(result, body);
+  // 読み出しても書き込み位置は変わらない
+  ASSERT_TRUE(spool.write("tail", 4));
+  EXPECT_TRUE(spool.readAll(result));
+  EXPECT_EQ(result, body + "tail");
+}
+
+// clearで一時ファイルを閉じ，メモリに戻る
+TEST(BodySinkTest, ClearClosesTemporaryFile) {
+  SpoolBodySink spool(4);
+  ASSERT_TRUE(spool.write("0123456789", 10));
+  int fd = spool.fd();
+  ASSERT_NE(fd, -1);
+  spool.clear();
+  EXPECT_TRUE(spool.inMemory());
+  EXPECT_EQ(spool.size(), 0u);
+  EXPECT_EQ(fcntl(fd, F_GETFD), -1);
+
+  ASSERT_TRUE(spool.write("abc", 3));
+  EXPECT_EQ(spool.memory(), "abc");
+}
+
+// FileBodySinkはパイプにも書き込める
+TEST(BodySinkTest, FileSinkWritesToPipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  FileBodySink sink(fds[1]);
+  EXPECT_TRUE(sink.write("body", 4));
+  close(fds[1]);
+
+  char buffer[16];
+  ssize_t n = read(fds[0], buffer, sizeof(buffer));
+  close(fds[0]);
+  EXPECT_EQ(std::string(buffer, n > 0 ? n : 0), "body");
+
+  // 閉じたFDには書き込めない
+  FileBodySink closed(fds[1]);
+  EXPECT_FALSE(closed.write("x", 1));
+}
@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
 
 #include "../../srcs/CGI.hpp"
 
@@ -191,8 +195,7 @@ class CGITest : public ::testing::Test {
   virtual void TearDown() {
     // テスト環境のクリーンアップ
     system("rm -rf /tmp/webserv");
-    system("rm -f /tmp/.cgi_response.html");
-    system("rm -f /tmp/.cgi_post_data");
+    std::remove(getCGIPagePath().c_str());
   }
 
   // ファイルが存在するか確認するヘルパーメソッド
@@ -269,10 +272,10 @@ TEST_F(CGITest, ExecuteCGISuccessTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // CGIの出力内容に期待する文字列が含まれていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("Hello from CGI") != std::string::npos);
 }
 
@@ -339,10 +342,10 @@ TEST_F(CGITest, ExecuteCGIWithPostDataTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // CGIの出力内容にPOSTデータが反映されていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("Received: name=test") != std::string::npos);
 }
 
@@ -360,10 +363,10 @@ TEST_F(CGITest, EnvironmentVariablesTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // 環境変数が正しく設定されていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("REQUEST_METHOD: GET") != std::string::npos);
   EXPECT_TRUE(content.find("QUERY_STRING: param=value") != std::string::npos);
   EXPECT_TRUE(content.find("SERVER_NAME: localhost") != std::string::npos);
@@ -418,9 +421,9 @@ TEST_F(CGITest, DirectoryPathResolutionTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIが実行された場合、出力ファイルが生成されているはず
-  if (fileExists(CGI_PAGE)) {
+  if (fileExists(getCGIPagePath())) {
     // CGIの出力内容に期待する文字列が含まれていることを確認
-    std::string content = readFileContents(CGI_PAGE);
+    std::string content = readFileContents(getCGIPagePath());
     EXPECT_TRUE(content.find("Directory Index") != std::string::npos);
   } else {
     // ファイルが生成されていない場合は、HTTPResponseボディがディレクトリリストである
@@ -461,7 +464,7 @@ TEST_F(CGITest, QueryParameterTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // クエリ文字列が正しく環境変数に設定されていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("QUERY_STRING: name=value&test=123") !=
               std::string::npos);
 }
@@ -548,10 +551,10 @@ TEST_F(CGITest, ExecuteShellCGISuccessTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // CGIの出力内容に期待する文字列が含まれていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("Hello from Shell Script") != std::string::npos);
 }
 
@@ -604,10 +607,10 @@ TEST_F(CGITest, ExecuteShellCGIWithPostDataTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // CGIの出力内容にPOSTデータが反映されていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("Received: name=test") != std::string::npos);
 }
 
@@ -625,10 +628,10 @@ TEST_F(CGITest, ShellEnvironmentVariablesTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIの出力ファイルが生成されていることを確認
-  EXPECT_TRUE(fileExists(CGI_PAGE));
+  EXPECT_TRUE(fileExists(getCGIPagePath()));
 
   // 環境変数が正しく設定されていることを確認
-  std::string content = readFileContents(CGI_PAGE);
+  std::string content = readFileContents(getCGIPagePath());
   EXPECT_TRUE(content.find("REQUEST_METHOD=GET") != std::string::npos);
   EXPECT_TRUE(content.find("QUERY_STRING=param=value") != std::string::npos);
   EXPECT_TRUE(content.find("SERVER_NAME=localhost") != std::string::npos);
@@ -656,9 +659,9 @@ TEST_F(CGITest, ShellScriptDirectoryIndexTest) {
   EXPECT_EQ(200, response.getHttpStatusCode());
 
   // CGIが実行された場合、出力ファイルが生成されているはず
-  if (fileExists(CGI_PAGE)) {
+  if (fileExists(getCGIPagePath())) {
     // CGIの出力内容に期待する文字列が含まれていることを確認
-    std::string content = readFileContents(CGI_PAGE);
+    std::string content = readFileContents(getCGIPagePath());
     EXPECT_TRUE(content.find("Directory Index from Shell") !=
                 std::string::npos);
   }
@@ -702,6 +705,57 @@ TEST_F(CGITest, NonExistentDirectoryTest) {
 //   system("rm -rf /tmp/webserv/www/empty-dir/");
 // }
 
+// pathが/tmp/.cgi_response.<pid>.<n>.htmlの形か
+static bool isCGIPagePathOf(const std::string& path, pid_t pid) {
+  std::ostringstream prefix;
+  prefix << "/tmp/.cgi_response." << pid << ".";
+  const std::string suffix = ".html";
+  return path.size() > prefix.str().size() + suffix.size() &&
+         path.compare(0, prefix.str().size(), prefix.str()) == 0 &&
+         path.compare(path.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+// 応答ファイルのパスはスレッドごとに1度だけ組み立て，forkした子では組み直す
+TEST(CGIPagePathTest, RebuiltWithPidAfterFork) {
+  const std::string& path = getCGIPagePath();
+  EXPECT_EQ(&path, &getCGIPagePath());
+  const std::string expected = path;
+  EXPECT_TRUE(isCGIPagePathOf(path, getpid()));
+
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    _exit(isCGIPagePathOf(getCGIPagePath(), getpid()) ? 0 : 1);
+  }
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_EQ(getCGIPagePath(), expected);
+}
+
+static void* copyCGIPagePath(void* path) {
+  *static_cast<std::string*>(path) = getCGIPagePath();
+  return NULL;
+}
+
+// worker_threadsのスレッドどうしは，同じプロセスでも別のファイルを使う
+TEST(CGIPagePathTest, DiffersBetweenThreads) {
+  std::string paths[2];
+  pthread_t threads[2];
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(pthread_create(&threads[i], NULL, copyCGIPagePath, &paths[i]),
+              0);
+  }
+  for (int i = 0; i < 2; ++i) {
+    pthread_join(threads[i], NULL);
+    EXPECT_TRUE(isCGIPagePathOf(paths[i], getpid()));
+    EXPECT_NE(paths[i], getCGIPagePath());
+  }
+  EXPECT_NE(paths[0], paths[1]);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
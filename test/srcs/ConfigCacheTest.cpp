@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ConfigCache.hpp"
+#include "ConfigSnapshot.hpp"
+
+class ConfigCacheTest : public ::testing::Test {
+ protected:
+  const std::string filename = "temp_config_cache_test.conf";
+
+  virtual void TearDown() {
+    std::remove(filename.c_str());
+    std::remove(ConfigCache::cachePath(filename).c_str());
+  }
+
+  void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << content;
+  }
+
+  // 設定ファイルの更新時刻を決める（更新時刻だけでは書き換えに気づけない場合）
+  void touch(const std::string& path, time_t mtime) {
+    struct utimbuf times;
+    times.actime = mtime;
+    times.modtime = mtime;
+    utime(path.c_str(), &times);
+  }
+};
+
+namespace {
+// スナップショットから引ける設定を並べる（TOMLから作ったものと比べる）
+std::string describe(const ConfigSnapshot& snapshot) {
+  const char* keys[] = {"keepalive_timeout", "root", "worker_threads"};
+  const char* hosts[] = {"localhost", "a.example.com", "b.a.example.com",
+                         "unknown"};
+  const char* urls[] = {"/", "/img/a.png", "/img", "/exact", "/exact/x"};
+  const char* methods[] = {"GET", "DELETE", "BREW"};
+  std::ostringstream oss;
+
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+    oss << keys[i] << "=" << snapshot.getValue(keys[i]) << "\n";
+  }
+  for (size_t i = 0; i < snapshot.getPorts().size(); ++i) {
+    oss << "port " << snapshot.getPorts()[i] << "\n";
+  }
+
+  const RouteTable& routes = snapshot.getRouteTable();
+  oss << routes.size() << " servers\n";
+  const RouteTable::Listener* listener = routes.findListener(8080);
+  if (listener == NULL) {
+    return oss.str();
+  }
+  for (size_t h = 0; h < sizeof(hosts) / sizeof(hosts[0]); ++h) {
+    const RouteTable::VirtualServer* server =
+        routes.findServer(*listener, hosts[h]);
+    if (server == NULL) {
+      oss << hosts[h] << " -> none\n";
+      continue;
+    }
+    const std::string* errorPage = server->findErrorPage(404);
+    const std::string* mimeType = server->findMimeType(".css");
+    oss << hosts[h] << " -> " << server->name << " " << server->root << " "
+        << server->maxBodySize << " " << (errorPage ? *errorPage : "-")
+        << " " << (mimeType ? *mimeType : "-") << "\n";
+    for (size_t u = 0; u < sizeof(urls) / sizeof(urls[0]); ++u) {
+      const RouteTable::Location* location = server->findLocation(urls[u]);
+      const RouteTable::Route& route =
+          location != NULL ? location->route : server->route;
+      oss << "  " << urls[u] << " " << (location ? location->path : "-")
+          << " " << route.root << " " << route.index << " "
+          << route.autoindex << " " << route.redirect;
+      for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); ++m) {
+        oss << " " << route.denies(methods[m]);
+      }
+      oss << "\n";
+    }
+  }
+  return oss.str();
+}
+}  // namespace
+
+// キャッシュから復元したスナップショットでも，TOMLと同じ設定を引ける
+TEST_F(ConfigCacheTest, RoundTrip) {
+  writeFile(filename,
+            "keepalive_timeout = 5\n"
+            "[localhost]\n"
+            "listen = [8080, 8081]\n"
+            "root = \"docs\"\n"
+            "client_max_body_size = \"2K\"\n"
+            "[localhost.error_page]\n"
+            "404 = \"/404.html\"\n"
+            "[localhost.location.\"/img/\"]\n"
+            "index = \"\"\n"
+            "autoindex = on\n"
+            "deny = [\"DELETE\", \"BREW\"]\n"
+            "[localhost.location.\"/img\"]\n"
+            "return = \"/img/\"\n"
+            "[localhost.location.\"= /exact\"]\n"
+            "root = \"exact\"\n"
+            "[\"*.example.com\"]\n"
+            "listen = [8080]\n"
+            "root = \"wildcard\"\n"
+            "[\"*.a.example.com\"]\n"
+            "listen = [8080]\n"
+            "root = \"longer\"\n");
+  ConfigSnapshot* parsed = ConfigSnapshot::load(filename);
+  ASSERT_NE(parsed, nullptr);
+  ASSERT_TRUE(ConfigCache::compile(filename));
+
+  ConfigSnapshot* cached = ConfigCache::load(filename);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(cached->getPath(), filename);
+  EXPECT_EQ(describe(*cached), describe(*parsed));
+  EXPECT_EQ(cached->getValue("keepalive_timeout"), "5");
+  EXPECT_EQ(cached->getRouteTable().size(), parsed->getRouteTable().size());
+  EXPECT_NE(cached->getRouteTable().findServer("LOCALHOST"), nullptr);
+  cached->release();
+  parsed->release();
+}
+
+// 新しいキャッシュがあれば，ConfigSnapshotは設定ファイルの代わりにそれを使う
+TEST_F(ConfigCacheTest, SnapshotUsesFreshCache) {
+  writeFile(filename, "[localhost]\nlisten = [8080]\nroot = \"docs\"\n");
+  ASSERT_TRUE(ConfigCache::compile(filename));
+
+  // キャッシュの中身だけを書き換える（設定ファイルはそのまま）
+  const std::string cachePath = ConfigCache::cachePath(filename);
+  std::string content;
+  {
+    std::ifstream file(cachePath.c_str(), std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  }
+  for (size_t pos = content.find("docs"); pos != std::string::npos;
+       pos = content.find("docs", pos)) {
+    content.replace(pos, 4, "DOCS");
+  }
+  writeFile(cachePath, content);
+
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+  const RouteTable::VirtualServer* server =
+      snapshot->getRouteTable().findServer("localhost");
+  ASSERT_NE(server, nullptr);
+  EXPECT_EQ(server->root, "DOCS");
+  EXPECT_EQ(snapshot->getValue("root"), "DOCS");
+  ASSERT_EQ(snapshot->getPorts().size(), 1u);
+  EXPECT_EQ(snapshot->getPorts()[0], 8080);
+  snapshot->release();
+}
+
+// 設定ファイルが変わったらキャッシュは使わず，TOMLを読み直す
+TEST_F(ConfigCacheTest, StaleCacheIsIgnored) {
+  writeFile(filename, "[localhost]\nlisten = [8080]\n");
+  touch(filename, 1000000000);
+  ASSERT_TRUE(ConfigCache::compile(filename));
+  ConfigSnapshot* cached = ConfigCache::load(filename);
+  ASSERT_NE(cached, nullptr);
+  cached->release();
+
+  writeFile(filename, "[webserv]\nlisten = [8081]\n");
+  touch(filename, 1000000001);
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_NE(snapshot->getRouteTable().findServer("webserv"), nullptr);
+  EXPECT_EQ(snapshot->getRouteTable().findServer("localhost"), nullptr);
+  snapshot->release();
+}
+
+// 同じ秒のうちに同じ大きさで書き換えても，古いキャッシュは使わない
+TEST_F(ConfigCacheTest, SameSizeRewriteInSameSecondIsDetected) {
+  writeFile(filename, "[localhost]\nlisten = [8080]\n");
+  touch(filename, 1000000000);
+  ASSERT_TRUE(ConfigCache::compile(filename));
+
+  writeFile(filename, "[localhost]\nlisten = [8081]\n");
+  touch(filename, 1000000000);
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+  std::vector<int> ports = snapshot->getPorts();
+  ASSERT_EQ(ports.size(), 1u);
+  EXPECT_EQ(ports[0], 8081);
+  snapshot->release();
+}
+
+// 壊れた・途中で切れたキャッシュは使わない
+TEST_F(ConfigCacheTest, CorruptCacheIsIgnored) {
+  writeFile(filename, "[localhost]\nlisten = [8080]\nroot = \"docs\"\n");
+  const std::string cachePath = ConfigCache::cachePath(filename);
+
+  // キャッシュがない場合
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  writeFile(cachePath, "not a cache");
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  ASSERT_TRUE(ConfigCache::compile(filename));
+  std::string content;
+  {
+    std::ifstream file(cachePath.c_str(), std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  }
+  writeFile(cachePath, content.substr(0, content.size() - 3));
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  // バージョンが違う場合
+  content[8] = static_cast<char>(CONFIG_CACHE_VERSION + 1);
+  writeFile(cachePath, content);
+  EXPECT_EQ(ConfigCache::load(filename), nullptr);
+
+  // 壊れたキャッシュがあっても設定ファイルから読み込める
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_NE(snapshot->getRouteTable().findServer("localhost"), nullptr);
+  snapshot->release();
+}
+
+// 設定ファイルがパースできなければキャッシュを作らない
+TEST_F(ConfigCacheTest, CompileFailsOnInvalidConfig) {
+  writeFile(filename, "[localhost\n");
+  EXPECT_FALSE(ConfigCache::compile(filename));
+  std::ifstream cache(ConfigCache::cachePath(filename).c_str());
+  EXPECT_FALSE(cache.good());
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ConfigSnapshot.hpp"
+
+class ConfigSnapshotTest : public ::testing::Test {
+ protected:
+  const std::string filename = "temp_config_snapshot_test.conf";
+
+  virtual void TearDown() { std::remove(filename.c_str()); }
+
+  void createConfFile(const std::string& content) {
+    std::ofstream file(filename.c_str());
+    file << content;
+  }
+};
+
+// 設定ファイルを読み込み，トップレベルの値とルーティング表を参照できる
+TEST_F(ConfigSnapshotTest, Load) {
+  createConfFile(
+      "event_backend = \"poll\"\n"
+      "[localhost]\n"
+      "listen = [8080]\n"
+      "root = \"docs\"\n");
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+
+  EXPECT_EQ(snapshot->getPath(), filename);
+  EXPECT_EQ(snapshot->getValue("event_backend"), "poll");
+  EXPECT_EQ(snapshot->getValue("worker_threads"), "");
+  const RouteTable::VirtualServer* host =
+      snapshot->getRouteTable().findServer("localhost");
+  ASSERT_NE(host, nullptr);
+  EXPECT_EQ(host->root, "docs");
+
+  snapshot->release();
+}
+
+// 全ホストのポートを重複なく昇順に並べる
+TEST_F(ConfigSnapshotTest, PortsAreUniqueAndSorted) {
+  createConfFile(
+      "[localhost]\n"
+      "listen = [8081, 8080]\n"
+      "[example.com]\n"
+      "listen = [8080, 9000]\n");
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+
+  std::vector<int> expected = {8080, 8081, 9000};
+  EXPECT_EQ(snapshot->getPorts(), expected);
+
+  snapshot->release();
+}
+
+// 存在しないファイルは読み込めない
+TEST_F(ConfigSnapshotTest, LoadMissingFile) {
+  EXPECT_EQ(ConfigSnapshot::load("no_such_file.conf"), nullptr);
+}
+
+// 読み込んだ後にファイルが変わっても，スナップショットの内容は変わらない
+TEST_F(ConfigSnapshotTest, SnapshotIsImmutable) {
+  createConfFile("[localhost]\nroot = \"before\"\n");
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+
+  createConfFile("[localhost]\nroot = \"after\"\n");
+  EXPECT_EQ(snapshot->getValue("root"), "before");
+
+  snapshot->release();
+}
+
+// 参照が残っている間は解放されない
+TEST_F(ConfigSnapshotTest, RetainAndRelease) {
+  createConfFile("[localhost]\nroot = \"docs\"\n");
+  ConfigSnapshot* snapshot = ConfigSnapshot::load(filename);
+  ASSERT_NE(snapshot, nullptr);
+
+  snapshot->retain();
+  snapshot->release();
+  EXPECT_EQ(snapshot->getValue("root"), "docs");
+  snapshot->release();
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "ConfigStore.hpp"
+
+class ConfigStoreTest : public ::testing::Test {
+ protected:
+  const std::string filename = "temp_config_store_test.conf";
+
+  virtual void TearDown() { std::remove(filename.c_str()); }
+
+  void createConfFile(const std::string& content) {
+    std::ofstream file(filename.c_str());
+    file << content;
+  }
+};
+
+// 読み直すと新しい設定に差し替わり，世代が進む
+TEST_F(ConfigStoreTest, ReloadSwapsSnapshot) {
+  createConfFile("[localhost]\nroot = \"before\"\n");
+  ConfigStore store(ConfigSnapshot::load(filename));
+  unsigned long generation = 1;
+  ConfigSnapshot* before = store.acquire(&generation);
+  ASSERT_NE(before, nullptr);
+  EXPECT_EQ(generation, 0u);
+
+  createConfFile("[localhost]\nroot = \"after\"\n");
+  EXPECT_TRUE(store.reload());
+  EXPECT_EQ(store.getGeneration(), 1u);
+
+  ConfigSnapshot* after = store.acquire(&generation);
+  ASSERT_NE(after, nullptr);
+  EXPECT_EQ(generation, 1u);
+  EXPECT_EQ(after->getValue("root"), "after");
+  // 取得済みの古い設定は，手放すまで使える
+  EXPECT_EQ(before->getValue("root"), "before");
+
+  before->release();
+  after->release();
+}
+
+// パースに失敗した場合は現在の設定のまま
+TEST_F(ConfigStoreTest, ReloadFailureKeepsCurrent) {
+  createConfFile("[localhost]\nroot = \"docs\"\n");
+  ConfigStore store(ConfigSnapshot::load(filename));
+  std::remove(filename.c_str());
+
+  EXPECT_FALSE(store.reload());
+  EXPECT_EQ(store.getGeneration(), 0u);
+  ConfigSnapshot* snapshot = store.acquire();
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(snapshot->getValue("root"), "docs");
+  snapshot->release();
+}
@@ -0,0 +1,179 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Connection.hpp"
+
+class ConnectionTest : public ::testing::Test {
+ protected:
+  int fds[2];
+
+  void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    // サーバー側はノンブロッキングにしておく
+    ASSERT_NE(fcntl(fds[0], F_SETFL, O_NONBLOCK), -1);
+  }
+
+  void TearDown() override {
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  void sendFromClient(const std::string& data) {
+    ASSERT_EQ(send(fds[1], data.c_str(), data.size(), 0),
+              static_cast<ssize_t>(data.size()));
+  }
+};
+
+// コンストラクタの初期状態
+TEST_F(ConnectionTest, InitialState) {
+  Connection connection(fds[0], 8080);
+
+  EXPECT_EQ(connection.getFd(), fds[0]);
+  EXPECT_EQ(connection.getPort(), 8080);
+  EXPECT_EQ(connection.getPhase(), Connection::READING);
+  EXPECT_FALSE(connection.isRequestComplete());
+  EXPECT_FALSE(connection.hasPendingWrite());
+}
+
+// リクエストが分割されて届いても，揃うまでは完了とならない
+TEST_F(ConnectionTest, ReadsRequestIncrementally) {
+  Connection connection(fds[0], 8080);
+
+  sendFromClient("GET / HTTP/1.1\r\nHo");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_FALSE(connection.isRequestComplete());
+
+  sendFromClient("st: localhost:8080\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_TRUE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getParser().getURL(), "/");
+}
+
+// ボディも分割して受信できる
+TEST_F(ConnectionTest, ReadsBodyIncrementally) {
+  Connection connection(fds[0], 8080);
+
+  sendFromClient(
+      "POST /upload HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Content-Length: 10\r\n\r\n01234");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_FALSE(connection.isRequestComplete());
+
+  sendFromClient("56789");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_TRUE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getParser().getBody(), "0123456789");
+}
+
+// 不正なリクエストはエラーとして完了扱いになる
+TEST_F(ConnectionTest, ParseErrorCompletesRequest) {
+  Connection connection(fds[0], 8080);
+
+  sendFromClient("G\x01T / HTTP/1.1\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_TRUE(connection.isRequestComplete());
+  EXPECT_TRUE(connection.getParser().hasError());
+}
+
+// 相手が切断した場合はfalseを返す
+TEST_F(ConnectionTest, ReadReturnsFalseOnDisconnect) {
+  Connection connection(fds[0], 8080);
+
+  close(fds[1]);
+  fds[1] = -1;
+  EXPECT_FALSE(connection.readFromSocket());
+}
+
+// 届いているデータがない（EAGAIN）だけでは接続を閉じない
+TEST_F(ConnectionTest, ReadKeepsConnectionOnWouldBlock) {
+  Connection connection(fds[0], 8080);
+
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_FALSE(connection.isRequestComplete());
+
+  sendFromClient("GET / HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  EXPECT_TRUE(connection.isRequestComplete());
+}
+
+// 送信キューに積んだデータがソケットへ送られる
+TEST_F(ConnectionTest, WritesQueuedResponse) {
+  Connection connection(fds[0], 8080);
+
+  connection.queueResponse("HTTP/1.1 200 OK\r\n\r\n");
+  EXPECT_TRUE(connection.hasPendingWrite());
+  EXPECT_TRUE(connection.writeToSocket());
+  EXPECT_FALSE(connection.hasPendingWrite());
+
+  char buffer[64] = {0};
+  ssize_t received = recv(fds[1], buffer, sizeof(buffer), 0);
+  EXPECT_EQ(std::string(buffer, received), "HTTP/1.1 200 OK\r\n\r\n");
+}
+
+// 送信バッファが一杯（EAGAIN）なら，残りを送信キューに残したままtrueを返す
+TEST_F(ConnectionTest, WriteKeepsPendingDataOnWouldBlock) {
+  Connection connection(fds[0], 8080);
+
+  // 相手が読まないので，いずれ送信バッファが一杯になる
+  connection.queueResponse(std::string(8 * 1024 * 1024, 'x'));
+  for (int i = 0; i < 64 && connection.hasPendingWrite(); ++i) {
+    EXPECT_TRUE(connection.writeToSocket());
+  }
+  EXPECT_TRUE(connection.hasPendingWrite());
+  EXPECT_TRUE(connection.writeToSocket());
+  EXPECT_TRUE(connection.hasPendingWrite());
+}
+
+// 送信エラーの場合はfalseを返す
+TEST_F(ConnectionTest, WriteReturnsFalseOnError) {
+  Connection connection(-1, 8080);
+
+  testing::internal::CaptureStderr();
+  connection.queueResponse("HTTP/1.1 200 OK\r\n\r\n");
+  EXPECT_FALSE(connection.writeToSocket());
+  testing::internal::GetCapturedStderr();
+}
+
+// keep-aliveの接続は，次のリクエストを受け付けられる状態に戻せる
+TEST_F(ConnectionTest, ResetForNextRequest) {
+  Connection connection(fds[0], 8080);
+
+  sendFromClient("GET / HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  ASSERT_TRUE(connection.isRequestComplete());
+  connection.setKeepAlive(true);
+  connection.setPhase(Connection::WRITING);
+
+  connection.resetForNextRequest();
+  EXPECT_EQ(connection.getPhase(), Connection::READING);
+  EXPECT_FALSE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getRequestCount(), 1u);
+
+  sendFromClient("GET /index.html HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  ASSERT_TRUE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getParser().getURL(), "/index.html");
+}
+
+// 1回の受信で複数のリクエストが届いた場合，後続のリクエストも順に取り出せる
+TEST_F(ConnectionTest, PipelinedRequests) {
+  Connection connection(fds[0], 8080);
+
+  sendFromClient(
+      "GET /a HTTP/1.1\r\nHost: localhost:8080\r\n\r\n"
+      "GET /b HTTP/1.1\r\nHost: localhost:8080\r\n\r\n");
+  EXPECT_TRUE(connection.readFromSocket());
+  ASSERT_TRUE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getParser().getURL(), "/a");
+
+  connection.resetForNextRequest();
+  ASSERT_TRUE(connection.isRequestComplete());
+  EXPECT_EQ(connection.getParser().getURL(), "/b");
+
+  connection.resetForNextRequest();
+  EXPECT_FALSE(connection.isRequestComplete());
+}
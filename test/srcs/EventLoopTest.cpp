@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "EventLoop.hpp"
+
+// poll/epoll両方のバックエンドで同じテストを実行する
+class EventLoopTest : public ::testing::TestWithParam<std::string> {
+ protected:
+  EventLoop* eventLoop;
+  std::vector<int> fdToClose;
+
+  void SetUp() override {
+    eventLoop = EventLoop::create(GetParam());
+    ASSERT_NE(eventLoop, nullptr);
+  }
+
+  void TearDown() override {
+    delete eventLoop;
+    for (size_t i = 0; i < fdToClose.size(); ++i) {
+      close(fdToClose[i]);
+    }
+  }
+
+  void createSocketPair(int& fd1, int& fd2) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    fd1 = fds[0];
+    fd2 = fds[1];
+    fdToClose.push_back(fd1);
+    fdToClose.push_back(fd2);
+  }
+};
+
+// バックエンド名
+TEST_P(EventLoopTest, Name) { EXPECT_EQ(eventLoop->name(), GetParam()); }
+
+// 追加と削除で監視中のFDの数が変わる
+TEST_P(EventLoopTest, AddAndRemove) {
+  int a, b;
+  createSocketPair(a, b);
+
+  EXPECT_EQ(eventLoop->size(), 0);
+  EXPECT_TRUE(eventLoop->add(a, EventLoop::READ));
+  EXPECT_TRUE(eventLoop->add(b, EventLoop::READ));
+  EXPECT_EQ(eventLoop->size(), 2);
+
+  // 二重追加は失敗する
+  EXPECT_FALSE(eventLoop->add(a, EventLoop::READ));
+  EXPECT_EQ(eventLoop->size(), 2);
+
+  eventLoop->remove(a);
+  EXPECT_EQ(eventLoop->size(), 1);
+  // 未登録のFDの削除は何もしない
+  eventLoop->remove(a);
+  EXPECT_EQ(eventLoop->size(), 1);
+}
+
+// 無効なFDは追加できない
+TEST_P(EventLoopTest, AddInvalidFd) {
+  EXPECT_FALSE(eventLoop->add(-1, EventLoop::READ));
+  EXPECT_EQ(eventLoop->size(), 0);
+}
+
+// 準備ができたFDだけが返される
+TEST_P(EventLoopTest, WaitReturnsOnlyReadyFds) {
+  int a1, a2, b1, b2;
+  createSocketPair(a1, a2);
+  createSocketPair(b1, b2);
+  eventLoop->add(a1, EventLoop::READ);
+  eventLoop->add(b1, EventLoop::READ);
+
+  std::vector<EventLoop::Event> fired;
+  // 何も起きていなければタイムアウトする
+  EXPECT_EQ(eventLoop->wait(fired, 0), 0);
+  EXPECT_TRUE(fired.empty());
+
+  ASSERT_EQ(write(b2, "x", 1), 1);
+  ASSERT_EQ(eventLoop->wait(fired, 100), 1);
+  ASSERT_EQ(fired.size(), 1u);
+  EXPECT_EQ(fired[0].fd, b1);
+  EXPECT_TRUE(fired[0].events & EventLoop::READ);
+}
+
+// 監視するイベントを変更できる
+TEST_P(EventLoopTest, ModifyToWrite) {
+  int a, b;
+  createSocketPair(a, b);
+  eventLoop->add(a, EventLoop::READ);
+
+  std::vector<EventLoop::Event> fired;
+  EXPECT_EQ(eventLoop->wait(fired, 0), 0);
+
+  // 送信バッファに空きがあるので，すぐに書き込み可能になる
+  EXPECT_TRUE(eventLoop->modify(a, EventLoop::WRITE));
+  ASSERT_EQ(eventLoop->wait(fired, 100), 1);
+  EXPECT_EQ(fired[0].fd, a);
+  EXPECT_TRUE(fired[0].events & EventLoop::WRITE);
+
+  // 未登録のFDは変更できない
+  EXPECT_FALSE(eventLoop->modify(b, EventLoop::READ));
+}
+
+// 削除後に残ったFDのイベントも正しく返される
+TEST_P(EventLoopTest, RemoveKeepsOtherFds) {
+  int a1, a2, b1, b2, c1, c2;
+  createSocketPair(a1, a2);
+  createSocketPair(b1, b2);
+  createSocketPair(c1, c2);
+  eventLoop->add(a1, EventLoop::READ);
+  eventLoop->add(b1, EventLoop::READ);
+  eventLoop->add(c1, EventLoop::READ);
+
+  // 先頭のFDを削除しても，他のFDの監視は続く
+  eventLoop->remove(a1);
+  ASSERT_EQ(write(a2, "x", 1), 1);
+  ASSERT_EQ(write(c2, "x", 1), 1);
+
+  std::vector<EventLoop::Event> fired;
+  ASSERT_EQ(eventLoop->wait(fired, 100), 1);
+  EXPECT_EQ(fired[0].fd, c1);
+}
+
+// 相手が切断するとエラー（または読み込み可能）として通知される
+TEST_P(EventLoopTest, PeerCloseIsReported) {
+  int a, b;
+  createSocketPair(a, b);
+  eventLoop->add(a, EventLoop::READ);
+
+  close(b);
+  fdToClose.pop_back();
+
+  std::vector<EventLoop::Event> fired;
+  ASSERT_EQ(eventLoop->wait(fired, 100), 1);
+  EXPECT_EQ(fired[0].fd, a);
+  EXPECT_TRUE(fired[0].events & (EventLoop::READ | EventLoop::ERROR));
+}
+
+// 大きな番号のFDも監視でき，削除後に同じ番号を再び追加できる
+TEST_P(EventLoopTest, HighFdAndReuse) {
+  int a, b;
+  createSocketPair(a, b);
+  int high = dup2(a, 900);
+  ASSERT_EQ(high, 900);
+  fdToClose.push_back(high);
+
+  EXPECT_TRUE(eventLoop->add(high, EventLoop::READ));
+  ASSERT_EQ(write(b, "x", 1), 1);
+  std::vector<EventLoop::Event> fired;
+  ASSERT_EQ(eventLoop->wait(fired, 100), 1);
+  EXPECT_EQ(fired[0].fd, high);
+
+  eventLoop->remove(high);
+  EXPECT_EQ(eventLoop->size(), 0);
+  EXPECT_TRUE(eventLoop->add(high, EventLoop::READ));
+  EXPECT_EQ(eventLoop->size(), 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, EventLoopTest,
+                         ::testing::Values("poll", "epoll"));
+
+// 未対応のバックエンドはNULL
+TEST(EventLoopCreateTest, UnsupportedBackend) {
+  EXPECT_EQ(EventLoop::create("kqueue"), nullptr);
+}
+
+// 空文字列ならデフォルトのバックエンド
+TEST(EventLoopCreateTest, DefaultBackend) {
+  EventLoop* eventLoop = EventLoop::create("");
+  ASSERT_NE(eventLoop, nullptr);
+  EXPECT_STREQ(eventLoop->name(), DEFAULT_EVENT_BACKEND);
+  delete eventLoop;
+}
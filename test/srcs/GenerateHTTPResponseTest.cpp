@@ -104,6 +104,22 @@ TEST_F(GenerateHTTPResponseTest, GenerateHttpResponseHeaderTest) {
   EXPECT_TRUE(header.find("Connection: close") != std::string::npos);
 }
 
+// keep-aliveのリクエストにはConnection: keep-aliveを返す
+TEST_F(GenerateHTTPResponseTest, GenerateHttpResponseHeaderKeepAlive) {
+  HTTPRequest request = createTestRequest();
+  request.setKeepAlive(true);
+  Directive rootDirective;
+  GenerateHTTPResponse GenerateHTTPResponse(rootDirective, request);
+
+  HTTPResponse response;
+  response.setHttpStatusCode(404);
+  GenerateHTTPResponse.handleRequest(response);
+
+  std::string header = response.getHttpResponseHeader();
+  EXPECT_TRUE(header.find("Connection: keep-alive") != std::string::npos);
+  EXPECT_TRUE(header.find("Connection: close") == std::string::npos);
+}
+
 // デフォルトエラーページを使用するケースのテスト
 TEST_F(GenerateHTTPResponseTest, DefaultErrorPageTest) {
   HTTPRequest request = createTestRequest();
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "../../srcs/HTTPHeaders.hpp"
+
+// 見分けるヘッダーは大文字・小文字に関わらず番号になる
+TEST(HTTPHeadersTest, LookupKnownNames) {
+  EXPECT_EQ(HTTPHeaders::lookup("Host"), HTTPHeaders::HOST);
+  EXPECT_EQ(HTTPHeaders::lookup("content-length"),
+            HTTPHeaders::CONTENT_LENGTH);
+  EXPECT_EQ(HTTPHeaders::lookup("TRANSFER-ENCODING"),
+            HTTPHeaders::TRANSFER_ENCODING);
+  EXPECT_EQ(HTTPHeaders::lookup("If-Modified-Since"),
+            HTTPHeaders::IF_MODIFIED_SINCE);
+  EXPECT_EQ(HTTPHeaders::lookup("expect"), HTTPHeaders::EXPECT);
+  EXPECT_EQ(HTTPHeaders::lookup("X-Custom"), HTTPHeaders::UNKNOWN);
+  // 長さが同じでも名前が違えば見分けない
+  EXPECT_EQ(HTTPHeaders::lookup("Hose"), HTTPHeaders::UNKNOWN);
+  // 受信バッファの一部（長さで区切った名前）も引ける
+  EXPECT_EQ(HTTPHeaders::lookup("Host: x", 4), HTTPHeaders::HOST);
+}
+
+// 番号でも名前でも同じ値を引け，名前は大文字・小文字を区別しない
+TEST(HTTPHeadersTest, KnownAndOtherHeaders) {
+  HTTPHeaders headers;
+  headers.set("content-type", "text/plain");
+  headers.set("X-Request-Id", "42");
+
+  EXPECT_TRUE(headers.has(HTTPHeaders::CONTENT_TYPE));
+  EXPECT_EQ(headers.get(HTTPHeaders::CONTENT_TYPE), "text/plain");
+  EXPECT_EQ(*headers.find("Content-Type"), "text/plain");
+  EXPECT_EQ(*headers.find("x-request-id"), "42");
+
+  EXPECT_FALSE(headers.has(HTTPHeaders::HOST));
+  EXPECT_EQ(headers.get(HTTPHeaders::HOST), "");
+  EXPECT_EQ(headers.find("Host"), nullptr);
+  EXPECT_EQ(headers.find("X-Missing"), nullptr);
+}
+
+// 同じ名前のヘッダーは後のもので上書きし，受信した順を保つ
+TEST(HTTPHeadersTest, LaterValueWinsAndOrderIsKept) {
+  HTTPHeaders headers;
+  headers.set("X-Dup", "a");
+  headers.set("Host", "localhost:8001");
+  headers.set("x-dup", "b");
+  headers.set("HOST", "example.com:8001");
+
+  ASSERT_EQ(headers.size(), 2u);
+  EXPECT_EQ(headers[0].name, "X-Dup");
+  EXPECT_EQ(headers[0].value, "b");
+  EXPECT_EQ(headers[1].name, "Host");
+  EXPECT_EQ(headers[1].value, "example.com:8001");
+  EXPECT_EQ(headers.get(HTTPHeaders::HOST), "example.com:8001");
+
+  headers.clear();
+  EXPECT_TRUE(headers.empty());
+  EXPECT_FALSE(headers.has(HTTPHeaders::HOST));
+}
+
+// mapからも作れる
+TEST(HTTPHeadersTest, FromMap) {
+  std::map<std::string, std::string> map;
+  map["Connection"] = "close";
+  map["Accept"] = "*/*";
+  HTTPHeaders headers(map);
+
+  EXPECT_EQ(headers.size(), 2u);
+  EXPECT_EQ(headers.get(HTTPHeaders::CONNECTION), "close");
+  EXPECT_EQ(*headers.find("accept"), "*/*");
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../../srcs/HTTPRequestParser.hpp"
+#include "../../srcs/HTTPScanner.hpp"
+
+class HTTPScannerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { saved = HTTPScanner::level(); }
+  void TearDown() override { HTTPScanner::setLevel(saved); }
+
+  // このCPUで使える実装を順に試す
+  std::vector<HTTPScanner::Level> levels() {
+    std::vector<HTTPScanner::Level> result;
+    for (int level = HTTPScanner::SCALAR; level <= HTTPScanner::bestLevel();
+         ++level) {
+      result.push_back(static_cast<HTTPScanner::Level>(level));
+    }
+    return result;
+  }
+
+  HTTPScanner::Level saved;
+};
+
+// すべてのバイトについて，区切り文字・不正なバイトで止まる位置が同じ
+TEST_F(HTTPScannerTest, StopsAtEveryByteLikeScalar) {
+  std::vector<HTTPScanner::Level> all = levels();
+  for (int c = 0; c < 256; ++c) {
+    // 区切り文字の位置を変えて，SIMDのブロックの先頭・途中・端数を試す
+    for (size_t pos = 0; pos < 70; ++pos) {
+      std::string input(70, 'a');
+      input[pos] = static_cast<char>(c);
+      const char* begin = input.data();
+      const char* end = begin + input.size();
+
+      HTTPScanner::setLevel(HTTPScanner::SCALAR);
+      const char* token = HTTPScanner::skipToken(begin, end);
+      const char* uri = HTTPScanner::skipURI(begin, end);
+      const char* value = HTTPScanner::skipFieldValue(begin, end);
+      for (size_t i = 1; i < all.size(); ++i) {
+        ASSERT_TRUE(HTTPScanner::setLevel(all[i]));
+        EXPECT_EQ(HTTPScanner::skipToken(begin, end), token) << c << " " << pos;
+        EXPECT_EQ(HTTPScanner::skipURI(begin, end), uri) << c << " " << pos;
+        EXPECT_EQ(HTTPScanner::skipFieldValue(begin, end), value)
+            << c << " " << pos;
+      }
+    }
+  }
+}
+
+// 止まる文字の種類
+TEST_F(HTTPScannerTest, ClassifiesDelimiters) {
+  for (HTTPScanner::Level level : levels()) {
+    HTTPScanner::setLevel(level);
+    std::string name = "X-Forwarded-For-Long-Header-Name-0123456789: value";
+    EXPECT_EQ(HTTPScanner::skipToken(name.data(), name.data() + name.size()),
+              name.data() + name.find(':'));
+
+    std::string uri = "/path/to/resource?query=1&emoji=\xF0\x9F\x98\x80 HTTP";
+    EXPECT_EQ(HTTPScanner::skipURI(uri.data(), uri.data() + uri.size()),
+              uri.data() + uri.find(' '));
+
+    std::string value = "a=1; b=2; c=\"quoted\"\ttab\r\n";
+    EXPECT_EQ(HTTPScanner::skipFieldValue(value.data(),
+                                          value.data() + value.size()),
+              value.data() + value.find('\t'));
+
+    // 空の入力と，最後まで区切り文字がない入力
+    EXPECT_EQ(HTTPScanner::skipToken(name.data(), name.data()), name.data());
+    std::string plain(100, 'z');
+    EXPECT_EQ(HTTPScanner::skipFieldValue(plain.data(),
+                                          plain.data() + plain.size()),
+              plain.data() + plain.size());
+  }
+}
+
+// どの実装でもパーサーの結果は同じ
+TEST_F(HTTPScannerTest, ParserResultDoesNotDependOnLevel) {
+  std::string cookie;
+  for (int i = 0; i < 100; ++i) {
+    cookie += "session" + std::to_string(i) + "=0123456789abcdef; ";
+  }
+  std::string request = "GET /index.html?lang=ja HTTP/1.1\r\n"
+                        "Host: localhost\r\n"
+                        "Cookie: " + cookie + "\r\n\r\n";
+  std::string invalid = "GET / HTTP/1.1\r\nX-Long-Header-Name-With" +
+                        std::string("\x01", 1) + ": value\r\n\r\n";
+
+  for (HTTPScanner::Level level : levels()) {
+    HTTPScanner::setLevel(level);
+    HTTPRequestParser parser;
+    ASSERT_TRUE(parser.feed(request.data(), request.size()));
+    EXPECT_EQ(parser.getURL(), "/index.html?lang=ja");
+    EXPECT_EQ(parser.getHeader("Cookie"), cookie);
+
+    HTTPRequestParser invalidParser;
+    EXPECT_FALSE(invalidParser.feed(invalid.data(), invalid.size()));
+    EXPECT_TRUE(invalidParser.hasError());
+  }
+}
+
+// CPUが対応していない実装には切り替えない
+TEST_F(HTTPScannerTest, SetLevelRespectsCPU) {
+  EXPECT_TRUE(HTTPScanner::setLevel(HTTPScanner::SCALAR));
+  EXPECT_EQ(HTTPScanner::level(), HTTPScanner::SCALAR);
+  EXPECT_TRUE(HTTPScanner::setLevel(HTTPScanner::bestLevel()));
+  EXPECT_EQ(HTTPScanner::level(), HTTPScanner::bestLevel());
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "StringTable.hpp"
+
+// 名前は大文字・小文字を区別せずに引ける
+TEST(HostTableTest, FindIgnoresCase) {
+  HostTable table;
+  EXPECT_TRUE(table.insert("Example.com", 0));
+  EXPECT_TRUE(table.insert("localhost", 1));
+  EXPECT_EQ(table.size(), 2u);
+
+  EXPECT_EQ(table.find("example.com"), 0);
+  EXPECT_EQ(table.find("EXAMPLE.COM"), 0);
+  EXPECT_EQ(table.find("LocalHost"), 1);
+  EXPECT_EQ(table.find("example"), -1);
+  EXPECT_EQ(table.find(""), -1);
+}
+
+// 同じ名前は最初に追加した値が残る
+TEST(HostTableTest, FirstInsertWins) {
+  HostTable table;
+  EXPECT_TRUE(table.insert("localhost", 0));
+  EXPECT_FALSE(table.insert("LOCALHOST", 1));
+  EXPECT_EQ(table.size(), 1u);
+  EXPECT_EQ(table.find("localhost"), 0);
+}
+
+// 文字列の一部（Hostヘッダーのポートを除いた部分など）で引ける
+TEST(HostTableTest, FindBySubstring) {
+  HostTable table;
+  table.insert(".example.com", 3);
+  const char* host = "www.example.com:8080";
+  EXPECT_EQ(table.find(host + 3, 12), 3);
+  EXPECT_EQ(table.find(host + 3, 16), -1);
+}
+
+// 多数のホストを追加しても全て引ける
+TEST(HostTableTest, GrowsWithManyHosts) {
+  HostTable table;
+  for (int i = 0; i < 5000; ++i) {
+    std::ostringstream name;
+    name << "host" << i << ".example.com";
+    ASSERT_TRUE(table.insert(name.str(), i));
+  }
+  EXPECT_EQ(table.size(), 5000u);
+  for (int i = 0; i < 5000; ++i) {
+    std::ostringstream name;
+    name << "HOST" << i << ".example.com";
+    EXPECT_EQ(table.find(name.str()), i);
+  }
+  EXPECT_EQ(table.find("host5000.example.com"), -1);
+}
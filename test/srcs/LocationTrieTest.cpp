@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "LocationTrie.hpp"
+
+// 空のトライはどのURLにも一致しない
+TEST(LocationTrieTest, Empty) {
+  LocationTrie trie;
+  EXPECT_EQ(trie.size(), 0u);
+  EXPECT_EQ(trie.findLongestPrefix("/"), -1);
+  EXPECT_EQ(trie.findLongestPrefix(""), -1);
+}
+
+// 最も長く一致する接頭辞の値を返す
+TEST(LocationTrieTest, LongestPrefix) {
+  LocationTrie trie;
+  EXPECT_TRUE(trie.insert("/", 0));
+  EXPECT_TRUE(trie.insert("/docs/", 1));
+  EXPECT_TRUE(trie.insert("/docs/api/", 2));
+  EXPECT_EQ(trie.size(), 3u);
+
+  EXPECT_EQ(trie.findLongestPrefix("/"), 0);
+  EXPECT_EQ(trie.findLongestPrefix("/index.html"), 0);
+  EXPECT_EQ(trie.findLongestPrefix("/docs"), 0);
+  EXPECT_EQ(trie.findLongestPrefix("/docs/"), 1);
+  EXPECT_EQ(trie.findLongestPrefix("/docs/readme"), 1);
+  EXPECT_EQ(trie.findLongestPrefix("/docs/api/v1"), 2);
+  EXPECT_EQ(trie.findLongestPrefix("docs"), -1);
+}
+
+// 辺の途中で分かれる接頭辞を後から追加しても，既存の値は変わらない
+TEST(LocationTrieTest, SplitEdge) {
+  LocationTrie trie;
+  EXPECT_TRUE(trie.insert("/images/", 0));
+  EXPECT_TRUE(trie.insert("/img/", 1));
+  EXPECT_TRUE(trie.insert("/i", 2));
+
+  EXPECT_EQ(trie.findLongestPrefix("/images/a.png"), 0);
+  EXPECT_EQ(trie.findLongestPrefix("/img/a.png"), 1);
+  EXPECT_EQ(trie.findLongestPrefix("/index.html"), 2);
+  EXPECT_EQ(trie.findLongestPrefix("/imag"), 2);
+  EXPECT_EQ(trie.findLongestPrefix("/a"), -1);
+}
+
+// 同じ接頭辞は1度だけ登録され，最初の値が残る
+TEST(LocationTrieTest, DuplicateKeepsFirst) {
+  LocationTrie trie;
+  EXPECT_TRUE(trie.insert("/a/", 0));
+  EXPECT_FALSE(trie.insert("/a/", 1));
+  EXPECT_EQ(trie.size(), 1u);
+  EXPECT_EQ(trie.findLongestPrefix("/a/b"), 0);
+}
+
+// 先頭lengthバイトだけを照合する（クエリ文字列を除くため）
+TEST(LocationTrieTest, MatchesOnlyGivenLength) {
+  LocationTrie trie;
+  trie.insert("/search", 0);
+  trie.insert("/search?x", 1);
+  std::string url = "/search?x=1";
+  EXPECT_EQ(trie.findLongestPrefix(url), 1);
+  EXPECT_EQ(trie.findLongestPrefix(url, url.find('?')), 0);
+  EXPECT_EQ(trie.findLongestPrefix(url, 3), -1);
+}
+
+// 多数のlocationでも，それぞれ自分のパスに一致する
+TEST(LocationTrieTest, ManyLocations) {
+  LocationTrie trie;
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream path;
+    path << "/app/" << i << "/";
+    ASSERT_TRUE(trie.insert(path.str(), i));
+  }
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream url;
+    url << "/app/" << i << "/page.html";
+    EXPECT_EQ(trie.findLongestPrefix(url.str()), i);
+  }
+  EXPECT_EQ(trie.findLongestPrefix("/app/500/"), -1);
+}
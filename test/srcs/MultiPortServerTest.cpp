@@ -0,0 +1,86 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "MultiPortServer.hpp"
+
+// ポートを開くとサーバーFDとして登録され，閉じると登録が外れる
+TEST(MultiPortServerTest, OpenAndClosePort) {
+  MultiPortServer server;
+  int fdA = server.openPort(18081);
+  int fdB = server.openPort(18082);
+  ASSERT_GE(fdA, 0);
+  ASSERT_GE(fdB, 0);
+
+  EXPECT_TRUE(server.isServerFd(fdA));
+  EXPECT_EQ(server.getPortByFd(fdB), 18082);
+  EXPECT_EQ(server.getServerFds().size(), 2u);
+  std::vector<int> expected = {18081, 18082};
+  EXPECT_EQ(server.getPorts(), expected);
+  // ノンブロッキングかつclose-on-exec
+  EXPECT_TRUE(fcntl(fdA, F_GETFL) & O_NONBLOCK);
+  EXPECT_TRUE(fcntl(fdA, F_GETFD) & FD_CLOEXEC);
+
+  server.closePort(18081);
+  EXPECT_FALSE(server.isServerFd(fdA));
+  EXPECT_EQ(server.getPortByFd(fdB), 18082);
+  EXPECT_EQ(server.getServerFds().size(), 1u);
+  expected = {18082};
+  EXPECT_EQ(server.getPorts(), expected);
+
+  // 開いていないポートを閉じても何もしない
+  server.closePort(18081);
+  EXPECT_EQ(server.getServerFds().size(), 1u);
+}
+
+// 使用中のポートは開けないが，プロセスは終了しない
+TEST(MultiPortServerTest, OpenPortInUseFails) {
+  MultiPortServer first;
+  ASSERT_GE(first.openPort(18083), 0);
+
+  MultiPortServer second;
+  EXPECT_EQ(second.openPort(18083), -1);
+  EXPECT_TRUE(second.getServerFds().empty());
+  EXPECT_TRUE(second.getPorts().empty());
+}
+
+// closeSocketsで全てのポートを閉じる
+TEST(MultiPortServerTest, CloseSockets) {
+  MultiPortServer server;
+  int fd = server.openPort(18084);
+  ASSERT_GE(fd, 0);
+
+  server.closeSockets();
+  EXPECT_FALSE(server.isServerFd(fd));
+  EXPECT_TRUE(server.getServerFds().empty());
+  EXPECT_TRUE(server.getPorts().empty());
+}
+
+// 各リスナーにそのポートのホストの索引を付ける
+TEST(MultiPortServerTest, AttachRoutes) {
+  Directive rootDirective("root");
+  Directive host("localhost");
+  host.addKeyValue("listen", "18085");
+  rootDirective.addChild(host);
+  RouteTable routes(rootDirective);
+
+  MultiPortServer server;
+  int fdA = server.openPort(18085);
+  ASSERT_GE(fdA, 0);
+  EXPECT_EQ(server.getListenerByFd(fdA), nullptr);
+
+  server.attachRoutes(routes);
+  EXPECT_EQ(server.getRoutes(), &routes);
+  EXPECT_EQ(server.getListenerByFd(fdA), routes.findListener(18085));
+  ASSERT_NE(server.getListenerByFd(fdA), nullptr);
+
+  // 後から開いたポートにも付き，どのホストもリッスンしなければNULL
+  int fdB = server.openPort(18086);
+  ASSERT_GE(fdB, 0);
+  EXPECT_EQ(server.getListenerByFd(fdB), nullptr);
+  EXPECT_EQ(server.getListenerByFd(-1), nullptr);
+
+  server.closePort(18085);
+  EXPECT_EQ(server.getListenerByFd(fdA), nullptr);
+}
@@ -8,6 +8,7 @@
 
 #include "../../srcs/Directive.hpp"
 #include "../../srcs/HTTPRequest.hpp"
+#include "../../srcs/HTTPRequestParser.hpp"
 #include "../../srcs/HTTPResponse.hpp"
 #include "../../srcs/POST.hpp"
 
@@ -110,26 +111,6 @@ class POSTTest : public ::testing::Test {
 
     return HTTPRequest("POST", url, "HTTP/1.1", headers, body);
   }
-
-  // チャンクエンコードされたボディを生成
-  std::string createChunkedBody(const std::string& body) {
-    std::stringstream result;
-    size_t pos = 0;
-    const size_t chunkSize = 5;  // 小さいチャンクサイズでテスト
-
-    while (pos < body.length()) {
-      size_t size = std::min(chunkSize, body.length() - pos);
-      std::stringstream hexSize;
-      hexSize << std::hex << size;
-
-      result << hexSize.str() << "\r\n";
-      result << body.substr(pos, size) << "\r\n";
-      pos += size;
-    }
-
-    result << "0\r\n\r\n";  // 終端チャンク
-    return result.str();
-  }
 };
 
 // 1. 基本的なPOSTリクエストのテスト
@@ -155,10 +136,10 @@ TEST_F(POSTTest, ChunkedTransferEncoding) {
   // 設定
   Directive rootDirective =
       createTestDirective("localhost", "./test_tmp/webroot", "1M");
+  // チャンクはパーサーがデコードするので，ハンドラにデコード済みのボディが来る
   std::string originalBody = "This is a chunked test message";
-  std::string chunkedBody = createChunkedBody(originalBody);
 
-  HTTPRequest request = createPostRequest("/uploads/chunked.txt", chunkedBody,
+  HTTPRequest request = createPostRequest("/uploads/chunked.txt", originalBody,
                                           "text/plain", true);
   HTTPResponse response;
 
@@ -318,6 +299,44 @@ TEST_F(POSTTest, EmptyBody) {
   EXPECT_EQ(readFile("./test_tmp/webroot/uploads/empty.txt"), "");
 }
 
+// 11. 一時ファイルに溜めた大きなボディのPOSTテスト
+TEST_F(POSTTest, SpooledBodyIsStreamedToFile) {
+  // 設定
+  Directive rootDirective =
+      createTestDirective("localhost", "./test_tmp/webroot", "1M");
+  std::string body;
+  for (size_t i = 0; i < 200000; ++i) {
+    body += static_cast<char>('0' + i % 10);
+  }
+  std::string raw =
+      "POST /uploads/large.txt HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  for (size_t pos = 0; pos < body.size(); pos += 0x1000) {
+    size_t size = std::min<size_t>(0x1000, body.size() - pos);
+    std::stringstream chunk;
+    chunk << std::hex << size << "\r\n" << body.substr(pos, size) << "\r\n";
+    raw += chunk.str();
+  }
+  raw += "0\r\n\r\n";
+
+  HTTPRequestParser parser;
+  ASSERT_TRUE(parser.feed(raw.data(), raw.size()));
+  HTTPRequest request = parser.createRequest();
+  // ボディはHTTPRequestにコピーされず，パーサーの一時ファイルにある
+  EXPECT_TRUE(request.getBody().empty());
+  EXPECT_NE(request.getBodyFd(), -1);
+  EXPECT_EQ(request.getBodySize(), body.size());
+  HTTPResponse response;
+
+  // テスト対象の実行
+  POST postHandler(rootDirective, request);
+  postHandler.handleRequest(response);
+
+  // 検証
+  EXPECT_EQ(response.getHttpStatusCode(), 201);
+  EXPECT_EQ(readFile("./test_tmp/webroot/uploads/large.txt"), body);
+}
+
 // メインテスト実行関数
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "RequestContext.hpp"
+
+namespace {
+Directive createTestDirective() {
+  Directive rootDirective("root");
+  Directive host("localhost");
+  host.addKeyValue("root", "/var/www");
+  host.addKeyValue("index", "index.html");
+
+  Directive location("location");
+  Directive old("/old/");
+  old.addKeyValue("return", "/new/");
+  location.addChild(old);
+  Directive docs("/docs/");
+  docs.addKeyValue("index", "readme.html");
+  location.addChild(docs);
+  host.addChild(location);
+
+  rootDirective.addChild(host);
+  return rootDirective;
+}
+
+HTTPRequest createRequest(const std::string& url, const std::string& host) {
+  std::map<std::string, std::string> headers;
+  headers["Host"] = host;
+  return HTTPRequest("GET", url, "HTTP/1.1", headers, "");
+}
+}  // namespace
+
+// 借りたリクエストはコピーされず，URLの書き換えが呼び出し元にも見える
+TEST(RequestContextTest, BorrowsRouteTableAndRequest) {
+  RouteTable routes(createTestDirective());
+  HTTPRequest request = createRequest("/docs/a.html", "localhost");
+  RequestContext context(routes, request);
+
+  EXPECT_EQ(&context.getRoutes(), &routes);
+  EXPECT_EQ(&context.getRequest(), &request);
+  ASSERT_NE(context.getServer(), nullptr);
+  EXPECT_EQ(context.getServer()->root, "/var/www");
+
+  context.setURL("/other");
+  EXPECT_EQ(request.getURL(), "/other");
+}
+
+// locationはURLを書き換えると引き直される
+TEST(RequestContextTest, ResolvesLocationAgainAfterSetURL) {
+  RouteTable routes(createTestDirective());
+  HTTPRequest request = createRequest("/old/page.html", "localhost");
+  RequestContext context(routes, request);
+
+  const RouteTable::Route* route = context.getRoute();
+  ASSERT_NE(route, nullptr);
+  EXPECT_EQ(route->redirect, "/new/");
+
+  context.setURL("/docs/");
+  ASSERT_NE(context.getLocation(), nullptr);
+  EXPECT_EQ(context.getLocation()->path, "/docs/");
+  EXPECT_EQ(context.getRoute()->index, "readme.html");
+
+  // 一致するlocationがなければホスト直下の値
+  context.setURL("/top.html");
+  EXPECT_EQ(context.getLocation(), nullptr);
+  EXPECT_EQ(context.getRoute(), &context.getServer()->route);
+}
+
+// Directiveから作った文脈は，ルーティング表とリクエストを自分で持つ
+TEST(RequestContextTest, OwnsCopiesWhenBuiltFromDirective) {
+  HTTPRequest request = createRequest("/docs/", "localhost");
+  RequestContext context(createTestDirective(), request);
+
+  EXPECT_NE(&context.getRequest(), &request);
+  context.setURL("/changed");
+  EXPECT_EQ(request.getURL(), "/docs/");
+  ASSERT_NE(context.getServer(), nullptr);
+}
+
+// 未知のホストでは設定値がない
+TEST(RequestContextTest, UnknownHost) {
+  RouteTable routes(createTestDirective());
+  HTTPRequest request = createRequest("/", "unknown");
+  RequestContext context(routes, request);
+
+  EXPECT_EQ(context.getServer(), nullptr);
+  EXPECT_EQ(context.getLocation(), nullptr);
+  EXPECT_EQ(context.getRoute(), nullptr);
+}
+
+// リスナーの索引から選ぶと，未知のホストはそのポートのデフォルトになる
+TEST(RequestContextTest, SelectsServerByListener) {
+  Directive rootDirective = createTestDirective();
+  rootDirective.children()[0].addKeyValue("listen", "8080");
+  RouteTable routes(rootDirective);
+  HTTPRequest request = createRequest("/docs/", "unknown");
+
+  RequestContext context(routes, routes.findListener(8080), request);
+  ASSERT_NE(context.getServer(), nullptr);
+  EXPECT_EQ(context.getServer()->name, "localhost");
+  EXPECT_EQ(context.getRoute()->index, "readme.html");
+
+  // ポートをリッスンするホストがなければホストなし
+  RequestContext none(routes, NULL, request);
+  EXPECT_EQ(none.getServer(), nullptr);
+}
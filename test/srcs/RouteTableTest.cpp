@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ConfigSnapshot.hpp"
+#include "RouteTable.hpp"
+
+class RouteTableTest : public ::testing::Test {
+ protected:
+  const std::string filename = "temp_route_table_test.conf";
+  ConfigSnapshot* snapshot = nullptr;
+
+  virtual void TearDown() {
+    if (snapshot != nullptr) snapshot->release();
+    std::remove(filename.c_str());
+  }
+
+  // 設定ファイルを実際にパースしてルーティング表を作る
+  const RouteTable* load(const std::string& content) {
+    std::ofstream file(filename.c_str());
+    file << content;
+    file.close();
+    snapshot = ConfigSnapshot::load(filename);
+    return snapshot != nullptr ? &snapshot->getRouteTable() : nullptr;
+  }
+};
+
+// ホストごとの値が読み込み時に変換される
+TEST_F(RouteTableTest, CompilesVirtualServer) {
+  const RouteTable* routes = load(
+      "[localhost]\n"
+      "listen = [8080, 8081]\n"
+      "root = \"docs\"\n"
+      "client_max_body_size = \"2K\"\n"
+      "[localhost.error_page]\n"
+      "404 = \"/404.html\"\n"
+      "[webserv]\n"
+      "listen = [9000]\n");
+  ASSERT_NE(routes, nullptr);
+  EXPECT_EQ(routes->size(), 2u);
+
+  const RouteTable::VirtualServer* server = routes->findServer("localhost");
+  ASSERT_NE(server, nullptr);
+  EXPECT_EQ(server->root, "docs");
+  EXPECT_TRUE(server->listens("8081"));
+  EXPECT_FALSE(server->listens("9000"));
+  EXPECT_EQ(server->maxBodySize, 2048u);
+
+  ASSERT_NE(server->findErrorPage(404), nullptr);
+  EXPECT_EQ(*server->findErrorPage(404), "/404.html");
+  EXPECT_EQ(server->findErrorPage(500), nullptr);
+
+  // client_max_body_sizeがなければ1MB
+  const RouteTable::VirtualServer* other = routes->findServer("webserv");
+  ASSERT_NE(other, nullptr);
+  EXPECT_EQ(other->maxBodySize, (size_t)DEFAULT_CLIENT_MAX_BODY_SIZE);
+
+  EXPECT_EQ(routes->findServer("unknown"), nullptr);
+}
+
+// locationの値はlocation内を優先し，なければホスト直下の値で補う
+TEST_F(RouteTableTest, LocationFallsBackToServer) {
+  const RouteTable* routes = load(
+      "[localhost]\n"
+      "listen = [8080]\n"
+      "root = \".\"\n"
+      "index = \"index.html\"\n"
+      "autoindex = on\n"
+      "[localhost.location.\"= /\"]\n"
+      "return = \"/html\"\n"
+      "[localhost.location.\"/docs/\"]\n"
+      "index = \"readme.html\"\n"
+      "deny = [GET, DELETE, BREW]\n");
+  ASSERT_NE(routes, nullptr);
+  const RouteTable::VirtualServer* server = routes->findServer("localhost");
+  ASSERT_NE(server, nullptr);
+  EXPECT_EQ(server->route.index, "index.html");
+  EXPECT_TRUE(server->route.autoindex);
+  EXPECT_TRUE(server->route.redirect.empty());
+
+  const RouteTable::Location* root = server->findLocation("/");
+  ASSERT_NE(root, nullptr);
+  EXPECT_TRUE(root->exact);
+  EXPECT_EQ(root->route.redirect, "/html");
+  EXPECT_EQ(root->route.index, "index.html");
+  // locationのindexはホストの値で補わない
+  EXPECT_EQ(root->index, "");
+
+  const RouteTable::Location* docs = server->findLocation("/docs/");
+  ASSERT_NE(docs, nullptr);
+  EXPECT_EQ(docs->index, "readme.html");
+  EXPECT_EQ(docs->route.index, "readme.html");
+  EXPECT_EQ(docs->route.root, ".");
+  EXPECT_TRUE(docs->route.autoindex);
+  EXPECT_TRUE(docs->route.denies("GET"));
+  EXPECT_TRUE(docs->route.denies("DELETE"));
+  EXPECT_TRUE(docs->route.denies("BREW"));
+  EXPECT_FALSE(docs->route.denies("POST"));
+  EXPECT_FALSE(server->route.denies("GET"));
+
+  // "/docs/"で始まるURLが対象
+  EXPECT_EQ(server->findLocation("/docs/a/b.html"), docs);
+  EXPECT_EQ(server->findLocation("/docs"), nullptr);
+  // "= /"は"/"だけに一致する（クエリは除く）
+  EXPECT_EQ(server->findLocation("/?q=1"), root);
+  EXPECT_EQ(server->findLocation("/index.html"), nullptr);
+}
+
+// 最も長く一致するlocationが選ばれる
+TEST_F(RouteTableTest, LongestPrefixWins) {
+  const RouteTable* routes = load(
+      "[localhost]\n"
+      "listen = [8080]\n"
+      "[localhost.location.\"/\"]\n"
+      "index = \"root.html\"\n"
+      "[localhost.location.\"/img/\"]\n"
+      "index = \"img.html\"\n"
+      "[localhost.location.\"/img/icons/\"]\n"
+      "index = \"icons.html\"\n");
+  ASSERT_NE(routes, nullptr);
+  const RouteTable::VirtualServer* server = routes->findServer("localhost");
+  ASSERT_NE(server, nullptr);
+
+  EXPECT_EQ(server->findLocation("/")->index, "root.html");
+  EXPECT_EQ(server->findLocation("/about.html")->index, "root.html");
+  EXPECT_EQ(server->findLocation("/img/a.png")->index, "img.html");
+  EXPECT_EQ(server->findLocation("/img/icons/")->index, "icons.html");
+  EXPECT_EQ(server->findLocation("/img/icons")->index, "img.html");
+}
+
+// Content-Typeを持つ"*.<拡張子>"のlocationと，pathを持つlocationのlimit_except
+TEST_F(RouteTableTest, CompilesMimeTypesAndLimitExcept) {
+  Directive rootDirective("root");
+  Directive host("localhost");
+  Directive upload("location");
+  upload.addKeyValue("path", "/upload");
+  upload.addKeyValue("limit_except", "GET");
+  Directive nopath("location");
+  nopath.addKeyValue("limit_except", "GET");
+  host.addChild(nopath);
+  Directive css("*.css");
+  css.addKeyValue("Content-Type", "text/x-css;");
+  upload.addChild(css);
+  host.addChild(upload);
+  rootDirective.addChild(host);
+
+  RouteTable routes(rootDirective);
+  const RouteTable::VirtualServer* server = routes.findServer("localhost");
+  ASSERT_NE(server, nullptr);
+
+  // 末尾のセミコロンは除去される
+  ASSERT_NE(server->findMimeType(".css"), nullptr);
+  EXPECT_EQ(*server->findMimeType(".css"), "text/x-css");
+  EXPECT_EQ(server->findMimeType(".js"), nullptr);
+
+  // pathのないlocationは使われない
+  ASSERT_EQ(server->locations.size(), 1u);
+  const RouteTable::Location* location = server->findLocation("/upload/a");
+  ASSERT_NE(location, nullptr);
+  EXPECT_EQ(location->path, "/upload");
+  EXPECT_EQ(location->limitExcept, "GET");
+}
+
+namespace {
+Directive createHost(const std::string& name, const std::string& root,
+                     const std::vector<std::string>& ports) {
+  Directive host(name);
+  host.addKeyValue("root", root);
+  for (size_t i = 0; i < ports.size(); ++i) {
+    host.addKeyValue("listen", ports[i]);
+  }
+  return host;
+}
+}  // namespace
+
+// ポートごとに，完全一致・ワイルドカード（長いもの優先）・デフォルトの順に選ぶ
+TEST_F(RouteTableTest, FindsServerByListenerAndHost) {
+  Directive rootDirective("root");
+  rootDirective.addChild(createHost("default", "d", {"8080"}));
+  rootDirective.addChild(createHost("*.example.com", "w", {"8080"}));
+  rootDirective.addChild(createHost("*.api.example.com", "a", {"8080"}));
+  rootDirective.addChild(createHost("www.example.com", "x", {"8080", "8081"}));
+  rootDirective.addChild(createHost("other", "o", {"8081"}));
+  RouteTable routes(rootDirective);
+
+  const RouteTable::Listener* listener = routes.findListener(8080);
+  ASSERT_NE(listener, nullptr);
+  EXPECT_EQ(listener->port, 8080);
+  EXPECT_EQ(routes.findServer(*listener, "www.example.com")->root, "x");
+  // ホスト名は大文字・小文字を区別しない
+  EXPECT_EQ(routes.findServer(*listener, "WWW.Example.COM")->root, "x");
+  EXPECT_EQ(routes.findServer(*listener, "img.example.com")->root, "w");
+  EXPECT_EQ(routes.findServer(*listener, "v1.api.example.com")->root, "a");
+  EXPECT_EQ(routes.findServer(*listener, "a.v1.api.example.com")->root, "a");
+  // "*.example.com"は"example.com"自体には一致しない
+  EXPECT_EQ(routes.findServer(*listener, "example.com")->root, "d");
+  EXPECT_EQ(routes.findServer(*listener, "unknown")->root, "d");
+  EXPECT_EQ(routes.findServer(*listener, "")->root, "d");
+
+  // 他のポートのホストは選ばれず，そのポートで最初のホストがデフォルト
+  const RouteTable::Listener* other = routes.findListener(8081);
+  ASSERT_NE(other, nullptr);
+  EXPECT_EQ(routes.findServer(*other, "default")->root, "x");
+  EXPECT_EQ(routes.findServer(*other, "img.example.com")->root, "x");
+  EXPECT_EQ(routes.findServer(*other, "other")->root, "o");
+
+  EXPECT_EQ(routes.findListener(9000), nullptr);
+}
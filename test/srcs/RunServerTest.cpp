@@ -1,18 +1,24 @@
 #include <fcntl.h>  // fcntl用
 #include <gtest/gtest.h>
+#include <arpa/inet.h>
 #include <netinet/in.h>
 #include <signal.h>  // sigaction用
 #include <sys/socket.h>
 #include <unistd.h>  // pipe, alarm用
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <thread>  // std::thread用
 #include <vector>
 
 #include "HTTPResponse.hpp"
 #include "MultiPortServer.hpp"
+#include "PollEventLoop.hpp"
 #include "RunServer.hpp"
 #include "ServerData.hpp"
+#include "ServerSignal.hpp"
 
 // モック用のクラス定義
 class MockMultiPortServer : public MultiPortServer {
@@ -76,35 +82,44 @@ TEST_F(RunServerTest, Constructor) {
   // デフォルトコンフィグパスの確認
   EXPECT_EQ(server.getConfPath(), DEFAULT_CONF_PATH);
 
-  // 初期poll_fdsは空であることを確認
-  EXPECT_TRUE(server.get_poll_fds().empty());
+  // 初期状態では監視中のFDはないことを確認
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+  // Linuxではepollがデフォルト
+  EXPECT_STREQ(server.get_event_loop().name(), DEFAULT_EVENT_BACKEND);
 }
 
-// poll_fds操作のテスト
-TEST_F(RunServerTest, PollFdsManipulation) {
+// 監視FD操作のテスト
+TEST_F(RunServerTest, WatchFdsManipulation) {
   RunServer server;
 
-  // add_poll_fdのテスト
-  pollfd testFd;
-  testFd.fd = 10;
-  testFd.events = POLLIN;
-  testFd.revents = 0;
-  server.add_poll_fd(testFd);
-
-  // 追加されたことを確認
-  ASSERT_EQ(server.get_poll_fds().size(), 1);
-  EXPECT_EQ(server.get_poll_fds()[0].fd, 10);
-  EXPECT_EQ(server.get_poll_fds()[0].events, POLLIN);
-
-  // 複数のpoll_fdの追加
-  pollfd testFd2;
-  testFd2.fd = 20;
-  testFd2.events = POLLIN;
-  testFd2.revents = 0;
-  server.add_poll_fd(testFd2);
-
-  ASSERT_EQ(server.get_poll_fds().size(), 2);
-  EXPECT_EQ(server.get_poll_fds()[1].fd, 20);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  trackFd(fds[0]);
+  trackFd(fds[1]);
+
+  // add_watch_fdのテスト
+  server.add_watch_fd(fds[0]);
+  ASSERT_EQ(server.get_event_loop().size(), 1);
+
+  // 読み込み可能になったFDだけがイベントとして返る
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  ASSERT_EQ(server.get_event_loop().wait(server.get_fired_events(), 0), 1);
+  EXPECT_EQ(server.get_fired_events()[0].fd, fds[0]);
+  EXPECT_TRUE(server.get_fired_events()[0].events & EventLoop::READ);
+}
+
+// イベントループのバックエンド切り替えのテスト
+TEST_F(RunServerTest, SetEventBackend) {
+  RunServer server;
+
+  EXPECT_TRUE(server.set_event_backend("poll"));
+  EXPECT_STREQ(server.get_event_loop().name(), "poll");
+  EXPECT_TRUE(server.set_event_backend("epoll"));
+  EXPECT_STREQ(server.get_event_loop().name(), "epoll");
+
+  // 未対応のバックエンドの場合は元のまま
+  EXPECT_FALSE(server.set_event_backend("kqueue"));
+  EXPECT_STREQ(server.get_event_loop().name(), "epoll");
 }
 
 // コンフィグパス管理のテスト
@@ -154,18 +169,17 @@ TEST_F(RunServerTest, ConfigPathManagement) {
 class TestableRunServer : public RunServer {
  public:
   // 公開版のhandle_client_dataをオーバーライド - port引数を文字列型に変更
-  void handle_client_data_test(size_t index, const std::string& port) {
-    handle_client_data(index, port);
+  void handle_client_data_test(int fd, const std::string& port) {
+    handle_client_data(fd, port);
   }
 
+  // クライアントFDを監視対象に追加する
+  void addClientFd(int fd) { get_event_loop().add(fd, EventLoop::READ); }
+
   // プライベートメンバをテスト可能にするためのヘルパー
-  bool eraseClientFd(size_t index) {
-    if (index < get_poll_fds().size()) {
-      close(get_poll_fds()[index].fd);
-      get_poll_fds().erase(get_poll_fds().begin() + index);
-      return true;
-    }
-    return false;
+  void eraseClientFd(int fd) {
+    get_event_loop().remove(fd);
+    close(fd);
   }
 };
 
@@ -179,12 +193,8 @@ TEST_F(RunServerTest, HandleClientDataBasic) {
   trackFd(fds[0]);
   trackFd(fds[1]);
 
-  // クライアントソケットとして読み取り側をpoll_fdsに追加
-  pollfd clientPoll;
-  clientPoll.fd = fds[0];
-  clientPoll.events = POLLIN;
-  clientPoll.revents = 0;
-  server.add_poll_fd(clientPoll);
+  // クライアントソケットとして読み取り側を監視対象に追加
+  server.addClientFd(fds[0]);
 
   // データを書き込む
   const char* testData = "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n";
@@ -194,15 +204,15 @@ TEST_F(RunServerTest, HandleClientDataBasic) {
   testing::internal::CaptureStderr();
 
   // handle_client_dataを呼び出し
-  server.handle_client_data_test(0, "80");
+  server.handle_client_data_test(fds[0], "80");
 
   std::string errorOutput = testing::internal::GetCapturedStderr();
   // テスト環境ではHTTPパースが失敗する可能性があるため、エラーメッセージの有無は厳密にテストしない
 
-  // poll_fdsが正しく更新されたことを確認
-  // handle_client_dataは通常、処理後にFDを閉じてpoll_fdsから削除するため
-  // poll_fdsは空になっているはず
-  EXPECT_EQ(server.get_poll_fds().size(), 0);
+  // 監視対象が正しく更新されたことを確認
+  // handle_client_dataは通常、処理後にFDを閉じて監視対象から削除するため
+  // 監視中のFDはなくなっているはず
+  EXPECT_EQ(server.get_event_loop().size(), 0);
 }
 
 // handle_client_dataのエラー処理テスト
@@ -212,25 +222,21 @@ TEST_F(RunServerTest, HandleClientDataErrors) {
   // 無効なファイルディスクリプタを作成
   int invalidFd = -1;
 
-  // 無効なfdをpoll_fdsに追加
-  pollfd invalidPoll;
-  invalidPoll.fd = invalidFd;
-  invalidPoll.events = POLLIN;
-  invalidPoll.revents = 0;
-  server.add_poll_fd(invalidPoll);
+  // 無効なfdを監視対象に追加（追加自体が失敗する）
+  server.addClientFd(invalidFd);
 
   // 標準エラー出力をキャプチャ
   testing::internal::CaptureStderr();
 
   // handle_client_dataを呼び出し
-  server.handle_client_data_test(0, "80");
+  server.handle_client_data_test(invalidFd, "80");
 
   // recv関連のエラーメッセージを確認
   std::string errorOutput = testing::internal::GetCapturedStderr();
   EXPECT_NE(errorOutput.find("recv"), std::string::npos);
 
-  // クライアント切断/エラー時にpoll_fdsから削除されることを確認
-  EXPECT_EQ(server.get_poll_fds().size(), 0);
+  // クライアント切断/エラー時に監視対象から削除されることを確認
+  EXPECT_EQ(server.get_event_loop().size(), 0);
 }
 
 // bytes_read = 0 のケース (クライアント正常切断)
@@ -242,21 +248,727 @@ TEST_F(RunServerTest, HandleClientDataDisconnect) {
   ASSERT_EQ(pipe(fds), 0);
   trackFd(fds[0]);  // 読み取り側のみ追跡
 
-  // クライアントソケットとして読み取り側をpoll_fdsに追加
-  pollfd clientPoll;
-  clientPoll.fd = fds[0];
-  clientPoll.events = POLLIN;
-  clientPoll.revents = 0;
-  server.add_poll_fd(clientPoll);
+  // クライアントソケットとして読み取り側を監視対象に追加
+  server.addClientFd(fds[0]);
 
   // 書き込み側を閉じる (これにより読み取り時にEOFが返される)
   close(fds[1]);
 
   // handle_client_dataを呼び出し
-  server.handle_client_data_test(0, "80");
+  server.handle_client_data_test(fds[0], "80");
+
+  // クライアント切断時に監視対象から削除されることを確認
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+}
+
+// リクエストが揃っていない場合は，ブロックせずに接続を保持したまま戻る
+TEST_F(RunServerTest, HandleClientDataPartialRequest) {
+  TestableRunServer server;
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+
+  server.addClientFd(serverFd);
+
+  // ヘッダーの途中までしか送らない
+  const char* partial = "GET / HTTP/1.1\r\nHost: local";
+  ASSERT_GT(write(clientFd, partial, std::string(partial).size()), 0);
+
+  server.handle_client_data_test(serverFd, "80");
+
+  // 接続は閉じられず，続きの受信を待っている
+  EXPECT_EQ(server.get_event_loop().size(), 1);
+  server.eraseClientFd(serverFd);
+}
+
+// keep-aliveの接続は，レスポンスを送り終えても閉じずに次のリクエストを待つ
+TEST_F(RunServerTest, KeepAliveConnectionStaysOpen) {
+  system("mkdir -p /tmp/webserv_keepalive");
+  system("echo ok > /tmp/webserv_keepalive/index.html");
+  {
+    std::ofstream conf("/tmp/webserv_keepalive/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_keepalive\"\n"
+            "index = \"index.html\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_keepalive/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // HTTP/1.1はデフォルトでkeep-alive
+  std::string request = "GET / HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+  ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  std::string response(buffer, received);
+  EXPECT_NE(response.find("HTTP/1.1 200"), std::string::npos);
+  EXPECT_NE(response.find("Connection: keep-alive"), std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 1);
+
+  // Connection: closeが指定されたら，送り終えた時点で閉じる
+  request =
+      "GET / HTTP/1.1\r\nHost: localhost:8080\r\nConnection: close\r\n\r\n";
+  ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  response.assign(buffer, received);
+  EXPECT_NE(response.find("Connection: close"), std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_keepalive");
+}
+
+// 設定はパース済みのものを使い，リクエストごとにファイルを読み直さない
+TEST_F(RunServerTest, RequestsUseConfigSnapshot) {
+  system("mkdir -p /tmp/webserv_snapshot");
+  system("echo ok > /tmp/webserv_snapshot/index.html");
+  {
+    std::ofstream conf("/tmp/webserv_snapshot/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_snapshot\"\n"
+            "index = \"index.html\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_snapshot/webserv.conf");
+  ConfigSnapshot* snapshot =
+      ConfigSnapshot::load("/tmp/webserv_snapshot/webserv.conf");
+  ASSERT_NE(snapshot, nullptr);
+  server.set_config(snapshot);
+  snapshot->release();
+  EXPECT_EQ(server.get_config(), snapshot);
+
+  // 設定ファイルを壊しても，スナップショットの設定で応答する
+  system("echo broken > /tmp/webserv_snapshot/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  std::string request =
+      "GET / HTTP/1.1\r\nHost: localhost:8080\r\nConnection: close\r\n\r\n";
+  ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("HTTP/1.1 200"),
+            std::string::npos);
+
+  system("rm -rf /tmp/webserv_snapshot");
+}
+
+// パイプライン化されたリクエストには，リクエストの順にレスポンスを返す
+TEST_F(RunServerTest, PipelinedRequestsAreAnsweredInOrder) {
+  system("mkdir -p /tmp/webserv_pipeline");
+  system("echo first > /tmp/webserv_pipeline/first.html");
+  system("echo second > /tmp/webserv_pipeline/second.html");
+  {
+    std::ofstream conf("/tmp/webserv_pipeline/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_pipeline\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_pipeline/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // 2つ目のレスポンスを待たずに，3つのリクエストを続けて送る
+  std::string requests =
+      "GET /first.html HTTP/1.1\r\nHost: localhost:8080\r\n\r\n"
+      "GET /second.html HTTP/1.1\r\nHost: localhost:8080\r\n\r\n"
+      "GET /first.html HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Connection: close\r\n\r\n";
+  ASSERT_GT(write(clientFd, requests.c_str(), requests.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  char buffer[8192] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  std::string response(buffer, received);
+  size_t first = response.find("first\n");
+  size_t second = response.find("second\n");
+  size_t third = response.find("first\n", second);
+  ASSERT_NE(first, std::string::npos);
+  ASSERT_NE(second, std::string::npos);
+  ASSERT_NE(third, std::string::npos);
+  EXPECT_LT(first, second);
+
+  // 最後のリクエストはConnection: closeなので，送り終えたら閉じる
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_pipeline");
+}
+
+// チャンク転送のボディはパーサーが終わりを決め，揃うまでは応答しない
+TEST_F(RunServerTest, ChunkedBodyIsFramedByParser) {
+  system("mkdir -p /tmp/webserv_chunked");
+  {
+    std::ofstream conf("/tmp/webserv_chunked/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_chunked\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_chunked/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  ASSERT_NE(fcntl(clientFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // Content-Lengthのないチャンク転送は，終端のチャンクまで待つ
+  std::string head =
+      "POST /up.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "transfer-encoding: chunked\r\n\r\n5\r\nhello\r\n";
+  ASSERT_GT(write(clientFd, head.c_str(), head.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  char buffer[8192] = {0};
+  EXPECT_EQ(recv(clientFd, buffer, sizeof(buffer) - 1, 0), -1);
+
+  // 残りのチャンクと，続けて送った（小文字のcontent-lengthを持つ）リクエスト
+  std::string rest =
+      "6\r\n world\r\n0\r\n\r\n"
+      "POST /up2.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "content-length: 3\r\nConnection: close\r\n\r\nabc";
+  ASSERT_GT(write(clientFd, rest.c_str(), rest.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  std::string response(buffer, received);
+  size_t first = response.find("HTTP/1.1 201");
+  ASSERT_NE(first, std::string::npos);
+  EXPECT_NE(response.find("HTTP/1.1 201", first + 1), std::string::npos);
+
+  std::ifstream up("/tmp/webserv_chunked/up.txt");
+  std::string content((std::istreambuf_iterator<char>(up)),
+                      std::istreambuf_iterator<char>());
+  EXPECT_EQ(content, "hello world");
+  std::ifstream up2("/tmp/webserv_chunked/up2.txt");
+  std::string content2((std::istreambuf_iterator<char>(up2)),
+                       std::istreambuf_iterator<char>());
+  EXPECT_EQ(content2, "abc");
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_chunked");
+}
+
+// 解析できないリクエストには400を返して閉じる
+TEST_F(RunServerTest, MalformedRequestGets400) {
+  TestableRunServer server;
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // Content-LengthとTransfer-Encodingの両方があると，ボディの長さが曖昧になる
+  std::string request =
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 3\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n";
+  ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(serverFd, "80");
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("HTTP/1.1 400"),
+            std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+}
+
+// client_max_body_sizeを超えるボディは，受け取る前に413を返して閉じる
+TEST_F(RunServerTest, OversizedBodyGets413BeforeBody) {
+  system("mkdir -p /tmp/webserv_limit");
+  {
+    std::ofstream conf("/tmp/webserv_limit/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_limit\"\n"
+            "client_max_body_size = \"1K\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_limit/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // ヘッダーだけを送った時点で応答する
+  std::string head =
+      "POST /big.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Content-Length: 1073741824\r\n\r\n";
+  ASSERT_GT(write(clientFd, head.c_str(), head.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("HTTP/1.1 413"),
+            std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_limit");
+}
+
+// Expect: 100-continueには，ボディを受け取る前に100または413で応える
+TEST_F(RunServerTest, ExpectContinueGetsInterimResponse) {
+  system("mkdir -p /tmp/webserv_continue");
+  {
+    std::ofstream conf("/tmp/webserv_continue/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_continue\"\n"
+            "client_max_body_size = \"1K\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_continue/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  ASSERT_NE(fcntl(clientFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // 上限内なら100 Continueを返し，ボディを受け取ってから最終的な応答を返す
+  std::string head =
+      "POST /up.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Expect: 100-continue\r\nContent-Length: 5\r\n"
+      "Connection: close\r\n\r\n";
+  ASSERT_GT(write(clientFd, head.c_str(), head.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_EQ(std::string(buffer, received), "HTTP/1.1 100 Continue\r\n\r\n");
+
+  ASSERT_GT(write(clientFd, "hello", 5), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+  received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_EQ(std::string(buffer, received).find("HTTP/1.1 201"), 0u);
+
+  // 上限を超えていれば100 Continueは送らずに413を返す
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+  std::string big =
+      "POST /big.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Expect: 100-continue\r\nContent-Length: 2048\r\n\r\n";
+  ASSERT_GT(write(clientFd, big.c_str(), big.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+  received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_EQ(std::string(buffer, received).find("HTTP/1.1 413"), 0u);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_continue");
+}
+
+// パイプライン化された後続のリクエストにも，ボディの前に100 Continueを返す
+TEST_F(RunServerTest, PipelinedExpectContinueGetsInterimResponse) {
+  system("mkdir -p /tmp/webserv_continue_pipe");
+  system("echo first > /tmp/webserv_continue_pipe/first.html");
+  {
+    std::ofstream conf("/tmp/webserv_continue_pipe/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_continue_pipe\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_continue_pipe/webserv.conf");
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  ASSERT_NE(fcntl(clientFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  // GETに続けて，POSTはヘッダーだけを送り100 Continueを待つ
+  std::string requests =
+      "GET /first.html HTTP/1.1\r\nHost: localhost:8080\r\n\r\n"
+      "POST /up.txt HTTP/1.1\r\nHost: localhost:8080\r\n"
+      "Expect: 100-continue\r\nContent-Length: 5\r\n"
+      "Connection: close\r\n\r\n";
+  ASSERT_GT(write(clientFd, requests.c_str(), requests.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  // GETのレスポンスの後に100 Continueが届く
+  char buffer[8192] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  std::string response(buffer, received);
+  EXPECT_EQ(response.find("HTTP/1.1 200"), 0u);
+  size_t first = response.find("first\n");
+  size_t interim = response.find("HTTP/1.1 100 Continue\r\n\r\n");
+  ASSERT_NE(first, std::string::npos);
+  ASSERT_NE(interim, std::string::npos);
+  EXPECT_LT(first, interim);
+
+  // ボディを送るとPOSTの最終的な応答が返る
+  ASSERT_GT(write(clientFd, "hello", 5), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+  received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_EQ(std::string(buffer, received).find("HTTP/1.1 201"), 0u);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_continue_pipe");
+}
+
+// 上限を超えるURI・ヘッダーには414・431を返して閉じる
+TEST_F(RunServerTest, OversizedHeaderGets414Or431) {
+  const char* requests[] = {
+      "GET /aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "GET / HTTP/1.1\r\nHost: localhost\r\nCookie: "
+      "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc"
+      "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc",
+  };
+  const char* statuses[] = {"HTTP/1.1 414", "HTTP/1.1 431"};
+
+  for (size_t i = 0; i < 2; ++i) {
+    TestableRunServer server;
+    server.set_large_client_header_buffers(2, 64);
+
+    int serverFd, clientFd;
+    ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+    trackFd(clientFd);
+    ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+    server.addClientFd(serverFd);
+
+    std::string request = requests[i];
+    ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+    server.handle_client_data_test(serverFd, "80");
+    server.handle_client_write(serverFd);
+
+    char buffer[4096] = {0};
+    ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+    ASSERT_GT(received, 0) << i;
+    EXPECT_EQ(std::string(buffer, received).find(statuses[i]), 0u) << i;
+    EXPECT_EQ(server.get_event_loop().size(), 0) << i;
+  }
+}
+
+// リクエストヘッダーが期限内に揃わなければ408を返して閉じる
+TEST_F(RunServerTest, HeaderTimeoutSends408) {
+  TestableRunServer server;
+  server.set_client_header_timeout(1);
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  const char* partial = "GET / HTTP/1.1\r\nHost: local";
+  ASSERT_GT(write(clientFd, partial, std::string(partial).size()), 0);
+  server.handle_client_data_test(serverFd, "80");
+
+  // 期限前は何もしない
+  server.process_expired_timers();
+  EXPECT_EQ(server.get_event_loop().size(), 1);
+
+  usleep(1200 * 1000);
+  server.process_expired_timers();
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("HTTP/1.1 408"),
+            std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+}
+
+// keep-aliveで待機中の接続は，期限が切れたら何も送らずに閉じる
+TEST_F(RunServerTest, KeepAliveTimeoutClosesSilently) {
+  system("mkdir -p /tmp/webserv_timeout");
+  system("echo ok > /tmp/webserv_timeout/index.html");
+  {
+    std::ofstream conf("/tmp/webserv_timeout/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_timeout\"\n"
+            "index = \"index.html\"\n";
+  }
+  TestableRunServer server;
+  server.setConfPath("/tmp/webserv_timeout/webserv.conf");
+  server.set_keepalive_timeout(1);
+
+  int serverFd, clientFd;
+  ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+  trackFd(clientFd);
+  ASSERT_NE(fcntl(serverFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(serverFd);
+
+  std::string request = "GET / HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+  ASSERT_GT(write(clientFd, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(serverFd, "8080");
+  server.handle_client_write(serverFd);
+
+  char buffer[4096] = {0};
+  ASSERT_GT(recv(clientFd, buffer, sizeof(buffer) - 1, 0), 0);
+  EXPECT_EQ(server.get_event_loop().size(), 1);
+
+  usleep(1200 * 1000);
+  server.process_expired_timers();
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+  // 相手からは切断（EOF）として見える
+  EXPECT_EQ(recv(clientFd, buffer, sizeof(buffer) - 1, 0), 0);
+
+  system("rm -rf /tmp/webserv_timeout");
+}
+
+// SIGHUPで設定を読み直すと，リッスンするポートが新しいlistenに合わせて変わり，
+// 受け付け済みの接続は受け付けた時点の設定のまま処理される
+TEST_F(RunServerTest, ReloadConfigSwapsSnapshotAndListeners) {
+  system("mkdir -p /tmp/webserv_reload/old /tmp/webserv_reload/new");
+  system("echo old > /tmp/webserv_reload/old/index.html");
+  system("echo new > /tmp/webserv_reload/new/index.html");
+  const std::string confPath = "/tmp/webserv_reload/webserv.conf";
+  {
+    std::ofstream conf(confPath.c_str());
+    conf << "[localhost]\n"
+            "listen = [8080, 18091]\n"
+            "root = \"/tmp/webserv_reload/old\"\n"
+            "index = \"index.html\"\n";
+  }
+  ConfigStore store(ConfigSnapshot::load(confPath));
+  TestableRunServer server;
+  ASSERT_TRUE(server.set_event_backend("poll"));
+  server.set_config_store(&store);
+  MultiPortServer listeners;
+  ASSERT_GE(listeners.openPort(18091), 0);
+  server.add_watch_fd(listeners.getServerFds()[0]);
+
+  // 設定を読み直す前に，リクエストの途中まで届いている接続
+  int oldFd, oldClient;
+  ASSERT_TRUE(createSocketPair(oldFd, oldClient));
+  trackFd(oldClient);
+  ASSERT_NE(fcntl(oldFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(oldFd);
+  std::string request = "GET / HTTP/1.1\r\nHost: localhost:8080\r\n";
+  ASSERT_GT(write(oldClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(oldFd, "8080");
+
+  {
+    std::ofstream conf(confPath.c_str());
+    conf << "[localhost]\n"
+            "listen = [8080, 18092]\n"
+            "root = \"/tmp/webserv_reload/new\"\n"
+            "index = \"index.html\"\n";
+  }
+  // 要求がなければ読み直さない
+  EXPECT_FALSE(server.reload_config(listeners));
+  ServerSignal::requestReload();
+  EXPECT_TRUE(server.reload_config(listeners));
+  EXPECT_EQ(store.getGeneration(), 1u);
+
+  // 18091を閉じて18092を開く（8080は他のテストと衝突しないよう使わない）
+  std::vector<int> ports = listeners.getPorts();
+  EXPECT_EQ(std::count(ports.begin(), ports.end(), 18091), 0);
+  EXPECT_EQ(std::count(ports.begin(), ports.end(), 18092), 1);
+  // 監視しているのは，新しいリッスンソケットと受け付け済みの接続
+  EXPECT_EQ(server.get_event_loop().size(),
+            static_cast<int>(listeners.getServerFds().size()) + 1);
+
+  // 受け付け済みの接続は古い設定で応答する
+  request = "Connection: close\r\n\r\n";
+  ASSERT_GT(write(oldClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(oldFd, "8080");
+  server.handle_client_write(oldFd);
+  char buffer[4096] = {0};
+  ssize_t received = recv(oldClient, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("old"), std::string::npos);
+
+  // 新しい接続は新しい設定で応答する
+  int newFd, newClient;
+  ASSERT_TRUE(createSocketPair(newFd, newClient));
+  trackFd(newClient);
+  ASSERT_NE(fcntl(newFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(newFd);
+  request =
+      "GET / HTTP/1.1\r\nHost: localhost:8080\r\nConnection: close\r\n\r\n";
+  ASSERT_GT(write(newClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(newFd, "8080");
+  server.handle_client_write(newFd);
+  received = recv(newClient, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("new"), std::string::npos);
+
+  ServerSignal::clear();
+  system("rm -rf /tmp/webserv_reload");
+}
+
+// 停止を始めると，リッスンソケットとkeep-aliveで待機中の接続を閉じ，
+// 処理中の接続は応答を送り終えた時点で閉じる
+TEST_F(RunServerTest, BeginDrainStopsAcceptingAndClosesIdleConnections) {
+  system("mkdir -p /tmp/webserv_drain");
+  system("echo ok > /tmp/webserv_drain/index.html");
+  {
+    std::ofstream conf("/tmp/webserv_drain/webserv.conf");
+    conf << "[localhost]\n"
+            "listen = [8080]\n"
+            "root = \"/tmp/webserv_drain\"\n"
+            "index = \"index.html\"\n";
+  }
+  TestableRunServer server;
+  ASSERT_TRUE(server.set_event_backend("poll"));
+  server.setConfPath("/tmp/webserv_drain/webserv.conf");
+  MultiPortServer listeners;
+  ASSERT_GE(listeners.openPort(18093), 0);
+  server.add_watch_fd(listeners.getServerFds()[0]);
+
+  // keep-aliveで次のリクエストを待っている接続
+  int idleFd, idleClient;
+  ASSERT_TRUE(createSocketPair(idleFd, idleClient));
+  trackFd(idleClient);
+  ASSERT_NE(fcntl(idleFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(idleFd);
+  std::string request = "GET / HTTP/1.1\r\nHost: localhost:8080\r\n\r\n";
+  ASSERT_GT(write(idleClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(idleFd, "8080");
+  server.handle_client_write(idleFd);
+  char buffer[4096] = {0};
+  ASSERT_GT(recv(idleClient, buffer, sizeof(buffer) - 1, 0), 0);
+
+  // リクエストを受信している途中の接続
+  int busyFd, busyClient;
+  ASSERT_TRUE(createSocketPair(busyFd, busyClient));
+  trackFd(busyClient);
+  ASSERT_NE(fcntl(busyFd, F_SETFL, O_NONBLOCK), -1);
+  server.addClientFd(busyFd);
+  request = "GET / HTTP/1.1\r\nHost: localhost:8080\r\n";
+  ASSERT_GT(write(busyClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(busyFd, "8080");
+  EXPECT_EQ(server.get_event_loop().size(), 3);
+
+  server.begin_drain(listeners);
+  EXPECT_TRUE(server.is_draining());
+  EXPECT_TRUE(listeners.getServerFds().empty());
+  EXPECT_EQ(server.get_event_loop().size(), 1);
+  EXPECT_EQ(recv(idleClient, buffer, sizeof(buffer) - 1, 0), 0);
+
+  // keep-aliveを求められても，応答を送り終えたら閉じる
+  request = "\r\n";
+  ASSERT_GT(write(busyClient, request.c_str(), request.size()), 0);
+  server.handle_client_data_test(busyFd, "8080");
+  server.handle_client_write(busyFd);
+  ssize_t received = recv(busyClient, buffer, sizeof(buffer) - 1, 0);
+  ASSERT_GT(received, 0);
+  EXPECT_NE(std::string(buffer, received).find("Connection: close"),
+            std::string::npos);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
+
+  system("rm -rf /tmp/webserv_drain");
+}
+
+// 1回の通知でaccept待ちの接続をaccept_batch本までまとめて受け付ける
+TEST_F(RunServerTest, HandleNewConnectionAcceptsInBatches) {
+  // ノンブロッキングのリッスンソケット（ポートはOSに選ばせる）
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listenFd, 0);
+  trackFd(listenFd);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  ASSERT_EQ(bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+  ASSERT_EQ(listen(listenFd, 16), 0);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(getsockname(listenFd, (struct sockaddr*)&addr, &len), 0);
+  ASSERT_NE(fcntl(listenFd, F_SETFL, O_NONBLOCK), -1);
+
+  for (int i = 0; i < 5; ++i) {
+    int clientFd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(clientFd, 0);
+    trackFd(clientFd);
+    ASSERT_EQ(connect(clientFd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+  }
+
+  TestableRunServer server;
+  ASSERT_TRUE(server.set_event_backend("poll"));
+  server.set_accept_batch(3);
+
+  server.handle_new_connection(listenFd, 8080);
+  EXPECT_EQ(server.get_event_loop().size(), 3);
+  // 残りの2本を受け付けた後は，EAGAINで止まる
+  server.handle_new_connection(listenFd, 8080);
+  EXPECT_EQ(server.get_event_loop().size(), 5);
+  server.handle_new_connection(listenFd, 8080);
+  EXPECT_EQ(server.get_event_loop().size(), 5);
+
+  // 受け付けたソケットはノンブロッキングかつclose-on-exec
+  const std::vector<pollfd>& pollFds =
+      static_cast<PollEventLoop&>(server.get_event_loop()).get_poll_fds();
+  for (size_t i = 0; i < pollFds.size(); ++i) {
+    EXPECT_TRUE(fcntl(pollFds[i].fd, F_GETFL) & O_NONBLOCK);
+    EXPECT_TRUE(fcntl(pollFds[i].fd, F_GETFD) & FD_CLOEXEC);
+  }
+}
+
+// 1回のwaitで複数の接続が切断されても，どのイベントも読み飛ばさずに閉じる
+TEST_F(RunServerTest, ClosingConnectionsDoesNotSkipEvents) {
+  TestableRunServer server;
+  ASSERT_TRUE(server.set_event_backend("poll"));
+  MockMultiPortServer multiServer;
+
+  for (int i = 0; i < 3; ++i) {
+    int serverFd, clientFd;
+    ASSERT_TRUE(createSocketPair(serverFd, clientFd));
+    server.addClientFd(serverFd);
+    // 相手が切断すると，recvが0を返して接続が閉じられる
+    close(clientFd);
+  }
+  EXPECT_EQ(server.get_event_loop().size(), 3);
 
-  // クライアント切断時にpoll_fdsから削除されることを確認
-  EXPECT_EQ(server.get_poll_fds().size(), 0);
+  ASSERT_EQ(server.get_event_loop().wait(server.get_fired_events(), 100), 3);
+  server.process_poll_events_multiport(multiServer);
+  EXPECT_EQ(server.get_event_loop().size(), 0);
 }
 
 // int2str関数のテスト
@@ -39,6 +39,40 @@ TEST_F(ServerDataTest, SetServerFdCreatesValidSocket) {
   EXPECT_EQ(optval, SOCK_STREAM);
 }
 
+// ✅ reuse_portを有効にするとSO_REUSEPORTが設定される
+TEST_F(ServerDataTest, SetServerFdWithReusePort) {
+  EXPECT_FALSE(serverData->get_reuse_port());
+  serverData->set_reuse_port(true);
+  serverData->set_server_fd();
+  int fd = serverData->get_server_fd();
+  ASSERT_GT(fd, 0);
+
+  int optval = 0;
+  socklen_t optlen = sizeof(optval);
+  EXPECT_EQ(getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, &optlen), 0);
+  EXPECT_NE(optval, 0);
+}
+
+// ✅ SO_REUSEPORTを付けたソケット同士は同じポートにbindできる
+TEST(ServerDataReusePortTest, TwoListenersOnSamePort) {
+  ServerData first(8095);
+  ServerData second(8095);
+  first.set_reuse_port(true);
+  second.set_reuse_port(true);
+
+  first.set_address_data();
+  first.set_server_fd();
+  first.server_bind();
+  second.set_address_data();
+  second.set_server_fd();
+  // bindに失敗するとexitするため，ここまで到達すれば成功
+  second.server_bind();
+  SUCCEED();
+
+  close(first.get_server_fd());
+  close(second.get_server_fd());
+}
+
 // ✅ get_server_fd() の初期値テスト
 TEST_F(ServerDataTest, DefaultServerFdIsInvalid) {
   EXPECT_EQ(serverData->get_server_fd(), -1);
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <signal.h>
+
+#include "ServerSignal.hpp"
+
+class ServerSignalTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { ServerSignal::clear(); }
+
+  virtual void TearDown() {
+    ServerSignal::clear();
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGUSR2, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+  }
+};
+
+// SIGHUPで再読み込みが要求され，取り出すのは1度だけ
+TEST_F(ServerSignalTest, ReloadOnSighup) {
+  ServerSignal::handleReload();
+  EXPECT_FALSE(ServerSignal::takeReloadRequest());
+
+  raise(SIGHUP);
+  EXPECT_TRUE(ServerSignal::takeReloadRequest());
+  EXPECT_FALSE(ServerSignal::takeReloadRequest());
+}
+
+// SIGQUITでグレースフルな停止が要求される
+TEST_F(ServerSignalTest, ShutdownOnSigquit) {
+  ServerSignal::handleShutdown();
+  EXPECT_FALSE(ServerSignal::isShutdownRequested());
+
+  raise(SIGQUIT);
+  EXPECT_TRUE(ServerSignal::isShutdownRequested());
+  // 停止の要求は取り消されない
+  EXPECT_TRUE(ServerSignal::isShutdownRequested());
+}
+
+// SIGUSR2でバイナリの入れ替えが要求される
+TEST_F(ServerSignalTest, UpgradeOnSigusr2) {
+  ServerSignal::handleUpgrade();
+  raise(SIGUSR2);
+  EXPECT_TRUE(ServerSignal::takeUpgradeRequest());
+  EXPECT_FALSE(ServerSignal::takeUpgradeRequest());
+}
+
+// 無視するよう設定したSIGHUP・SIGUSR2では何も起きない
+TEST_F(ServerSignalTest, IgnoreReloadAndUpgrade) {
+  ServerSignal::ignoreReload();
+  ServerSignal::ignoreUpgrade();
+  raise(SIGHUP);
+  raise(SIGUSR2);
+  EXPECT_FALSE(ServerSignal::takeReloadRequest());
+  EXPECT_FALSE(ServerSignal::takeUpgradeRequest());
+}
+
+// SIGTERM・SIGINTで終了が要求される（マスターがワーカーを止めてから終了する）
+TEST_F(ServerSignalTest, TerminateOnSigtermAndSigint) {
+  ServerSignal::handleTerminate();
+  raise(SIGTERM);
+  EXPECT_TRUE(ServerSignal::isTerminateRequested());
+
+  ServerSignal::clear();
+  EXPECT_FALSE(ServerSignal::isTerminateRequested());
+  raise(SIGINT);
+  EXPECT_TRUE(ServerSignal::isTerminateRequested());
+}
+
+// 止めている間に届いたシグナルは，要求を確かめた後でもsigsuspendで受け取れる
+TEST_F(ServerSignalTest, BlockedSignalWakesSigsuspend) {
+  ServerSignal::handleReload();
+  ServerSignal::handleChildExit();
+  sigset_t masterSignals;
+  sigset_t waitMask;
+  ServerSignal::masterSignals(masterSignals);
+  sigprocmask(SIG_BLOCK, &masterSignals, &waitMask);
+
+  raise(SIGHUP);
+  // 止めている間はハンドラが動かない
+  EXPECT_FALSE(ServerSignal::isReloadRequested());
+  sigsuspend(&waitMask);
+  sigprocmask(SIG_SETMASK, &waitMask, NULL);
+
+  EXPECT_TRUE(ServerSignal::isReloadRequested());
+  EXPECT_TRUE(ServerSignal::takeReloadRequest());
+  EXPECT_FALSE(ServerSignal::isReloadRequested());
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "StringTable.hpp"
+
+// 大文字・小文字を区別して引ける
+TEST(StringTableTest, FindIsCaseSensitive) {
+  StringTable table;
+  EXPECT_TRUE(table.insert("http.server", 0));
+  EXPECT_TRUE(table.insert("HTTP.server", 1));
+  EXPECT_EQ(table.size(), 2u);
+
+  EXPECT_EQ(table.find("http.server"), 0);
+  EXPECT_EQ(table.find("HTTP.server"), 1);
+  EXPECT_EQ(table.find("Http.server"), -1);
+  EXPECT_EQ(table.find(""), -1);
+}
+
+// 同じ名前は最初に追加した値が残る．NULを含む名前も扱える
+TEST(StringTableTest, FirstInsertWinsAndBinaryNames) {
+  StringTable table;
+  std::string binary("a\0b", 3);
+  EXPECT_TRUE(table.insert(binary, 0));
+  EXPECT_FALSE(table.insert(binary, 1));
+  EXPECT_TRUE(table.insert("a", 2));
+  EXPECT_EQ(table.find(binary), 0);
+  EXPECT_EQ(table.find("a"), 2);
+  EXPECT_EQ(table.find("a\0c", 3), -1);
+}
+
+// 多数の名前を追加しても全て引け，clearで空になる
+TEST(StringTableTest, GrowsAndClears) {
+  StringTable table;
+  for (int i = 0; i < 10000; ++i) {
+    std::ostringstream name;
+    name << "section" << i;
+    ASSERT_TRUE(table.insert(name.str(), i));
+  }
+  EXPECT_EQ(table.size(), 10000u);
+  EXPECT_EQ(table.find("section9999"), 9999);
+  EXPECT_EQ(table.find("section10000"), -1);
+
+  table.clear();
+  EXPECT_EQ(table.size(), 0u);
+  EXPECT_EQ(table.find("section0"), -1);
+  EXPECT_TRUE(table.insert("section0", 5));
+  EXPECT_EQ(table.find("section0"), 5);
+}
@@ -310,3 +310,74 @@ TEST_F(TOMLParserTest, QuotedKeys) {
 
   delete directive;
 }
+
+// 空白の入れ方が違っても同じセクションは重複とみなす
+TEST_F(TOMLParserTest, DuplicateSectionWithSpaces) {
+  std::string content = "[http.server]\nport = 80\n[ http . server ]\nx = 1\n";
+  Directive* directive = parser->parseFromString(content);
+  EXPECT_EQ(directive, (Directive*)NULL);
+}
+
+// 引用符付きのキーと同じ名前の，引用符なしのキーは重複
+TEST_F(TOMLParserTest, DuplicateQuotedKey) {
+  std::string content = "[http]\n\"port\" = 80\nport = 8080\n";
+  Directive* directive = parser->parseFromString(content);
+  EXPECT_EQ(directive, (Directive*)NULL);
+}
+
+// 後から現れたサブセクションも，作成済みの親のディレクティブの下に入る
+TEST_F(TOMLParserTest, ReopensParentDirective) {
+  std::string content =
+      "[a]\nx = 1\n[b]\ny = 2\n[a.c]\nz = 3\n[b.\"d.e\"]\nw = 4\n";
+  Directive* directive = parser->parseFromString(content);
+
+  ASSERT_NE(directive, (Directive*)NULL);
+  ASSERT_EQ(directive->children().size(), 2u);
+  const Directive* c = directive->findDirective("a", "c");
+  ASSERT_NE(c, (const Directive*)NULL);
+  EXPECT_EQ(c->getValue("z"), "3");
+  const Directive* de = directive->findDirective("b", "d.e");
+  ASSERT_NE(de, (const Directive*)NULL);
+  EXPECT_EQ(de->getValue("w"), "4");
+
+  delete directive;
+}
+
+// 多数のセクションを持つ設定もパースできる
+TEST_F(TOMLParserTest, ManySections) {
+  std::ostringstream oss;
+  for (int i = 0; i < 20000; ++i) {
+    oss << "[host" << i << "]\nlisten = [" << i << "]\n"
+        << "[host" << i << ".location.\"/\"]\nindex = \"i" << i << "\"\n";
+  }
+  Directive* directive = parser->parseFromString(oss.str());
+
+  ASSERT_NE(directive, (Directive*)NULL);
+  ASSERT_EQ(directive->children().size(), 20000u);
+  EXPECT_EQ(directive->children()[19999].name(), "host19999");
+  const Directive* location =
+      directive->findDirective("host123", "location", "/");
+  ASSERT_NE(location, (const Directive*)NULL);
+  EXPECT_EQ(location->getValue("index"), "i123");
+
+  delete directive;
+}
+
+// 空のファイル，改行で終わらないファイル
+TEST_F(TOMLParserTest, ParseFromFileEdgeCases) {
+  const std::string filename = "temp_toml_edge_test.toml";
+
+  createTempFile(filename, "");
+  Directive* directive = parser->parseFromFile(filename);
+  ASSERT_NE(directive, (Directive*)NULL);
+  EXPECT_TRUE(directive->children().empty());
+  delete directive;
+
+  createTempFile(filename, "[http]\r\nport = 8080");
+  directive = parser->parseFromFile(filename);
+  ASSERT_NE(directive, (Directive*)NULL);
+  EXPECT_EQ(directive->getValue("port"), "8080");
+  delete directive;
+
+  removeTempFile(filename);
+}
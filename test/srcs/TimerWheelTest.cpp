@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "TimerWheel.hpp"
+
+// 時刻は実時間ではなく，テストから与えたミリ秒を使う
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  TimerWheel wheel;
+  std::vector<TimerWheel::Timer*> expired;
+
+  TimerWheelTest() : wheel(0) {}
+};
+
+// タイマーがなければwaitはタイムアウトしない
+TEST_F(TimerWheelTest, EmptyWheel) {
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_EQ(wheel.nextTimeout(0), -1);
+  wheel.advance(100000, expired);
+  EXPECT_TRUE(expired.empty());
+}
+
+// 期限が来るまでは切れず，来たら取り外される
+TEST_F(TimerWheelTest, ArmAndExpire) {
+  TimerWheel::Timer timer;
+  timer.fd = 5;
+  wheel.arm(timer, 1000, 0);
+  EXPECT_TRUE(timer.isArmed());
+  EXPECT_EQ(wheel.size(), 1u);
+  EXPECT_EQ(wheel.nextTimeout(0), 1000);
+  EXPECT_EQ(wheel.nextTimeout(400), 600);
+
+  wheel.advance(999, expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(1000, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], &timer);
+  EXPECT_EQ(expired[0]->fd, 5);
+  EXPECT_FALSE(timer.isArmed());
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+// 解除したタイマーは切れない
+TEST_F(TimerWheelTest, Disarm) {
+  TimerWheel::Timer timer;
+  wheel.arm(timer, 500, 0);
+  wheel.disarm(timer);
+  EXPECT_FALSE(timer.isArmed());
+  EXPECT_EQ(wheel.size(), 0u);
+  // 二重に解除しても何もしない
+  wheel.disarm(timer);
+  EXPECT_EQ(wheel.size(), 0u);
+
+  wheel.advance(10000, expired);
+  EXPECT_TRUE(expired.empty());
+}
+
+// 登録し直すと期限が延びる
+TEST_F(TimerWheelTest, RearmMovesDeadline) {
+  TimerWheel::Timer timer;
+  wheel.arm(timer, 1000, 0);
+  wheel.arm(timer, 1000, 800);
+  EXPECT_EQ(wheel.size(), 1u);
+
+  wheel.advance(1000, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(1800, expired);
+  EXPECT_EQ(expired.size(), 1u);
+}
+
+// 上の階層に入る長い期限も，振り分け直されて正しい時刻に切れる
+TEST_F(TimerWheelTest, LongTimeoutCascades) {
+  TimerWheel::Timer timer;
+  wheel.arm(timer, 3600 * 1000, 0);
+
+  // 次に起きるのは，1段目が1周して振り分け直すとき
+  int timeout = wheel.nextTimeout(0);
+  EXPECT_GT(timeout, 0);
+  EXPECT_LE(timeout, (1 << TIMER_LEVEL0_BITS) * TIMER_TICK_MS);
+
+  for (unsigned long now = 0; now < 3600 * 1000; now += 50000) {
+    wheel.advance(now, expired);
+  }
+  wheel.advance(3600 * 1000 - 1, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(3600 * 1000, expired);
+  EXPECT_EQ(expired.size(), 1u);
+}
+
+// 期限の異なる複数のタイマーが，それぞれの期限から1ティック以内に切れる
+TEST_F(TimerWheelTest, ManyTimersExpireOnTime) {
+  const unsigned long timeouts[] = {100,    250,    25600,  25700,
+                                    60000,  75000,  409600, 1638400,
+                                    1700000, 5000};
+  const size_t count = sizeof(timeouts) / sizeof(timeouts[0]);
+  std::vector<TimerWheel::Timer> timers(count);
+  for (size_t i = 0; i < count; ++i) {
+    timers[i].fd = static_cast<int>(i);
+    wheel.arm(timers[i], timeouts[i], 0);
+  }
+  EXPECT_EQ(wheel.size(), count);
+
+  std::vector<unsigned long> firedAt(count, 0);
+  for (unsigned long now = 0; now <= 1800000; now += TIMER_TICK_MS) {
+    wheel.advance(now, expired);
+    for (size_t i = 0; i < expired.size(); ++i) {
+      firedAt[expired[i]->fd] = now;
+    }
+    expired.clear();
+  }
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_GE(firedAt[i], timeouts[i]) << "timer " << i;
+    EXPECT_LT(firedAt[i], timeouts[i] + TIMER_TICK_MS) << "timer " << i;
+  }
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+// 時刻が大きく進んでも，まとめて期限切れとして取り出される
+TEST_F(TimerWheelTest, AdvanceAcrossLargeGap) {
+  TimerWheel::Timer a, b;
+  wheel.arm(a, 200, 0);
+  wheel.arm(b, 100000, 0);
+  wheel.advance(500000, expired);
+  EXPECT_EQ(expired.size(), 2u);
+  EXPECT_EQ(wheel.nextTimeout(500000), -1);
+}